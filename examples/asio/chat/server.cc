@@ -24,6 +24,12 @@ class ChatServer : noncopyable
         std::bind(&ChatServer::onConnection, this, _1));
     server_.setMessageCallback(
         std::bind(&LengthHeaderCodec::onMessage, &codec_, _1, _2, _3));
+    // a member who stops reading is kicked out, before the messages
+    // queued for them eat up the memory
+    BacklogPolicy policy;
+    policy.maxBytes = 4 * 1024 * 1024;
+    policy.maxAge = 60.0;
+    server_.setBacklogPolicy(policy);
   }
 
   void start()
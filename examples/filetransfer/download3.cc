@@ -17,6 +17,8 @@ const int kBufSize = 64*1024;
 const char* g_file = NULL;
 typedef std::shared_ptr<FILE> FilePtr;
 
+void onLowWaterMark(const TcpConnectionPtr& conn, size_t len);
+
 void onConnection(const TcpConnectionPtr& conn)
 {
   LOG_INFO << "FileServer - " << conn->peerAddress().toIpPort() << " -> "
@@ -26,7 +28,11 @@ void onConnection(const TcpConnectionPtr& conn)
   {
     LOG_INFO << "FileServer - Sending file " << g_file
              << " to " << conn->peerAddress().toIpPort();
-    conn->setHighWaterMarkCallback(onHighWaterMark, kBufSize+1);
+    conn->setHighWaterMarkCallback(onHighWaterMark, 2*kBufSize+1);
+    // read the next chunk while one is still queued, and keep the kernel
+    // from hoarding more than one chunk of unsent data.
+    conn->setLowWaterMarkCallback(onLowWaterMark, kBufSize);
+    conn->setTcpNotSentLowat(kBufSize);
 
     FILE* fp = ::fopen(g_file, "rb");
     if (fp)
@@ -61,6 +67,11 @@ void onWriteComplete(const TcpConnectionPtr& conn)
   }
 }
 
+void onLowWaterMark(const TcpConnectionPtr& conn, size_t len)
+{
+  onWriteComplete(conn);
+}
+
 int main(int argc, char* argv[])
 {
   LOG_INFO << "pid = " << getpid();
@@ -76,6 +76,11 @@ class PubSubServer : noncopyable
         std::bind(&PubSubServer::onConnection, this, _1));
     server_.setMessageCallback(
         std::bind(&PubSubServer::onMessage, this, _1, _2, _3));
+    // only the latest content of a topic matters to a slow subscriber
+    BacklogPolicy policy;
+    policy.maxBytes = 1024 * 1024;
+    policy.action = BacklogPolicy::kDropOldest;
+    server_.setBacklogPolicy(policy);
     loop_->runEvery(1.0, std::bind(&PubSubServer::timePublish, this));
   }
 
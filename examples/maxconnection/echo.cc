@@ -32,6 +32,7 @@ void EchoServer::onConnection(const TcpConnectionPtr& conn)
   if (conn->connected())
   {
     ++numConnected_;
+    // TcpServer::setMaxConnections() stops accepting instead
     if (numConnected_ > kMaxConnections_)
     {
       conn->shutdown();
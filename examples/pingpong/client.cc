@@ -191,6 +191,7 @@ int main(int argc, char* argv[])
   {
     fprintf(stderr, "Usage: client <host_ip> <port> <threads> <blocksize> ");
     fprintf(stderr, "<sessions> <time>\n");
+    fprintf(stderr, "  <host_ip> starting with '/' or '@' is a Unix domain socket, <port> is ignored\n");
   }
   else
   {
@@ -205,7 +206,8 @@ int main(int argc, char* argv[])
     int timeout = atoi(argv[6]);
 
     EventLoop loop;
-    InetAddress serverAddr(ip, port);
+    InetAddress serverAddr = (ip[0] == '/' || ip[0] == '@')
+        ? InetAddress::unixDomain(ip) : InetAddress(ip, port);
 
     Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount);
     loop.loop();
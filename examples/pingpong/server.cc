@@ -32,6 +32,7 @@ int main(int argc, char* argv[])
   if (argc < 4)
   {
     fprintf(stderr, "Usage: server <address> <port> <threads>\n");
+    fprintf(stderr, "  <address> starting with '/' or '@' is a Unix domain socket, <port> is ignored\n");
   }
   else
   {
@@ -40,7 +41,8 @@ int main(int argc, char* argv[])
 
     const char* ip = argv[1];
     uint16_t port = static_cast<uint16_t>(atoi(argv[2]));
-    InetAddress listenAddr(ip, port);
+    InetAddress listenAddr = (ip[0] == '/' || ip[0] == '@')
+        ? InetAddress::unixDomain(ip) : InetAddress(ip, port);
     int threadCount = atoi(argv[3]);
 
     EventLoop loop;
@@ -116,7 +116,9 @@ int main(int argc, char* argv[])
     EventLoopThreadPool pool(&loop, "rpcbench-client");
     pool.setThreadNum(nThreads);
     pool.start();
-    InetAddress serverAddr(argv[1], 8888);
+    const char* host = argv[1];
+    InetAddress serverAddr = (host[0] == '/' || host[0] == '@')
+        ? InetAddress::unixDomain(host) : InetAddress(host, 8888);
 
     std::vector<std::unique_ptr<RpcClient>> clients;
     for (int i = 0; i < nClients; ++i)
@@ -142,7 +144,7 @@ int main(int argc, char* argv[])
   }
   else
   {
-    printf("Usage: %s host_ip numClients [numThreads]\n", argv[0]);
+    printf("Usage: %s host_ip|unix_path numClients [numThreads]\n", argv[0]);
   }
 }
 
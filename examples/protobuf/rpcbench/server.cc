@@ -33,8 +33,10 @@ int main(int argc, char* argv[])
   int nThreads =  argc > 1 ? atoi(argv[1]) : 1;
   LOG_INFO << "pid = " << getpid() << " threads = " << nThreads;
   EventLoop loop;
-  int port = argc > 2 ? atoi(argv[2]) : 8888;
-  InetAddress listenAddr(static_cast<uint16_t>(port));
+  // a port, or a Unix domain socket path starting with '/' or '@'
+  const char* port = argc > 2 ? argv[2] : "8888";
+  InetAddress listenAddr = (port[0] == '/' || port[0] == '@')
+      ? InetAddress::unixDomain(port) : InetAddress(static_cast<uint16_t>(atoi(port)));
   echo::EchoServiceImpl impl;
   RpcServer server(&loop, listenAddr);
   server.setThreadNum(nThreads);
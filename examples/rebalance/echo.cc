@@ -0,0 +1,122 @@
+#include "examples/rebalance/echo.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+#include <boost/any.hpp>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// below this the loops are left alone
+const int64_t kMinGap = 1024 * 1024;
+
+EchoServer::EchoServer(EventLoop* loop,
+                       const InetAddress& listenAddr,
+                       int numThreads,
+                       double interval)
+  : loop_(loop),
+    server_(loop, listenAddr, "EchoServer"),
+    interval_(interval)
+{
+  server_.setThreadNum(numThreads);
+  server_.setConnectionCallback(
+      std::bind(&EchoServer::onConnection, this, _1));
+  server_.setMessageCallback(
+      std::bind(&EchoServer::onMessage, this, _1, _2, _3));
+}
+
+void EchoServer::start()
+{
+  server_.start();
+  loop_->runEvery(interval_, std::bind(&EchoServer::rebalance, this));
+}
+
+void EchoServer::onConnection(const TcpConnectionPtr& conn)
+{
+  LOG_INFO << "EchoServer - " << conn->peerAddress().toIpPort() << " -> "
+           << conn->localAddress().toIpPort() << " is "
+           << (conn->connected() ? "UP" : "DOWN");
+
+  MutexLockGuard lock(mutex_);
+  if (conn->connected())
+  {
+    BytesPtr bytes(new AtomicInt64);
+    conn->setContext(bytes);
+    conn->setMigrateCallback(std::bind(&EchoServer::onMigrate, this, _1, _2));
+    connections_[conn] = bytes;
+  }
+  else
+  {
+    connections_.erase(conn);
+  }
+}
+
+void EchoServer::onMessage(const TcpConnectionPtr& conn,
+                           Buffer* buf,
+                           Timestamp)
+{
+  const BytesPtr& bytes = boost::any_cast<const BytesPtr&>(conn->getContext());
+  bytes->add(static_cast<int64_t>(buf->readableBytes()));
+  conn->send(buf);
+}
+
+void EchoServer::onMigrate(const TcpConnectionPtr& conn, EventLoop* from)
+{
+  LOG_INFO << conn->name() << " moved from loop " << from
+           << " to loop " << conn->getLoop();
+}
+
+void EchoServer::rebalance()
+{
+  std::map<EventLoop*, int64_t> loads;
+  for (EventLoop* ioLoop : server_.threadPool()->getAllLoops())
+  {
+    loads[ioLoop] = 0;
+  }
+  std::vector<std::pair<TcpConnectionPtr, int64_t>> rates;
+  {
+  MutexLockGuard lock(mutex_);
+  for (const auto& entry : connections_)
+  {
+    int64_t rate = entry.second->getAndSet(0);
+    // getLoop() may be a moment old, good enough for a heuristic
+    loads[entry.first->getLoop()] += rate;
+    rates.push_back(std::make_pair(entry.first, rate));
+  }
+  }
+
+  typedef std::map<EventLoop*, int64_t>::value_type Load;
+  auto byLoad = [](const Load& lhs, const Load& rhs) { return lhs.second < rhs.second; };
+  EventLoop* busiest = std::max_element(loads.begin(), loads.end(), byLoad)->first;
+  EventLoop* idlest = std::min_element(loads.begin(), loads.end(), byLoad)->first;
+  int64_t gap = loads[busiest] - loads[idlest];
+  if (gap < kMinGap)
+  {
+    return;
+  }
+
+  // the hottest connection that still narrows the gap, one per interval
+  // so the loads settle before the next move
+  TcpConnectionPtr hottest;
+  int64_t hottestRate = 0;
+  for (const auto& rate : rates)
+  {
+    if (rate.first->getLoop() == busiest
+        && rate.second > hottestRate && rate.second < gap)
+    {
+      hottest = rate.first;
+      hottestRate = rate.second;
+    }
+  }
+  if (hottest)
+  {
+    LOG_INFO << "rebalance - loop " << busiest << " " << loads[busiest]
+             << " bytes, loop " << idlest << " " << loads[idlest]
+             << " bytes, moving " << hottest->name() << " " << hottestRate << " bytes";
+    hottest->migrateTo(idlest);
+  }
+}
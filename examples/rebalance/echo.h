@@ -0,0 +1,47 @@
+#ifndef MUDUO_EXAMPLES_REBALANCE_ECHO_H
+#define MUDUO_EXAMPLES_REBALANCE_ECHO_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/net/TcpServer.h"
+
+#include <map>
+
+// RFC 862, with hot connections moved off busy loops
+//
+// Every interval the base loop adds up the bytes each IO loop echoed, and
+// when the busiest loop did much more than the idlest, moves one of its
+// connections over with TcpConnection::migrateTo().
+class EchoServer
+{
+ public:
+  EchoServer(muduo::net::EventLoop* loop,
+             const muduo::net::InetAddress& listenAddr,
+             int numThreads,
+             double interval);
+
+  void start();
+
+ private:
+  typedef std::shared_ptr<muduo::AtomicInt64> BytesPtr;
+
+  void onConnection(const muduo::net::TcpConnectionPtr& conn);
+
+  void onMessage(const muduo::net::TcpConnectionPtr& conn,
+                 muduo::net::Buffer* buf,
+                 muduo::Timestamp time);
+
+  void onMigrate(const muduo::net::TcpConnectionPtr& conn,
+                 muduo::net::EventLoop* from);
+
+  void rebalance();
+
+  muduo::net::EventLoop* loop_;
+  muduo::net::TcpServer server_;
+  const double interval_;
+  muduo::MutexLock mutex_;
+  // bytes echoed since the last rebalance()
+  std::map<muduo::net::TcpConnectionPtr, BytesPtr> connections_ GUARDED_BY(mutex_);
+};
+
+#endif  // MUDUO_EXAMPLES_REBALANCE_ECHO_H
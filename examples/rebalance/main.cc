@@ -0,0 +1,31 @@
+#include "examples/rebalance/echo.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int main(int argc, char* argv[])
+{
+  LOG_INFO << "pid = " << getpid();
+  EventLoop loop;
+  InetAddress listenAddr(2007);
+  int numThreads = 4;
+  double interval = 1.0;
+  if (argc > 1)
+  {
+    numThreads = atoi(argv[1]);
+  }
+  if (argc > 2)
+  {
+    interval = atof(argv[2]);
+  }
+  LOG_INFO << "numThreads = " << numThreads << ", interval = " << interval;
+  EchoServer server(&loop, listenAddr, numThreads, interval);
+  server.start();
+  loop.loop();
+}
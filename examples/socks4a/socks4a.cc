@@ -1,15 +1,20 @@
 #include "examples/socks4a/tunnel.h"
 
 #include "muduo/net/Endian.h"
+#include "muduo/net/Resolver.h"
+
+#include <set>
+
 #include <stdio.h>
-#include <netdb.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
 EventLoop* g_eventLoop;
+Resolver* g_resolver;
 std::map<string, TunnelPtr> g_tunnels;
+std::set<string> g_resolving;
 
 void onServerConnection(const TcpConnectionPtr& conn)
 {
@@ -20,6 +25,7 @@ void onServerConnection(const TcpConnectionPtr& conn)
   }
   else
   {
+    g_resolving.erase(conn->name());
     std::map<string, TunnelPtr>::iterator it = g_tunnels.find(conn->name());
     if (it != g_tunnels.end())
     {
@@ -29,10 +35,62 @@ void onServerConnection(const TcpConnectionPtr& conn)
   }
 }
 
+void startTunnel(const TcpConnectionPtr& conn, bool okay, const sockaddr_in& addr)
+{
+  if (okay)
+  {
+    InetAddress serverAddr(addr);
+    TunnelPtr tunnel(new Tunnel(g_eventLoop, serverAddr, conn));
+    tunnel->setup();
+    tunnel->connect();
+    g_tunnels[conn->name()] = tunnel;
+    char response[] = "\000\x5aUVWXYZ";
+    memcpy(response+2, &addr.sin_port, 2);
+    memcpy(response+4, &addr.sin_addr.s_addr, 4);
+    conn->send(response, 8);
+  }
+  else
+  {
+    char response[] = "\000\x5bUVWXYZ";
+    conn->send(response, 8);
+    conn->shutdown();
+  }
+}
+
+void onResolved(const std::weak_ptr<TcpConnection>& weakConn, char ver, char cmd, in_port_t port,
+                const std::vector<InetAddress>& addrs)
+{
+  TcpConnectionPtr conn(weakConn.lock());
+  if (!conn || g_resolving.erase(conn->name()) == 0)
+  {
+    return;
+  }
+  // the reply has room for an IPv4 address only
+  sockaddr_in addr;
+  memZero(&addr, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = port;
+  bool okay = false;
+  for (const InetAddress& resolved : addrs)
+  {
+    if (resolved.family() == AF_INET)
+    {
+      addr.sin_addr.s_addr = resolved.ipv4NetEndian();
+      okay = true;
+      break;
+    }
+  }
+  startTunnel(conn, ver == 4 && cmd == 1 && okay, addr);
+}
+
 void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
 {
   LOG_DEBUG << conn->name() << " " << buf->readableBytes();
-  if (g_tunnels.find(conn->name()) == g_tunnels.end())
+  if (g_resolving.count(conn->name()))
+  {
+    // data for the tunnel, stays in buf until it is up
+  }
+  else if (g_tunnels.find(conn->name()) == g_tunnels.end())
   {
     if (buf->readableBytes() > 128)
     {
@@ -57,51 +115,24 @@ void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
         addr.sin_addr.s_addr = *static_cast<const uint32_t*>(ip);
 
         bool socks4a = sockets::networkToHost32(addr.sin_addr.s_addr) < 256;
-        bool okay = false;
         if (socks4a)
         {
           const char* endOfHostName = std::find(where+1, end, '\0');
           if (endOfHostName != end)
           {
             string hostname = where+1;
-            where = endOfHostName;
             LOG_INFO << "Socks4a host name " << hostname;
-            InetAddress tmp;
-            if (InetAddress::resolve(hostname, &tmp))
-            {
-              addr.sin_addr.s_addr = tmp.ipv4NetEndian();
-              okay = true;
-            }
-          }
-          else
-          {
-            return;
+            buf->retrieveUntil(endOfHostName+1);
+            // the loop keeps serving other tunnels while the name resolves
+            g_resolving.insert(conn->name());
+            g_resolver->resolve(hostname, std::bind(onResolved, std::weak_ptr<TcpConnection>(conn),
+                                                    ver, cmd, addr.sin_port, _1));
           }
-        }
-        else
-        {
-          okay = true;
+          return;
         }
 
-        InetAddress serverAddr(addr);
-        if (ver == 4 && cmd == 1 && okay)
-        {
-          TunnelPtr tunnel(new Tunnel(g_eventLoop, serverAddr, conn));
-          tunnel->setup();
-          tunnel->connect();
-          g_tunnels[conn->name()] = tunnel;
-          buf->retrieveUntil(where+1);
-          char response[] = "\000\x5aUVWXYZ";
-          memcpy(response+2, &addr.sin_port, 2);
-          memcpy(response+4, &addr.sin_addr.s_addr, 4);
-          conn->send(response, 8);
-        }
-        else
-        {
-          char response[] = "\000\x5bUVWXYZ";
-          conn->send(response, 8);
-          conn->shutdown();
-        }
+        buf->retrieveUntil(where+1);
+        startTunnel(conn, ver == 4 && cmd == 1, addr);
       }
     }
   }
@@ -128,6 +159,9 @@ int main(int argc, char* argv[])
 
     EventLoop loop;
     g_eventLoop = &loop;
+    Resolver resolver(&loop);
+    resolver.loadHostsFile();
+    g_resolver = &resolver;
 
     TcpServer server(&loop, listenAddr, "Socks4");
 
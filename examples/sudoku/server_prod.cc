@@ -3,15 +3,19 @@
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Logging.h"
 #include "muduo/base/Thread.h"
+#include "muduo/base/ThreadLocal.h"
 #include "muduo/base/ThreadPool.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThread.h"
 #include "muduo/net/InetAddress.h"
+#include "muduo/net/LoopInbox.h"
 #include "muduo/net/TcpServer.h"
 #include "muduo/net/inspect/Inspector.h"
 
 #include <boost/circular_buffer.hpp>
 
+#include <map>
+
 //#include <stdio.h>
 //#include <unistd.h>
 
@@ -29,6 +33,7 @@ class SudokuServer : noncopyable
                int numThreads,
                bool nodelay)
     : server_(loop, listenAddr, "SudokuServer"),
+      inboxes_(),
       threadPool_(),
       numThreads_(numThreads),
       tcpNoDelay_(nodelay),
@@ -45,6 +50,7 @@ class SudokuServer : noncopyable
     server_.setMessageCallback(
         std::bind(&SudokuServer::onMessage, this, _1, _2, _3));
     server_.setThreadNum(numEventLoops);
+    server_.setKernelReceiveTime(true);
 
     inspector_.add("sudoku", "stats", std::bind(&SudokuStat::report, &stat_),
                    "statistics of sudoku solver");
@@ -71,8 +77,9 @@ class SudokuServer : noncopyable
         conn->setTcpNoDelay(true);
       conn->setHighWaterMarkCallback(
           std::bind(&SudokuServer::highWaterMark, this, _1, _2), 5 * 1024 * 1024);
-      bool throttle = false;
-      conn->setContext(throttle);
+      // stop reading while too many puzzles of this connection are queued,
+      // leftover requests stay in the kernel until solutions drain.
+      conn->setInFlightWaterMark(kMaxInFlight, kMaxInFlight / 2);
     }
   }
 
@@ -84,8 +91,7 @@ class SudokuServer : noncopyable
       conn->setHighWaterMarkCallback(
           std::bind(&SudokuServer::highWaterMark, this, _1, _2), 10 * 1024 * 1024);
       conn->setWriteCompleteCallback(std::bind(&SudokuServer::writeComplete, this, _1));
-      bool throttle = true;
-      conn->setContext(throttle);
+      conn->stopRead();
     }
     else
     {
@@ -101,14 +107,14 @@ class SudokuServer : noncopyable
     conn->setHighWaterMarkCallback(
         std::bind(&SudokuServer::highWaterMark, this, _1, _2), 5 * 1024 * 1024);
     conn->setWriteCompleteCallback(WriteCompleteCallback());
-    bool throttle = false;
-    conn->setContext(throttle);
+    conn->startRead();
   }
 
   void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
   {
+    stat_.recordSocketQueueing(conn->getLoop()->pollReturnTime(), receiveTime);
     size_t len = buf->readableBytes();
-    while (len >= kCells + 2)
+    while (len >= kCells + 2 && conn->inFlight() < kMaxInFlight)
     {
       const char* crlf = buf->findCRLF();
       if (crlf)
@@ -167,9 +173,9 @@ class SudokuServer : noncopyable
 
     if (req.puzzle.size() == implicit_cast<size_t>(kCells))
     {
-      bool throttle = boost::any_cast<bool>(conn->getContext());
-      if (threadPool_.queueSize() < 1000 * 1000 && !throttle)
+      if (threadPool_.queueSize() < 1000 * 1000)
       {
+        conn->incInFlight();
         threadPool_.run(std::bind(&SudokuServer::solve, this, conn, req));
       }
       else
@@ -193,18 +199,43 @@ class SudokuServer : noncopyable
   {
     LOG_DEBUG << conn->name();
     string result = solveSudoku(req.puzzle);
-    if (req.id.empty())
+    string response = req.id.empty() ? result + "\r\n" : req.id + ":" + result + "\r\n";
+    EventLoop* loop = conn->getLoop();
+    if (loop->isInLoopThread())
     {
-      conn->send(result + "\r\n");
+      // numThreads == 0, solved inline in the IO thread
+      sendInLoop(conn, response);
     }
     else
     {
-      conn->send(req.id + ":" + result + "\r\n");
+      inboxOf(loop)->post(std::bind(&SudokuServer::sendInLoop, conn, std::move(response)));
     }
     stat_.recordResponse(Timestamp::now(), req.receiveTime, result != kNoSolution);
+    conn->decInFlight();
+  }
+
+  static const int kMaxInFlight = 1000;
+
+  static void sendInLoop(const TcpConnectionPtr& conn, const string& response)
+  {
+    conn->send(response);
   }
 
+  // 每个worker线程到每个IO loop一条SPSC通道, 不争抢loop的锁
+  LoopInbox* inboxOf(EventLoop* loop)
+  {
+    std::unique_ptr<LoopInbox>& inbox = inboxes_.value()[loop];
+    if (!inbox)
+    {
+      inbox.reset(new LoopInbox(loop));
+    }
+    return inbox.get();
+  }
+
+  typedef std::map<EventLoop*, std::unique_ptr<LoopInbox>> InboxMap;
+
   TcpServer server_;
+  ThreadLocal<InboxMap> inboxes_;  // outlives the worker threads
   ThreadPool threadPool_;
   const int numThreads_;
   const bool tcpNoDelay_;
@@ -14,7 +14,9 @@ class SudokuStat : muduo::noncopyable
       badRequests_(0),
       droppedRequests_(0),
       totalLatency_(0),
-      badLatency_(0)
+      badLatency_(0),
+      socketQueueing_(0),
+      socketQueueingReads_(0)
   {
   }
 
@@ -32,6 +34,10 @@ class SudokuStat : muduo::noncopyable
     result << "bad_requests " << badRequests_ << '\n';
     result << "dropped_requests " << droppedRequests_ << '\n';
     result << "latency_sum_us " << totalLatency_ << '\n';
+    // included in latency, see recordSocketQueueing()
+    result << "socket_queue_us_sum " << socketQueueing_ << '\n';
+    int64_t socketQueueingAvg = socketQueueingReads_ == 0 ? 0 : socketQueueing_ / socketQueueingReads_;
+    result << "socket_queue_us_avg " << socketQueueingAvg << '\n';
     if (badLatency_ > 0)
     {
       result << "bad_latency" << badLatency_ << '\n';
@@ -78,6 +84,8 @@ class SudokuStat : muduo::noncopyable
     badRequests_ = 0;
     totalLatency_ = 0;
     badLatency_ = 0;
+    socketQueueing_ = 0;
+    socketQueueingReads_ = 0;
     }
     return "reset done.";
   }
@@ -165,6 +173,19 @@ class SudokuStat : muduo::noncopyable
     ++totalRequests_;
   }
 
+  // time between the kernel receiving a request and the loop polling it,
+  // zero unless TcpServer::setKernelReceiveTime() is on
+  void recordSocketQueueing(Timestamp polled, Timestamp receive)
+  {
+    const int64_t queued_us = polled.microSecondsSinceEpoch() - receive.microSecondsSinceEpoch();
+    MutexLockGuard lock(mutex_);
+    if (queued_us >= 0)
+    {
+      socketQueueing_ += queued_us;
+      ++socketQueueingReads_;
+    }
+  }
+
   void recordBadRequest()
   {
     MutexLockGuard lock(mutex_);
@@ -188,6 +209,7 @@ class SudokuStat : muduo::noncopyable
   boost::circular_buffer<int64_t> requests_;
   boost::circular_buffer<int64_t> latencies_;
   int64_t totalRequests_, totalResponses_, totalSolved_, badRequests_, droppedRequests_, totalLatency_, badLatency_;
+  int64_t socketQueueing_, socketQueueingReads_;
   // FIXME int128_t for totalLatency_;
 
   static const int kSeconds = 60;
@@ -0,0 +1,73 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "inspect/PreforkInspector.h"
+
+#include "muduo/net/PreforkServer.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+void appendStats(string* out, const char* name, const PreforkServer::WorkerStats& stats)
+{
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "%-8s %7d %11lld %9lld %9lld %9.3f %9.2f  %s\n",
+           name, static_cast<int>(stats.pid),
+           static_cast<long long>(stats.connections),
+           static_cast<long long>(stats.accepted),
+           static_cast<long long>(stats.rejected),
+           stats.loopLag, stats.cpuSeconds,
+           stats.when.valid() ? stats.when.toFormattedString(false).c_str() : "-");
+  out->append(buf);
+}
+
+const char kHeader[] =
+    "worker       pid connections  accepted  rejected   looplag       cpu  reported\n";
+
+}  // namespace
+
+PreforkInspector::PreforkInspector(PreforkServer* server)
+  : server_(server)
+{
+}
+
+void PreforkInspector::registerCommands(Inspector* ins, const string& module)
+{
+  ins->add(module, "workers", std::bind(&PreforkInspector::workers, this, _1, _2),
+           "latest stats of each worker of " + server_->name());
+  ins->add(module, "total", std::bind(&PreforkInspector::total, this, _1, _2),
+           "stats summed over the workers, and restarts");
+}
+
+string PreforkInspector::workers(HttpRequest::Method, const Inspector::ArgList&)
+{
+  string result = kHeader;
+  std::vector<PreforkServer::WorkerStats> stats = server_->workerStats();
+  for (size_t i = 0; i < stats.size(); ++i)
+  {
+    char name[16];
+    snprintf(name, sizeof name, "%zu", i);
+    appendStats(&result, name, stats[i]);
+  }
+  return result;
+}
+
+string PreforkInspector::total(HttpRequest::Method, const Inspector::ArgList&)
+{
+  string result = kHeader;
+  PreforkServer::WorkerStats stats = server_->totalStats();
+  stats.pid = ::getpid();
+  appendStats(&result, "total", stats);
+  char buf[64];
+  snprintf(buf, sizeof buf, "restarts %lld\n",
+           static_cast<long long>(server_->restarts()));
+  result += buf;
+  return result;
+}
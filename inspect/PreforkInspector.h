@@ -0,0 +1,37 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_INSPECT_PREFORKINSPECTOR_H
+#define MUDUO_NET_INSPECT_PREFORKINSPECTOR_H
+
+#include "inspect/Inspector.h"
+
+namespace muduo
+{
+namespace net
+{
+
+class PreforkServer;
+
+/// Stats of the workers of a PreforkServer, under /module/...
+/// The Inspector must run in the master loop.
+class PreforkInspector : noncopyable
+{
+ public:
+  explicit PreforkInspector(PreforkServer* server);
+
+  void registerCommands(Inspector* ins, const string& module);
+
+  string workers(HttpRequest::Method, const Inspector::ArgList&);
+  string total(HttpRequest::Method, const Inspector::ArgList&);
+
+ private:
+  PreforkServer* server_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_INSPECT_PREFORKINSPECTOR_H
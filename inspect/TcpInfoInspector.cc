@@ -0,0 +1,43 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "inspect/TcpInfoInspector.h"
+
+#include "muduo/net/TcpServer.h"
+
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+TcpInfoInspector::TcpInfoInspector(TcpServer* server)
+  : server_(server)
+{
+}
+
+void TcpInfoInspector::registerCommands(Inspector* ins, const string& module)
+{
+  ins->add(module, "stats", std::bind(&TcpInfoInspector::stats, this, _1, _2),
+           "histograms of rtt, cwnd, retransmits... of " + server_->name());
+  ins->add(module, "worst", std::bind(&TcpInfoInspector::worst, this, _1, _2),
+           "latest TCP_INFO of the connections with the largest rtt + 4*rttvar");
+  ins->add(module, "reset", std::bind(&TcpInfoInspector::reset, this, _1, _2),
+           "reset histograms");
+}
+
+string TcpInfoInspector::stats(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return server_->tcpInfoHistograms().toString();
+}
+
+string TcpInfoInspector::worst(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  int n = args.empty() ? 20 : atoi(args[0].c_str());
+  return TcpInfoSampler::toString(server_->worstConnections(n > 0 ? n : 20));
+}
+
+string TcpInfoInspector::reset(HttpRequest::Method, const Inspector::ArgList&)
+{
+  server_->resetTcpInfo();
+  return "tcp info histograms reset\n";
+}
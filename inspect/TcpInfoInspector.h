@@ -0,0 +1,39 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_INSPECT_TCPINFOINSPECTOR_H
+#define MUDUO_NET_INSPECT_TCPINFOINSPECTOR_H
+
+#include "inspect/Inspector.h"
+
+namespace muduo
+{
+namespace net
+{
+
+class TcpServer;
+
+/// TCP_INFO of a TcpServer's connections, under /module/...
+/// The server must have called TcpServer::enableTcpInfoSampling().
+class TcpInfoInspector : noncopyable
+{
+ public:
+  explicit TcpInfoInspector(TcpServer* server);
+
+  void registerCommands(Inspector* ins, const string& module);
+
+  string stats(HttpRequest::Method, const Inspector::ArgList&);
+  /// /module/worst/N, N defaults to 20
+  string worst(HttpRequest::Method, const Inspector::ArgList& args);
+  string reset(HttpRequest::Method, const Inspector::ArgList&);
+
+ private:
+  TcpServer* server_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_INSPECT_TCPINFOINSPECTOR_H
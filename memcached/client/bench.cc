@@ -1,10 +1,12 @@
 #include "muduo/base/CountDownLatch.h"
 #include "muduo/base/Logging.h"
+#include "muduo/net/ConnectionPool.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
-#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpConnection.h"
 
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <iostream>
 
 #include <stdio.h>
@@ -13,6 +15,8 @@ namespace po = boost::program_options;
 using namespace muduo;
 using namespace muduo::net;
 
+// the clients of one loop, a ConnectionPool keeps as many requests in
+// flight as it has connections, each goes on the least busy connection
 class Client : noncopyable
 {
  public:
@@ -26,101 +30,115 @@ class Client : noncopyable
          EventLoop* loop,
          const InetAddress& serverAddr,
          Operation op,
+         int connections,
          int requests,
          int keys,
          int valuelen,
          CountDownLatch* connected,
          CountDownLatch* finished)
     : name_(name),
-      client_(loop, serverAddr, name),
+      loop_(loop),
+      pool_(new ConnectionPool(loop, serverAddr, name, connections)),
       op_(op),
+      connections_(connections),
+      allConnected_(false),
       sent_(0),
       acked_(0),
-      requests_(requests),
-      keys_(keys),
+      requests_(connections * requests),
+      keys_(connections * keys),
       valuelen_(valuelen),
       value_(valuelen_, 'a'),
       connected_(connected),
       finished_(finished)
   {
     value_ += "\r\n";
-    client_.setConnectionCallback(std::bind(&Client::onConnection, this, _1));
-    client_.setMessageCallback(std::bind(&Client::onMessage, this, _1, _2, _3));
-    client_.connect();
+    pool_->setConnectionCallback(std::bind(&Client::onConnection, this, _1));
+    pool_->setMessageCallback(std::bind(&Client::onMessage, this, _1, _2, _3));
+    loop_->runInLoop(std::bind(&ConnectionPool::start, pool_.get()));
+  }
+
+  void start()
+  {
+    loop_->runInLoop(std::bind(&Client::startInLoop, this));
+  }
+
+  // the pool is loop-local
+  void stop(CountDownLatch* stopped)
+  {
+    loop_->runInLoop([this, stopped]()
+    {
+      pool_.reset();
+      stopped->countDown();
+    });
+  }
+
+ private:
+  void startInLoop()
+  {
+    for (int i = 0; i < connections_; ++i)
+    {
+      send();
+    }
   }
 
   void send()
   {
+    TcpConnectionPtr conn = pool_->checkout();
+    if (!conn)
+    {
+      LOG_ERROR << name_ << " no connection";
+      return;
+    }
+    conn->incInFlight();
     Buffer buf;
     fill(&buf);
-    conn_->send(&buf);
+    conn->send(&buf);
   }
 
- private:
-
   void onConnection(const TcpConnectionPtr& conn)
   {
-    if (conn->connected())
+    if (conn->connected() && !allConnected_ && pool_->numConnected() == connections_)
     {
-      conn_ = conn;
+      allConnected_ = true;
       connected_->countDown();
     }
-    else
-    {
-      conn_.reset();
-      client_.getLoop()->queueInLoop(std::bind(&CountDownLatch::countDown, finished_));
-    }
   }
 
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buffer,
                  Timestamp receiveTime)
   {
-    if (op_ == kSet)
+    const char* end = NULL;
+    // replies come back in order on each connection
+    while ((end = findReply(buffer)) != NULL)
     {
-      while (buffer->readableBytes() > 0)
+      buffer->retrieveUntil(end);
+      conn->decInFlight();
+      ++acked_;
+      if (sent_ < requests_)
       {
-        const char* crlf = buffer->findCRLF();
-        if (crlf)
-        {
-          buffer->retrieveUntil(crlf+2);
-          ++acked_;
-          if (sent_ < requests_)
-          {
-            send();
-          }
-        }
-        else
-        {
-          break;
-        }
+        send();
       }
     }
-    else
+    if (acked_ == requests_)
     {
-      while (buffer->readableBytes() > 0)
-      {
-        const char* end = static_cast<const char*>(memmem(buffer->peek(),
-                                                          buffer->readableBytes(),
-                                                          "END\r\n", 5));
-        if (end)
-        {
-          buffer->retrieveUntil(end+5);
-          ++acked_;
-          if (sent_ < requests_)
-          {
-            send();
-          }
-        }
-        else
-        {
-          break;
-        }
-      }
+      finished_->countDown();
     }
-    if (acked_ == requests_)
+  }
+
+  const char* findReply(Buffer* buffer) const
+  {
+    if (op_ == kSet)
     {
-      conn_->shutdown();
+      const char* crlf = buffer->findCRLF();
+      return crlf ? crlf+2 : NULL;
+    }
+    else
+    {
+      const char* end = static_cast<const char*>(memmem(buffer->peek(),
+                                                        buffer->readableBytes(),
+                                                        "END\r\n", 5));
+      return end ? end+5 : NULL;
     }
   }
 
@@ -143,9 +161,11 @@ class Client : noncopyable
   }
 
   string name_;
-  TcpClient client_;
-  TcpConnectionPtr conn_;
+  EventLoop* loop_;
+  std::unique_ptr<ConnectionPool> pool_;
   const Operation op_;
+  const int connections_;
+  bool allConnected_;
   int sent_;
   int acked_;
   const int requests_;
@@ -203,20 +223,24 @@ int main(int argc, char* argv[])
   double memoryMiB = 1.0 * clients * keys * (32+80+valuelen+8) / 1024 / 1024;
   LOG_WARN << "estimated memcached-debug memory usage " << int(memoryMiB) << " MiB";
 
+  // every loop gets a client
+  threads = std::min(threads, clients);
   pool.setThreadNum(threads);
   pool.start();
 
+  // one pool per loop, the clients split among them
   char buf[32];
-  CountDownLatch connected(clients);
-  CountDownLatch finished(clients);
+  CountDownLatch connected(threads);
+  CountDownLatch finished(threads);
   std::vector<std::unique_ptr<Client>> holder;
-  for (int i = 0; i < clients; ++i)
+  for (int i = 0; i < threads; ++i)
   {
     snprintf(buf, sizeof buf, "%d-", i+1);
     holder.emplace_back(new Client(buf,
                                 pool.getNextLoop(),
                                 serverAddr,
                                 op,
+                                clients / threads + (i < clients % threads ? 1 : 0),
                                 requests,
                                 keys,
                                 valuelen,
@@ -226,9 +250,9 @@ int main(int argc, char* argv[])
   connected.wait();
   LOG_WARN << clients << " clients all connected";
   Timestamp start = Timestamp::now();
-  for (int i = 0; i < clients; ++i)
+  for (int i = 0; i < threads; ++i)
   {
-    holder[i]->send();
+    holder[i]->start();
   }
   finished.wait();
   Timestamp end = Timestamp::now();
@@ -236,4 +260,11 @@ int main(int argc, char* argv[])
   double seconds = timeDifference(end, start);
   LOG_WARN << seconds << " sec";
   LOG_WARN << 1.0 * clients * requests / seconds << " QPS";
+
+  CountDownLatch stopped(threads);
+  for (int i = 0; i < threads; ++i)
+  {
+    holder[i]->stop(&stopped);
+  }
+  stopped.wait();
 }
@@ -0,0 +1,219 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_FUNCTION_H
+#define MUDUO_BASE_FUNCTION_H
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <stddef.h>
+
+namespace muduo
+{
+
+template<typename Signature, size_t InlineSize = 56>
+class Function;
+
+///
+/// A move-only std::function with a bigger inline buffer.
+///
+/// Callables up to @c InlineSize bytes that are nothrow movable are stored
+/// inside the object, bigger ones go to the heap. The default 56 bytes,
+/// 64 with the ops pointer, one cache line, holds std::bind() of a member function, an
+/// object pointer and a string, which std::function (16 bytes inline in
+/// libstdc++) always allocates for. Being move-only it also holds
+/// move-only captures, eg. std::unique_ptr.
+///
+template<typename R, typename... Args, size_t InlineSize>
+class Function<R (Args...), InlineSize>
+{
+ public:
+  Function() noexcept : ops_(NULL) { }
+  Function(std::nullptr_t) noexcept : ops_(NULL) { }
+
+  template<typename F,
+           typename = typename std::enable_if<
+               !std::is_same<typename std::decay<F>::type, Function>::value>::type,
+           typename = decltype(std::declval<typename std::decay<F>::type&>()(std::declval<Args>()...))>
+  Function(F&& f)
+    : ops_(NULL)
+  {
+    typedef typename std::decay<F>::type Functor;
+    if (!isNull(f))
+    {
+      construct<Functor>(std::forward<F>(f), Inline<Functor>());
+    }
+  }
+
+  Function(Function&& rhs) noexcept
+    : ops_(rhs.ops_)
+  {
+    if (ops_)
+    {
+      ops_->move(&storage_, &rhs.storage_);
+      rhs.ops_ = NULL;
+    }
+  }
+
+  Function& operator=(Function&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      reset();
+      if (rhs.ops_)
+      {
+        rhs.ops_->move(&storage_, &rhs.storage_);
+        ops_ = rhs.ops_;
+        rhs.ops_ = NULL;
+      }
+    }
+    return *this;
+  }
+
+  Function& operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  ~Function() { reset(); }
+
+  Function(const Function&) = delete;
+  Function& operator=(const Function&) = delete;
+
+  explicit operator bool() const noexcept { return ops_ != NULL; }
+
+  // const like std::function::operator(), the callable itself may mutate
+  R operator()(Args... args) const
+  {
+    if (ops_ == NULL)
+    {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(const_cast<Storage*>(&storage_), std::forward<Args>(args)...);
+  }
+
+  void swap(Function& rhs) noexcept
+  {
+    Function tmp(std::move(rhs));
+    rhs = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  /// For benchmarks and tests.
+  bool isInline() const noexcept { return ops_ != NULL && ops_->isInline; }
+
+ private:
+  typedef typename std::aligned_storage<InlineSize, alignof(void*)>::type Storage;
+
+  struct Ops
+  {
+    R (*invoke)(Storage* storage, Args&&... args);
+    // move constructs dst from src, then destroys src
+    void (*move)(Storage* dst, Storage* src);
+    void (*destroy)(Storage* storage);
+    bool isInline;
+  };
+
+  template<typename Functor>
+  struct Inline
+    : std::integral_constant<bool,
+                             sizeof(Functor) <= InlineSize
+                             && alignof(Functor) <= alignof(Storage)
+                             && std::is_nothrow_move_constructible<Functor>::value>
+  {
+  };
+
+  template<typename Functor>
+  struct InlineOps
+  {
+    static Functor* get(Storage* storage) { return static_cast<Functor*>(static_cast<void*>(storage)); }
+
+    static R invoke(Storage* storage, Args&&... args)
+    {
+      return (*get(storage))(std::forward<Args>(args)...);
+    }
+    static void move(Storage* dst, Storage* src)
+    {
+      ::new (dst) Functor(std::move(*get(src)));
+      get(src)->~Functor();
+    }
+    static void destroy(Storage* storage) { get(storage)->~Functor(); }
+
+    static const Ops ops;
+  };
+
+  template<typename Functor>
+  struct HeapOps
+  {
+    static Functor*& get(Storage* storage) { return *static_cast<Functor**>(static_cast<void*>(storage)); }
+
+    static R invoke(Storage* storage, Args&&... args)
+    {
+      return (*get(storage))(std::forward<Args>(args)...);
+    }
+    static void move(Storage* dst, Storage* src)
+    {
+      *static_cast<Functor**>(static_cast<void*>(dst)) = get(src);
+    }
+    static void destroy(Storage* storage) { delete get(storage); }
+
+    static const Ops ops;
+  };
+
+  template<typename F>
+  static bool isNull(const F&) { return false; }
+  template<typename F>
+  static bool isNull(F* f) { return f == NULL; }
+  template<typename Sig>
+  static bool isNull(const std::function<Sig>& f) { return !f; }
+
+  template<typename Functor, typename F>
+  void construct(F&& f, std::true_type)
+  {
+    ::new (&storage_) Functor(std::forward<F>(f));
+    ops_ = &InlineOps<Functor>::ops;
+  }
+
+  template<typename Functor, typename F>
+  void construct(F&& f, std::false_type)
+  {
+    HeapOps<Functor>::get(&storage_) = new Functor(std::forward<F>(f));
+    ops_ = &HeapOps<Functor>::ops;
+  }
+
+  void reset() noexcept
+  {
+    if (ops_)
+    {
+      ops_->destroy(&storage_);
+      ops_ = NULL;
+    }
+  }
+
+  const Ops* ops_;
+  Storage storage_;
+};
+
+template<typename R, typename... Args, size_t InlineSize>
+template<typename Functor>
+const typename Function<R (Args...), InlineSize>::Ops
+Function<R (Args...), InlineSize>::InlineOps<Functor>::ops =
+{
+  &InlineOps<Functor>::invoke, &InlineOps<Functor>::move, &InlineOps<Functor>::destroy, true
+};
+
+template<typename R, typename... Args, size_t InlineSize>
+template<typename Functor>
+const typename Function<R (Args...), InlineSize>::Ops
+Function<R (Args...), InlineSize>::HeapOps<Functor>::ops =
+{
+  &HeapOps<Functor>::invoke, &HeapOps<Functor>::move, &HeapOps<Functor>::destroy, false
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_FUNCTION_H
@@ -81,10 +81,14 @@ class Logger
   /// 函数指针类型
   typedef void (*OutputFunc)(const char* msg, int len);
   typedef void (*FlushFunc)();
+  typedef Timestamp (*ClockFunc)();
 
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
   static void setTimeZone(const TimeZone& tz);
+  /// Where log lines get their time, Timestamp::now by default.
+  /// Timestamp::coarseNow or EventLoop::cachedNow are cheaper, but less precise.
+  static void setClock(ClockFunc);
 
  private:
 
@@ -0,0 +1,106 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_SPSCQUEUE_H
+#define MUDUO_BASE_SPSCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace muduo
+{
+
+///
+/// Fixed capacity, lock-free queue of exactly one producer thread and one
+/// consumer thread.
+///
+/// T only needs to be default constructible and movable, slots are
+/// reused in place. Capacity is rounded up to a power of two.
+template<typename T>
+class SpscQueue : noncopyable
+{
+ public:
+  explicit SpscQueue(size_t capacity)
+    : capacity_(roundUp(capacity)),
+      mask_(capacity_ - 1),
+      slots_(new T[capacity_]),
+      head_(0),
+      tail_(0),
+      cachedHead_(0)
+  {
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  /// Producer only. Moves from @c x only on success, false if full.
+  bool tryPush(T& x)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ == capacity_)
+    {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ == capacity_)
+      {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(x);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer only, false if empty.
+  bool tryPop(T* x)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    T& slot = slots_[head & mask_];
+    *x = std::move(slot);
+    slot = T();  // release what the slot holds now, not when it's reused
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Approximate from any other thread.
+  size_t size() const
+  {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  static size_t roundUp(size_t n)
+  {
+    size_t capacity = 1;
+    while (capacity < n)
+    {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  // consumer and producer indices on their own cache lines
+  char pad0_[64];
+  std::atomic<size_t> head_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  size_t cachedHead_;  // producer's last view of head_
+  char pad2_[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_SPSCQUEUE_H
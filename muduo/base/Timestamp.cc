@@ -6,6 +6,7 @@
 #include "muduo/base/Timestamp.h"
 
 #include <sys/time.h>
+#include <time.h>
 #include <stdio.h>
 
 #ifndef __STDC_FORMAT_MACROS
@@ -63,3 +64,17 @@ Timestamp Timestamp::now()
   return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+
+/// 粗粒度时钟, 没有CLOCK_REALTIME_COARSE时退回now()
+Timestamp Timestamp::coarseNow()
+{
+#ifdef CLOCK_REALTIME_COARSE
+  struct timespec ts;
+  if (::clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0)
+  {
+    int64_t seconds = ts.tv_sec;
+    return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+  }
+#endif
+  return now();
+}
@@ -71,6 +71,11 @@ class Timestamp : public muduo::copyable,
   ///
   /// 当前时间戳
   static Timestamp now();
+  ///
+  /// Get time of now from the coarse clock, it only reads memory shared with
+  /// the kernel. Resolution is one tick (1~4ms), good for logs and counters.
+  ///
+  static Timestamp coarseNow();
   static Timestamp invalid()
   {
     return Timestamp();
@@ -0,0 +1,119 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/base/TscClock.h"
+
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Types.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MUDUO_HAVE_TSC 1
+#endif
+
+using namespace muduo;
+
+namespace
+{
+
+int64_t monotonicNanoseconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+#ifdef MUDUO_HAVE_TSC
+/// 不变的TSC: 频率恒定(constant_tsc), 深度睡眠时不停(nonstop_tsc)
+bool invariantTsc()
+{
+  string cpuinfo;
+  FileUtil::readFile("/proc/cpuinfo", 64*1024, &cpuinfo);
+  size_t flags = cpuinfo.find("\nflags");
+  if (flags == string::npos)
+  {
+    return false;
+  }
+  string line = cpuinfo.substr(flags, cpuinfo.find('\n', flags + 1) - flags);
+  line += ' ';
+  return line.find(" constant_tsc ") != string::npos
+      && line.find(" nonstop_tsc ") != string::npos;
+}
+#endif
+
+struct Calibration
+{
+  Calibration()
+    : useTsc(false),
+      nanosPerTick(0),
+      baseTicks(0),
+      baseNanos(0)
+  {
+#ifdef MUDUO_HAVE_TSC
+    if (::getenv("MUDUO_NO_TSC") || !invariantTsc())
+    {
+      return;
+    }
+    const int64_t kCalibrationNs = 10 * 1000 * 1000;
+    int64_t startNanos = monotonicNanoseconds();
+    uint64_t startTicks = __rdtsc();
+    int64_t endNanos = startNanos;
+    while (endNanos - startNanos < kCalibrationNs)
+    {
+      endNanos = monotonicNanoseconds();
+    }
+    uint64_t endTicks = __rdtsc();
+    double ghz = static_cast<double>(endTicks - startTicks)
+               / static_cast<double>(endNanos - startNanos);
+    // a TSC slower than 100MHz is not worth it
+    if (ghz < 0.1)
+    {
+      return;
+    }
+    useTsc = true;
+    nanosPerTick = 1.0 / ghz;
+    baseTicks = endTicks;
+    baseNanos = endNanos;
+#endif
+  }
+
+  bool useTsc;
+  double nanosPerTick;
+  uint64_t baseTicks;
+  int64_t baseNanos;
+};
+
+const Calibration& calibration()
+{
+  static Calibration c;
+  return c;
+}
+
+}  // namespace
+
+int64_t TscClock::nanoseconds()
+{
+  const Calibration& c = calibration();
+#ifdef MUDUO_HAVE_TSC
+  if (c.useTsc)
+  {
+    int64_t ticks = static_cast<int64_t>(__rdtsc() - c.baseTicks);
+    return c.baseNanos + static_cast<int64_t>(static_cast<double>(ticks) * c.nanosPerTick);
+  }
+#endif
+  return monotonicNanoseconds();
+}
+
+bool TscClock::usingTsc()
+{
+  return calibration().useTsc;
+}
+
+double TscClock::ticksPerNanosecond()
+{
+  const Calibration& c = calibration();
+  return c.useTsc ? 1.0 / c.nanosPerTick : 0.0;
+}
@@ -0,0 +1,39 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_TSCCLOCK_H
+#define MUDUO_BASE_TSCCLOCK_H
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Nanosecond clock for hot path instrumentation, reads the TSC of x86 CPUs
+/// and scales it to CLOCK_MONOTONIC. The scale is measured once, so the two
+/// drift apart slowly (some ppm), compare readings of this clock only.
+///
+/// Calibrates once, on first use, for about 10ms. Falls back to
+/// clock_gettime(CLOCK_MONOTONIC) if the TSC is not invariant
+/// (no constant_tsc and nonstop_tsc in /proc/cpuinfo), not on x86,
+/// or if MUDUO_NO_TSC is set in the environment.
+///
+/// Thread safe. Not related to wall time, only differences make sense.
+namespace TscClock
+{
+  /// nanoseconds on the CLOCK_MONOTONIC scale
+  int64_t nanoseconds();
+
+  /// whether nanoseconds() reads the TSC
+  bool usingTsc();
+
+  /// 0 if not using TSC
+  double ticksPerNanosecond();
+}
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_TSCCLOCK_H
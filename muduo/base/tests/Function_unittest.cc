@@ -0,0 +1,187 @@
+// the checks are asserts, keep them in release builds
+#undef NDEBUG
+
+#include "muduo/base/Function.h"
+#include "muduo/base/Types.h"
+
+#include <functional>
+#include <memory>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using muduo::Function;
+using muduo::string;
+
+int g_allocations = 0;
+
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = malloc(size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+int g_calls = 0;
+int g_alive = 0;
+
+class Connection
+{
+ public:
+  void send(const string& message) { g_calls += static_cast<int>(message.size()); }
+};
+
+struct MoveOnly
+{
+  explicit MoveOnly(int x) : value(new int(x)) { ++g_alive; }
+  MoveOnly(MoveOnly&& rhs) noexcept : value(std::move(rhs.value)) { ++g_alive; }
+  ~MoveOnly() { --g_alive; }
+  void operator()() { g_calls += *value; }
+
+  std::unique_ptr<int> value;
+};
+
+struct Big
+{
+  Big() { ++g_alive; }
+  Big(const Big&) { ++g_alive; }
+  ~Big() { --g_alive; }
+  void operator()() { ++g_calls; }
+  char data[128];
+};
+
+void free_function()
+{
+  ++g_calls;
+}
+
+int add(int a, int b)
+{
+  return a + b;
+}
+
+void testInline()
+{
+  Connection conn;
+  string message(100, 'x');
+  void (Connection::*fp)(const string&) = &Connection::send;
+
+  int before = g_allocations;
+  std::function<void()> stdf(std::bind(fp, &conn, std::move(message)));
+  int stdAllocations = g_allocations - before;
+
+  string message2(100, 'y');
+  before = g_allocations;
+  Function<void()> f(std::bind(fp, &conn, std::move(message2)));
+  int allocations = g_allocations - before;
+  printf("bind(member, this, string): std::function %d allocation(s), muduo::Function %d\n",
+         stdAllocations, allocations);
+  assert(stdAllocations == 1);
+  assert(allocations == 0);
+  assert(f.isInline());
+
+  g_calls = 0;
+  Function<void()> f2(std::move(f));
+  assert(!f);
+  f2();
+  assert(g_calls == 100);
+  (void) stdf;
+}
+
+void testMoveOnly()
+{
+  g_calls = 0;
+  {
+    Function<void()> f(MoveOnly(42));
+    assert(f.isInline());
+    assert(g_alive == 1);
+    Function<void()> f2;
+    f2 = std::move(f);
+    assert(g_alive == 1);
+    f2();
+    assert(g_calls == 42);
+  }
+  assert(g_alive == 0);
+}
+
+void testHeap()
+{
+  g_calls = 0;
+  {
+    int before = g_allocations;
+    Function<void()> f(Big{});
+    assert(g_allocations - before == 1);
+    assert(!f.isInline());
+    Function<void()> f2(std::move(f));
+    assert(g_allocations - before == 1);  // moving a heap functor moves the pointer
+    f2();
+    assert(g_calls == 1);
+  }
+  assert(g_alive == 0);
+}
+
+void testMisc()
+{
+  Function<void()> empty;
+  assert(!empty);
+  Function<void()> fromNull(static_cast<void (*)()>(NULL));
+  assert(!fromNull);
+  Function<void()> fromEmptyStd{std::function<void()>()};
+  assert(!fromEmptyStd);
+
+  g_calls = 0;
+  Function<void()> fp(free_function);
+  fp();
+  assert(g_calls == 1);
+
+  Function<int (int, int)> sum(add);
+  assert(sum(1, 2) == 3);
+  sum = [](int a, int b) { return a * b; };
+  assert(sum(3, 4) == 12);
+
+  Function<void()> a(free_function);
+  Function<void()> b(MoveOnly(7));
+  a.swap(b);
+  g_calls = 0;
+  a();
+  b();
+  assert(g_calls == 8);
+  a = nullptr;
+  assert(!a);
+
+  bool thrown = false;
+  try
+  {
+    empty();
+  }
+  catch (const std::bad_function_call&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+int main()
+{
+  testInline();
+  testMoveOnly();
+  testHeap();
+  testMisc();
+  printf("sizeof(Function<void()>) = %zd, sizeof(std::function<void()>) = %zd\n",
+         sizeof(Function<void()>), sizeof(std::function<void()>));
+}
@@ -0,0 +1,107 @@
+#include "muduo/base/TscClock.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Timestamp.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace muduo;
+
+int64_t monotonic()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+template<typename Func>
+double nanosPerCall(Func func)
+{
+  const int kNumber = 1000*1000;
+  int64_t start = monotonic();
+  for (int i = 0; i < kNumber; ++i)
+  {
+    func();
+  }
+  return static_cast<double>(monotonic() - start) / kNumber;
+}
+
+void testTsc()
+{
+  printf("using tsc %d, %.3f GHz\n", TscClock::usingTsc(), TscClock::ticksPerNanosecond());
+  int64_t last = TscClock::nanoseconds();
+  int backwards = 0;
+  for (int i = 0; i < 1000*1000; ++i)
+  {
+    int64_t next = TscClock::nanoseconds();
+    if (next < last)
+    {
+      ++backwards;
+    }
+    last = next;
+  }
+  printf("went backwards %d times\n", backwards);
+  assert(backwards == 0);
+
+  // stays on the CLOCK_MONOTONIC scale
+  int64_t tsc = TscClock::nanoseconds();
+  int64_t mono = monotonic();
+  printf("tsc - monotonic = %lld ns\n", static_cast<long long>(tsc - mono));
+  assert(llabs(tsc - mono) < 1000 * 1000);
+
+  struct timespec sleep = { 0, 50 * 1000 * 1000 };
+  int64_t tscStart = TscClock::nanoseconds();
+  int64_t monoStart = monotonic();
+  nanosleep(&sleep, NULL);
+  int64_t tscElapsed = TscClock::nanoseconds() - tscStart;
+  int64_t monoElapsed = monotonic() - monoStart;
+  printf("50ms sleep: tsc %lld ns, monotonic %lld ns\n",
+         static_cast<long long>(tscElapsed), static_cast<long long>(monoElapsed));
+  assert(llabs(tscElapsed - monoElapsed) < monoElapsed / 1000 + 20 * 1000);
+}
+
+void testCoarse()
+{
+  Timestamp coarse(Timestamp::coarseNow());
+  Timestamp now(Timestamp::now());
+  printf("now - coarse = %.0f us\n", timeDifference(now, coarse) * 1e6);
+  assert(coarse <= now);
+  assert(timeDifference(now, coarse) < 0.02);
+}
+
+string g_logged;
+
+void captureOutput(const char* msg, int len)
+{
+  g_logged.assign(msg, len);
+}
+
+Timestamp fixedClock()
+{
+  // 2001-09-09 01:46:40 UTC
+  return Timestamp::fromUnixTime(1000 * 1000 * 1000, 123456);
+}
+
+void testLoggerClock()
+{
+  Logger::setOutput(captureOutput);
+  Logger::setClock(fixedClock);
+  LOG_INFO << "hello";
+  Logger::setClock(Timestamp::now);
+  printf("%s", g_logged.c_str());
+  assert(strncmp(g_logged.c_str(), "20010909 01:46:40.123456", 24) == 0);
+}
+
+int main()
+{
+  testTsc();
+  testCoarse();
+  testLoggerClock();
+
+  printf("Timestamp::now       %6.1f ns\n", nanosPerCall(Timestamp::now));
+  printf("Timestamp::coarseNow %6.1f ns\n", nanosPerCall(Timestamp::coarseNow));
+  printf("TscClock::nanoseconds%6.1f ns\n", nanosPerCall(TscClock::nanoseconds));
+}
@@ -15,13 +15,45 @@
 
 #include <errno.h>
 #include <fcntl.h>
-//#include <sys/types.h>
-//#include <sys/stat.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+/// 只删除没人监听的socket文件, 其他的留给bind报错
+void removeStaleUnixSocket(const InetAddress& listenAddr, const string& path)
+{
+  struct stat st;
+  if (::lstat(path.c_str(), &st) < 0)
+  {
+    return;
+  }
+  if (!S_ISSOCK(st.st_mode))
+  {
+    LOG_ERROR << "Acceptor - " << path << " exists and is not a socket";
+    return;
+  }
+  int sockfd = sockets::createNonblockingOrDie(AF_UNIX);
+  int ret = sockets::connect(sockfd, listenAddr.getSockAddr());
+  int savedErrno = ret < 0 ? errno : 0;
+  sockets::close(sockfd);
+  if (savedErrno == ECONNREFUSED)
+  {
+    LOG_INFO << "Acceptor - removing stale socket " << path;
+    ::unlink(path.c_str());
+  }
+  else
+  {
+    LOG_ERROR << "Acceptor - " << path << " is in use";
+  }
+}
+
+}  // namespace
+
 /// 初始化包括两部分, 服务端socket有两种，(1)建立服务端监听socket
 /// (2) 设置服务端连接channel, 并设置可读回调函数。一旦监听到socket，可读，即调用回调函数
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport)
@@ -30,17 +62,57 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),
     acceptChannel_(loop, acceptSocket_.fd()),
     listening_(false),
-    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    unixDev_(0),
+    unixIno_(0)
 {
   assert(idleFd_ >= 0);
   acceptSocket_.setReuseAddr(true);
   acceptSocket_.setReusePort(reuseport);
+  string path;
+  if (listenAddr.isUnixDomain())
+  {
+    path = listenAddr.toIp();
+    if (!path.empty() && path[0] != '@')
+    {
+      // SO_REUSEADDR does not apply to a path left by the last run
+      removeStaleUnixSocket(listenAddr, path);
+    }
+    else
+    {
+      path.clear();
+    }
+  }
 
   //// 监听地址
   acceptSocket_.bindAddress(listenAddr);
+  struct stat st;
+  if (!path.empty() && ::lstat(path.c_str(), &st) == 0)
+  {
+    /// 记下绑定的inode, 析构时路径已被别人替换就不删
+    unixPath_ = path;
+    unixDev_ = st.st_dev;
+    unixIno_ = st.st_ino;
+  }
   // 该通道可读的回调函数,loop中调用。一旦该通道可读即调用
   acceptChannel_.setReadCallback(
       std::bind(&Acceptor::handleRead, this));
+  acceptChannel_.setHighPriority(true);
+}
+
+Acceptor::Acceptor(EventLoop* loop, int listenfd)
+  : loop_(loop),
+    acceptSocket_(listenfd),
+    acceptChannel_(loop, acceptSocket_.fd()),
+    listening_(false),
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    unixDev_(0),
+    unixIno_(0)
+{
+  assert(idleFd_ >= 0);
+  acceptChannel_.setReadCallback(
+      std::bind(&Acceptor::handleRead, this));
+  acceptChannel_.setHighPriority(true);
 }
 
 Acceptor::~Acceptor()
@@ -48,6 +120,13 @@ Acceptor::~Acceptor()
   acceptChannel_.disableAll();
   acceptChannel_.remove();
   ::close(idleFd_);
+  struct stat st;
+  if (!unixPath_.empty()
+      && ::lstat(unixPath_.c_str(), &st) == 0
+      && st.st_dev == unixDev_ && st.st_ino == unixIno_)
+  {
+    ::unlink(unixPath_.c_str());
+  }
 }
 
 /// 监听客户端socket
@@ -64,6 +143,24 @@ void Acceptor::listen()
   acceptChannel_.enableReading(); 
 }
 
+void Acceptor::pause()
+{
+  loop_->assertInLoopThread();
+  if (acceptChannel_.isReading())
+  {
+    acceptChannel_.disableReading();
+  }
+}
+
+void Acceptor::resume()
+{
+  loop_->assertInLoopThread();
+  if (listening_ && !acceptChannel_.isReading())
+  {
+    acceptChannel_.enableReading();
+  }
+}
+
 /// 可读回调函数，建立连接。一旦poller到acceptChannel_活跃，会执行该回调函数
 void Acceptor::handleRead()
 {
@@ -86,7 +183,7 @@ void Acceptor::handleRead()
       sockets::close(connfd);
     }
   }
-  else
+  else if (errno != EAGAIN)
   {
     LOG_SYSERR << "in Acceptor::handleRead";
     // Read the section named "The special problem of
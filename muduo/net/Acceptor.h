@@ -13,6 +13,8 @@
 
 #include <functional>
 
+#include <sys/types.h>
+
 #include "muduo/net/Channel.h"
 #include "muduo/net/Socket.h"
 
@@ -34,6 +36,8 @@ class Acceptor : noncopyable
   typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
+  /// Takes over a bound socket, eg. inherited from a PreforkServer master.
+  Acceptor(EventLoop* loop, int listenfd);
   ~Acceptor();
 
   /// 设置连接回调函数, 对于服务端, 接受连接之后封装连接为connection
@@ -45,6 +49,16 @@ class Acceptor : noncopyable
 
   bool listening() const { return listening_; }
 
+  /// Stops accepting, connections wait in the listen backlog.
+  void pause();
+  void resume();
+  bool paused() const { return listening_ && !acceptChannel_.isReading(); }
+
+  /// Inherited by accepted sockets, see Socket::setRecvTimestamps().
+  void setRecvTimestamps(bool on) { acceptSocket_.setRecvTimestamps(on); }
+  /// See Socket::setTcpFastOpen().
+  void setFastOpen(int queueLength) { acceptSocket_.setTcpFastOpen(queueLength); }
+
  private:
   void handleRead();
 
@@ -57,6 +71,10 @@ class Acceptor : noncopyable
   NewConnectionCallback newConnectionCallback_;
   bool listening_;
   int idleFd_;
+  /// 文件系统中的Unix domain socket路径, 析构时还是自己绑定的就删除
+  string unixPath_;
+  dev_t unixDev_;
+  ino_t unixIno_;
 };
 
 }  // namespace net
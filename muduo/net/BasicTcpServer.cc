@@ -0,0 +1,130 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/BasicTcpServer.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/net/Acceptor.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+class BasicServerCore::Impl
+{
+ public:
+  Impl(EventLoop* loop, Acceptor* acceptorArg, const string& name)
+    : acceptor(acceptorArg),
+      threadPool(new EventLoopThreadPool(loop, name))
+  {
+  }
+
+  std::unique_ptr<Acceptor> acceptor;
+  std::unique_ptr<EventLoopThreadPool> threadPool;
+  AtomicInt32 started;
+};
+
+BasicServerCore::BasicServerCore(EventLoop* loop,
+                                 const InetAddress& listenAddr,
+                                 const string& nameArg,
+                                 bool reusePort)
+  : loop_(loop),
+    ipPort_(listenAddr.toIpPort()),
+    name_(nameArg),
+    impl_(new Impl(loop, new Acceptor(loop, listenAddr, reusePort), name_)),
+    nextConnId_(1)
+{
+}
+
+BasicServerCore::~BasicServerCore() = default;
+
+void BasicServerCore::setNewConnectionCallback(const NewConnectionCallback& cb)
+{
+  impl_->acceptor->setNewConnectionCallback(cb);
+}
+
+void BasicServerCore::setThreadNum(int numThreads)
+{
+  impl_->threadPool->setThreadNum(numThreads);
+}
+
+void BasicServerCore::start()
+{
+  if (impl_->started.getAndSet(1) == 0)
+  {
+    impl_->threadPool->start();
+
+    assert(!impl_->acceptor->listening());
+    loop_->runInLoop(
+        std::bind(&Acceptor::listen, get_pointer(impl_->acceptor)));
+  }
+}
+
+EventLoop* BasicServerCore::getNextLoop()
+{
+  return impl_->threadPool->getNextLoop();
+}
+
+string BasicServerCore::newConnectionName(const InetAddress& peerAddr)
+{
+  loop_->assertInLoopThread();
+  char buf[64];
+  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
+  ++nextConnId_;
+  string connName = name_ + buf;
+
+  LOG_INFO << "BasicTcpServer::newConnection [" << name_
+           << "] - new connection [" << connName
+           << "] from " << peerAddr.toIpPort();
+  return connName;
+}
+
+ssize_t writeSocket(int sockfd, const void* data, size_t len)
+{
+  return sockets::write(sockfd, data, len);
+}
+
+void shutdownWrite(int sockfd)
+{
+  sockets::shutdownWrite(sockfd);
+}
+
+void closeSocket(int sockfd)
+{
+  sockets::close(sockfd);
+}
+
+void setTcpNoDelay(int sockfd, bool on)
+{
+  int optval = on ? 1 : 0;
+  ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY,
+               &optval, static_cast<socklen_t>(sizeof optval));
+}
+
+InetAddress localAddress(int sockfd)
+{
+  return InetAddress(sockets::getLocalAddr(sockfd));
+}
+
+void logSocketError(const string& connName, int sockfd)
+{
+  int err = sockets::getSocketError(sockfd);
+  LOG_ERROR << "BasicTcpConnection::handleError [" << connName
+            << "] - SO_ERROR = " << err << " " << strerror_tl(err);
+}
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
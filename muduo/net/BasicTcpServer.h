@@ -0,0 +1,562 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_BASICTCPSERVER_H
+#define MUDUO_NET_BASICTCPSERVER_H
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/Callbacks.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+
+#include <map>
+#include <memory>
+
+#include <errno.h>
+
+namespace muduo
+{
+namespace net
+{
+
+template <typename Handler> class BasicTcpServer;
+
+namespace detail
+{
+
+/// The part of BasicTcpServer that doesn't depend on the handler,
+/// accepts connections and picks their loops.
+class BasicServerCore : noncopyable
+{
+ public:
+  typedef std::function<void (int sockfd, const InetAddress& peerAddr)> NewConnectionCallback;
+
+  BasicServerCore(EventLoop* loop,
+                  const InetAddress& listenAddr,
+                  const string& nameArg,
+                  bool reusePort);
+  ~BasicServerCore();  // force out-line dtor, for std::unique_ptr members.
+
+  const string& ipPort() const { return ipPort_; }
+  const string& name() const { return name_; }
+
+  void setNewConnectionCallback(const NewConnectionCallback& cb);
+  void setThreadNum(int numThreads);
+  void start();
+
+  /// In loop, for a new connection
+  EventLoop* getNextLoop();
+  string newConnectionName(const InetAddress& peerAddr);
+
+ private:
+  class Impl;
+  EventLoop* loop_;
+  const string ipPort_;
+  const string name_;
+  std::unique_ptr<Impl> impl_;
+  int nextConnId_;
+};
+
+/// sockets:: for the template, SocketsOps.h is not public
+ssize_t writeSocket(int sockfd, const void* data, size_t len);
+void shutdownWrite(int sockfd);
+void closeSocket(int sockfd);
+void setTcpNoDelay(int sockfd, bool on);
+InetAddress localAddress(int sockfd);
+void logSocketError(const string& connName, int sockfd);
+
+}  // namespace detail
+
+///
+/// Base of BasicTcpServer handlers, defaults for the optional hooks.
+///
+/// A handler provides, as plain member functions:
+/// @code
+/// struct State { ... };  // per connection, default constructed
+/// void onMessage(BasicTcpConnection<MyHandler>& conn, Buffer* buf, Timestamp receiveTime);
+/// void onConnection(BasicTcpConnection<MyHandler>& conn);     // optional, up and down
+/// void onWriteComplete(BasicTcpConnection<MyHandler>& conn);  // with kWriteComplete
+/// @endcode
+/// One handler serves all connections, from all IO threads.
+struct BasicHandler
+{
+  struct State
+  {
+  };
+
+  /// Same as TcpServer::setWriteCompleteCallback(), off by default as it
+  /// costs a queued functor per send() that writes everything at once.
+  static const bool kWriteComplete = false;
+
+  template <typename Connection>
+  void onConnection(Connection&)
+  {
+  }
+
+  template <typename Connection>
+  void onWriteComplete(Connection&)
+  {
+  }
+};
+
+///
+/// TCP connection of a BasicTcpServer, calls the hooks of @c Handler
+/// directly, so they can be inlined.
+///
+/// Keeps the basics of TcpConnection only, no transport, cork, rate limit,
+/// high water mark or migration, use TcpServer for those.
+template <typename Handler>
+class BasicTcpConnection : noncopyable,
+                           public std::enable_shared_from_this<BasicTcpConnection<Handler>>
+{
+ public:
+  typedef typename Handler::State State;
+
+  BasicTcpConnection(EventLoop* loop,
+                     const string& nameArg,
+                     int sockfd,
+                     const InetAddress& localAddr,
+                     const InetAddress& peerAddr,
+                     Handler* handler)
+    : loop_(CHECK_NOTNULL(loop)),
+      name_(nameArg),
+      state_(kConnecting),
+      channel_(loop, sockfd),
+      localAddr_(localAddr),
+      peerAddr_(peerAddr),
+      handler_(handler)
+  {
+    channel_.setReadCallback(
+        std::bind(&BasicTcpConnection::handleRead, this, _1));
+    channel_.setWriteCallback(
+        std::bind(&BasicTcpConnection::handleWrite, this));
+    channel_.setCloseCallback(
+        std::bind(&BasicTcpConnection::handleClose, this));
+    channel_.setErrorCallback(
+        std::bind(&BasicTcpConnection::handleError, this));
+    LOG_DEBUG << "BasicTcpConnection::ctor[" << name_ << "] at " << this
+              << " fd=" << sockfd;
+  }
+
+  ~BasicTcpConnection()
+  {
+    LOG_DEBUG << "BasicTcpConnection::dtor[" << name_ << "] at " << this
+              << " fd=" << channel_.fd();
+    assert(state_ == kDisconnected);
+    detail::closeSocket(channel_.fd());
+  }
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+  const InetAddress& localAddress() const { return localAddr_; }
+  const InetAddress& peerAddress() const { return peerAddr_; }
+  bool connected() const { return state_ == kConnected; }
+  bool disconnected() const { return state_ == kDisconnected; }
+
+  /// Handler::State of this connection, in place of TcpConnection::getContext().
+  /// In loop thread.
+  State& context() { return context_; }
+  const State& context() const { return context_; }
+
+  // Thread safe, like TcpConnection::send().
+  void send(const void* data, int len)
+  {
+    send(StringPiece(static_cast<const char*>(data), len));
+  }
+
+  void send(const StringPiece& message)
+  {
+    if (state_ == kConnected)
+    {
+      if (loop_->isInLoopThread())
+      {
+        sendInLoop(message.data(), static_cast<size_t>(message.size()));
+      }
+      else
+      {
+        loop_->runInLoop(
+            std::bind(&BasicTcpConnection::sendString, this->shared_from_this(),
+                      message.as_string()));
+      }
+    }
+  }
+
+  void send(Buffer* buf)
+  {
+    if (state_ == kConnected)
+    {
+      if (loop_->isInLoopThread())
+      {
+        sendInLoop(buf->peek(), buf->readableBytes());
+        buf->retrieveAll();
+      }
+      else
+      {
+        loop_->runInLoop(
+            std::bind(&BasicTcpConnection::sendString, this->shared_from_this(),
+                      buf->retrieveAllAsString()));
+      }
+    }
+  }
+
+  void shutdown()
+  {
+    if (state_ == kConnected)
+    {
+      state_ = kDisconnecting;
+      loop_->runInLoop(
+          std::bind(&BasicTcpConnection::shutdownInLoop, this->shared_from_this()));
+    }
+  }
+
+  void forceClose()
+  {
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+      state_ = kDisconnecting;
+      loop_->queueInLoop(
+          std::bind(&BasicTcpConnection::forceCloseInLoop, this->shared_from_this()));
+    }
+  }
+
+  void setTcpNoDelay(bool on) { detail::setTcpNoDelay(channel_.fd(), on); }
+
+  Buffer* inputBuffer() { return &inputBuffer_; }
+  Buffer* outputBuffer() { return &outputBuffer_; }
+
+ private:
+  enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+  typedef std::shared_ptr<BasicTcpConnection> Ptr;
+  typedef std::function<void (const Ptr&)> CloseCallback;
+  friend class BasicTcpServer<Handler>;
+
+  /// Internal use only, by BasicTcpServer
+  void setCloseCallback(const CloseCallback& cb) { closeCallback_ = cb; }
+
+  void connectEstablished()
+  {
+    loop_->assertInLoopThread();
+    assert(state_ == kConnecting);
+    state_ = kConnected;
+    channel_.tie(this->shared_from_this());
+    channel_.enableReading();
+    handler_->onConnection(*this);
+  }
+
+  void connectDestroyed()
+  {
+    loop_->assertInLoopThread();
+    if (state_ == kConnected)
+    {
+      state_ = kDisconnected;
+      channel_.disableAll();
+      handler_->onConnection(*this);
+    }
+    channel_.remove();
+  }
+
+  void handleRead(Timestamp receiveTime)
+  {
+    loop_->assertInLoopThread();
+    int savedErrno = 0;
+    ssize_t n = 0;
+    size_t budget = loop_->readBudget();
+    if (budget > 0)
+    {
+      n = inputBuffer_.readFd(channel_.fd(), &savedErrno, NULL, budget);
+      channel_.setOverBudget(n > 0 && static_cast<size_t>(n) >= budget);
+    }
+    else
+    {
+      n = inputBuffer_.readFd(channel_.fd(), &savedErrno);
+    }
+    if (n > 0)
+    {
+      handler_->onMessage(*this, &inputBuffer_, receiveTime);
+    }
+    else if (n == 0)
+    {
+      handleClose();
+    }
+    else
+    {
+      errno = savedErrno;
+      LOG_SYSERR << "BasicTcpConnection::handleRead";
+      handleError();
+    }
+  }
+
+  void handleWrite()
+  {
+    loop_->assertInLoopThread();
+    if (channel_.isWriting())
+    {
+      ssize_t n = detail::writeSocket(channel_.fd(),
+                                      outputBuffer_.peek(),
+                                      outputBuffer_.readableBytes());
+      if (n > 0)
+      {
+        outputBuffer_.retrieve(static_cast<size_t>(n));
+        if (outputBuffer_.readableBytes() == 0)
+        {
+          channel_.disableWriting();
+          if (Handler::kWriteComplete)
+          {
+            handler_->onWriteComplete(*this);
+          }
+          if (state_ == kDisconnecting)
+          {
+            shutdownInLoop();
+          }
+        }
+      }
+      else if (errno != EWOULDBLOCK)
+      {
+        LOG_SYSERR << "BasicTcpConnection::handleWrite";
+      }
+    }
+    else
+    {
+      LOG_TRACE << "Connection fd = " << channel_.fd()
+                << " is down, no more writing";
+    }
+  }
+
+  void handleClose()
+  {
+    loop_->assertInLoopThread();
+    assert(state_ == kConnected || state_ == kDisconnecting);
+    // we don't close fd, leave it to dtor
+    state_ = kDisconnected;
+    channel_.disableAll();
+
+    Ptr guardThis(this->shared_from_this());
+    handler_->onConnection(*this);
+    // must be the last line
+    closeCallback_(guardThis);
+  }
+
+  void handleError()
+  {
+    detail::logSocketError(name_, channel_.fd());
+  }
+
+  void sendString(const string& message)
+  {
+    sendInLoop(message.data(), message.size());
+  }
+
+  void sendInLoop(const void* data, size_t len)
+  {
+    loop_->assertInLoopThread();
+    ssize_t nwrote = 0;
+    size_t remaining = len;
+    bool faultError = false;
+    if (state_ == kDisconnected)
+    {
+      LOG_WARN << "disconnected, give up writing";
+      return;
+    }
+    // if nothing in output queue, try writing directly
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0)
+    {
+      nwrote = detail::writeSocket(channel_.fd(), data, len);
+      if (nwrote >= 0)
+      {
+        remaining = len - static_cast<size_t>(nwrote);
+        if (remaining == 0 && Handler::kWriteComplete)
+        {
+          loop_->queueInLoop(
+              std::bind(&BasicTcpConnection::writeComplete, this->shared_from_this()));
+        }
+      }
+      else
+      {
+        nwrote = 0;
+        if (errno != EWOULDBLOCK)
+        {
+          LOG_SYSERR << "BasicTcpConnection::sendInLoop";
+          if (errno == EPIPE || errno == ECONNRESET)
+          {
+            faultError = true;
+          }
+        }
+      }
+    }
+
+    assert(remaining <= len);
+    if (!faultError && remaining > 0)
+    {
+      outputBuffer_.append(static_cast<const char*>(data) + nwrote, remaining);
+      if (!channel_.isWriting())
+      {
+        channel_.enableWriting();
+      }
+    }
+  }
+
+  void writeComplete()
+  {
+    handler_->onWriteComplete(*this);
+  }
+
+  void shutdownInLoop()
+  {
+    loop_->assertInLoopThread();
+    if (!channel_.isWriting())
+    {
+      // we are not writing
+      detail::shutdownWrite(channel_.fd());
+    }
+  }
+
+  void forceCloseInLoop()
+  {
+    loop_->assertInLoopThread();
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+      // as if we received 0 byte in handleRead();
+      handleClose();
+    }
+  }
+
+  EventLoop* loop_;
+  const string name_;
+  StateE state_;  // FIXME: use atomic variable
+  Channel channel_;
+  const InetAddress localAddr_;
+  const InetAddress peerAddr_;
+  Handler* handler_;
+  CloseCallback closeCallback_;
+  Buffer inputBuffer_;
+  Buffer outputBuffer_;
+  State context_;
+};
+
+///
+/// TCP server whose handler type is known at compile time, see BasicHandler.
+///
+/// TcpServer goes through a std::function and a TcpConnectionPtr copy for
+/// every message, and boost::any for per-connection data. Here the handler
+/// is called directly with the connection, whose State is a plain member.
+/// Single-threaded and thread-pool models, like TcpServer.
+template <typename Handler>
+class BasicTcpServer : noncopyable
+{
+ public:
+  typedef BasicTcpConnection<Handler> Connection;
+  typedef std::shared_ptr<Connection> ConnectionPtr;
+  enum Option
+  {
+    kNoReusePort,
+    kReusePort,
+  };
+
+  /// The handler is default constructed, set it up with handler().
+  BasicTcpServer(EventLoop* loop,
+                 const InetAddress& listenAddr,
+                 const string& nameArg,
+                 Option option = kNoReusePort)
+    : loop_(CHECK_NOTNULL(loop)),
+      core_(new detail::BasicServerCore(loop, listenAddr, nameArg, option == kReusePort))
+  {
+    core_->setNewConnectionCallback(
+        std::bind(&BasicTcpServer::newConnection, this, _1, _2));
+  }
+
+  ~BasicTcpServer()
+  {
+    loop_->assertInLoopThread();
+    LOG_TRACE << "BasicTcpServer::~BasicTcpServer [" << name() << "] destructing";
+
+    for (auto& item : connections_)
+    {
+      ConnectionPtr conn(item.second);
+      item.second.reset();
+      conn->getLoop()->runInLoop(
+          std::bind(&Connection::connectDestroyed, conn));
+    }
+  }
+
+  const string& ipPort() const { return core_->ipPort(); }
+  const string& name() const { return core_->name(); }
+  EventLoop* getLoop() const { return loop_; }
+  /// Shared by all IO threads. Not thread safe, set up before @c start
+  Handler& handler() { return handler_; }
+
+  /// See TcpServer::setThreadNum(). Must be called before @c start
+  void setThreadNum(int numThreads)
+  {
+    assert(0 <= numThreads);
+    core_->setThreadNum(numThreads);
+  }
+
+  /// Starts the server if it's not listening.
+  ///
+  /// It's harmless to call it multiple times.
+  /// Thread safe.
+  void start() { core_->start(); }
+
+  /// In loop thread.
+  size_t numConnections() const { return connections_.size(); }
+
+ private:
+  typedef std::map<string, ConnectionPtr> ConnectionMap;
+
+  /// Not thread safe, but in loop
+  void newConnection(int sockfd, const InetAddress& peerAddr)
+  {
+    loop_->assertInLoopThread();
+    EventLoop* ioLoop = core_->getNextLoop();
+    string connName = core_->newConnectionName(peerAddr);
+    ConnectionPtr conn(new Connection(ioLoop,
+                                      connName,
+                                      sockfd,
+                                      detail::localAddress(sockfd),
+                                      peerAddr,
+                                      &handler_));
+    connections_[connName] = conn;
+    conn->setCloseCallback(
+        std::bind(&BasicTcpServer::removeConnection, this, _1)); // FIXME: unsafe
+    ioLoop->runInLoop(std::bind(&Connection::connectEstablished, conn));
+  }
+
+  /// Thread safe.
+  void removeConnection(const ConnectionPtr& conn)
+  {
+    // FIXME: unsafe
+    loop_->runInLoop(std::bind(&BasicTcpServer::removeConnectionInLoop, this, conn));
+  }
+
+  /// Not thread safe, but in loop
+  void removeConnectionInLoop(const ConnectionPtr& conn)
+  {
+    loop_->assertInLoopThread();
+    LOG_INFO << "BasicTcpServer::removeConnectionInLoop [" << name()
+             << "] - connection " << conn->name();
+    size_t n = connections_.erase(conn->name());
+    (void)n;
+    assert(n == 1);
+    EventLoop* ioLoop = conn->getLoop();
+    ioLoop->queueInLoop(
+        std::bind(&Connection::connectDestroyed, conn));
+  }
+
+  EventLoop* loop_;  // the acceptor loop
+  // declared before core_, IO threads are joined before it goes
+  Handler handler_;
+  std::unique_ptr<detail::BasicServerCore> core_;
+  // always in loop thread
+  ConnectionMap connections_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BASICTCPSERVER_H
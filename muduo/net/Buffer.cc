@@ -11,8 +11,12 @@
 
 #include "muduo/net/SocketsOps.h"
 
+#include <algorithm>
+
 #include <errno.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
+#include <time.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -23,25 +27,88 @@ const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
 
+namespace
+{
+
+/// 读到buffer的可写空间, 不够时再读到栈上的extrabuf, 总共不超过maxBytes(0为不限)
+int setupIovec(struct iovec* vec, char* writeBegin, size_t writable,
+               char* extrabuf, size_t extraSize, size_t maxBytes)
+{
+  vec[0].iov_base = writeBegin;
+  if (maxBytes > 0 && maxBytes <= writable)
+  {
+    vec[0].iov_len = maxBytes;
+    return 1;
+  }
+  vec[0].iov_len = writable;
+  vec[1].iov_base = extrabuf;
+  vec[1].iov_len = maxBytes > 0 ? std::min(extraSize, maxBytes - writable) : extraSize;
+  // when there is enough space in this buffer, don't read into extrabuf.
+  // when extrabuf is used, we read 128k-1 bytes at most.
+  return (writable < extraSize) ? 2 : 1;
+}
+
+}  // namespace
+
 /// 读取fd的数据到Buff中
 /// 注意这里是client写inputbuffer, inputbuffer client写, outbuffer ser
 ssize_t Buffer::readFd(int fd, int* savedErrno)
+{
+  return readFd(fd, savedErrno, NULL, 0);
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, Timestamp* receiveTime)
+{
+  return readFd(fd, savedErrno, receiveTime, 0);
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, Timestamp* receiveTime, size_t maxBytes)
 {
   // saved an ioctl()/FIONREAD call to tell how much to read
   char extrabuf[65536];
   struct iovec vec[2];
   const size_t writable = writableBytes();
+  const int iovcnt = setupIovec(vec, begin()+writerIndex_, writable,
+                                extrabuf, sizeof extrabuf, maxBytes);
+  if (receiveTime == NULL)
+  {
+    const ssize_t n = sockets::readv(fd, vec, iovcnt);
+    return commitRead(n, writable, extrabuf, savedErrno);
+  }
 
-  /// 设置一些读取指针
-  vec[0].iov_base = begin()+writerIndex_; /// 可写地址
-  vec[0].iov_len = writable;  /// 可写空间
-  vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof extrabuf;
-  // when there is enough space in this buffer, don't read into extrabuf.
-  // when extrabuf is used, we read 128k-1 bytes at most.
-  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
-  const ssize_t n = sockets::readv(fd, vec, iovcnt);
+  // SCM_TIMESTAMPING carries three timespecs, software time is the first
+  char control[CMSG_SPACE(3 * sizeof(struct timespec))];
+  struct msghdr msg;
+  memZero(&msg, sizeof msg);
+  msg.msg_iov = vec;
+  msg.msg_iovlen = iovcnt;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  const ssize_t n = ::recvmsg(fd, &msg, 0);
 
+  if (n > 0)
+  {
+    /// 内核收包时间, 对TCP是本次读到的最后一段数据的时间
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          (cmsg->cmsg_type == SCM_TIMESTAMPNS || cmsg->cmsg_type == SCM_TIMESTAMPING))
+      {
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(cmsg), sizeof ts);
+        if (ts.tv_sec != 0 || ts.tv_nsec != 0)
+        {
+          *receiveTime = Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond
+                                   + ts.tv_nsec / 1000);
+        }
+      }
+    }
+  }
+  return commitRead(n, writable, extrabuf, savedErrno);
+}
+
+ssize_t Buffer::commitRead(ssize_t n, size_t writable, const char* extrabuf, int* savedErrno)
+{
   if (n < 0)
   {
     *savedErrno = errno;
@@ -13,6 +13,7 @@
 
 #include "muduo/base/copyable.h"
 #include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
 
 #include "muduo/net/Endian.h"
@@ -234,6 +235,26 @@ class Buffer : public muduo::copyable
     writerIndex_ -= len;
   }
 
+  /// Removes @c len readable bytes @c offset bytes past peek(), closing the
+  /// gap in place from the shorter side.
+  void erase(size_t offset, size_t len)
+  {
+    assert(offset + len <= readableBytes());
+    char* start = begin() + readerIndex_;
+    size_t after = readableBytes() - offset - len;
+    if (offset < after)
+    {
+      // 前面的少, 往后挪
+      memmove(start + len, start, offset);
+      readerIndex_ += len;
+    }
+    else
+    {
+      memmove(start + offset, start + offset + len, after);
+      writerIndex_ -= len;
+    }
+  }
+
   ///
   /// Append int64_t using network endian
   ///
@@ -403,7 +424,17 @@ class Buffer : public muduo::copyable
   /// @return result of read(2), @c errno is saved
   ssize_t readFd(int fd, int* savedErrno);
 
+  /// Reads a socket with recvmsg(2), and sets @c receiveTime to the kernel
+  /// receive timestamp of the data read, if the socket has SO_TIMESTAMPNS
+  /// or SO_TIMESTAMPING on. Otherwise @c receiveTime is left untouched.
+  ssize_t readFd(int fd, int* savedErrno, Timestamp* receiveTime);
+  /// Reads at most @c maxBytes, 0 means as much as fits, see
+  /// EventLoop::setChannelBudget(). @c receiveTime may be null.
+  ssize_t readFd(int fd, int* savedErrno, Timestamp* receiveTime, size_t maxBytes);
+
  private:
+  ssize_t commitRead(ssize_t n, size_t writable, const char* extrabuf, int* savedErrno);
+
   // 缓冲区起始地址
   char* begin()
   { return &*buffer_.begin(); }
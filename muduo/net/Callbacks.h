@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_CALLBACKS_H
 #define MUDUO_NET_CALLBACKS_H
 
+#include "muduo/base/Function.h"
 #include "muduo/base/Timestamp.h"
 
 #include <functional>
@@ -58,17 +59,28 @@ namespace net
 // All client visible callbacks go here.
 
 class Buffer;
+class EventLoop;
+class InetAddress;
 class TcpConnection;
+class UdpChannel;
 typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
-typedef std::function<void()> TimerCallback;
+// move-only, timers are owned by TimerQueue and never copied
+typedef muduo::Function<void()> TimerCallback;
 
 /// 连接回调函数
 typedef std::function<void (const TcpConnectionPtr&)> ConnectionCallback;
 /// 关闭回调函数
 typedef std::function<void (const TcpConnectionPtr&)> CloseCallback;
+// in the new loop after TcpConnection::migrateTo(), with the loop it left
+typedef std::function<void (const TcpConnectionPtr&, EventLoop*)> MigrateCallback;
 /// 写毕回调函数
 typedef std::function<void (const TcpConnectionPtr&)> WriteCompleteCallback;
 typedef std::function<void (const TcpConnectionPtr&, size_t)> HighWaterMarkCallback;
+typedef std::function<void (const TcpConnectionPtr&, size_t)> LowWaterMarkCallback;
+
+class Transport;
+// makes a Transport for each new connection, eg. a TLS session
+typedef std::function<std::unique_ptr<Transport> ()> TransportFactory;
 
 // the data has been read to (buf, len)
 /// 信息到达, 从buffer中获取到达的信息
@@ -76,6 +88,13 @@ typedef std::function<void (const TcpConnectionPtr&,
                             Buffer*,
                             Timestamp)> MessageCallback;
 
+// a datagram of len bytes has been received to data
+typedef std::function<void (UdpChannel*,
+                            const char* data,
+                            size_t len,
+                            const InetAddress& peerAddr,
+                            Timestamp)> DatagramCallback;
+
 void defaultConnectionCallback(const TcpConnectionPtr& conn);
 void defaultMessageCallback(const TcpConnectionPtr& conn,
                             Buffer* buffer,
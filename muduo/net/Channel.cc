@@ -31,7 +31,9 @@ Channel::Channel(EventLoop* loop, int fd__)
     logHup_(true),
     tied_(false),
     eventHandling_(false),
-    addedToLoop_(false)
+    addedToLoop_(false),
+    highPriority_(false),
+    overBudget_(false)
 {
 }
 
@@ -90,6 +90,16 @@ class Channel : noncopyable
 
   void doNotLogHup() { logHup_ = false; }
 
+  /// Handled before the other active channels of a loop iteration,
+  /// eg. timers, wakeup and acceptors.
+  void setHighPriority(bool on) { highPriority_ = on; }
+  bool highPriority() const { return highPriority_; }
+
+  /// Used up its budget last time, so it waits for the other active
+  /// channels of the next iteration. See EventLoop::setChannelBudget().
+  void setOverBudget(bool on) { overBudget_ = on; }
+  bool overBudget() const { return overBudget_; }
+
   EventLoop* ownerLoop() { return loop_; }
   void remove();
 
@@ -121,6 +131,8 @@ class Channel : noncopyable
   bool tied_;
   bool eventHandling_;
   bool addedToLoop_;
+  bool highPriority_;
+  bool overBudget_;
 
   // 回调函数
   ReadEventCallback readCallback_;
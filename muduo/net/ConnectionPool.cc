@@ -0,0 +1,196 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/ConnectionPool.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+ConnectionPool::ConnectionPool(EventLoop* loop,
+                               const InetAddress& serverAddr,
+                               const string& nameArg,
+                               int numConnections)
+  : loop_(CHECK_NOTNULL(loop)),
+    serverAddr_(serverAddr),
+    name_(nameArg),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    reconnectJitter_(0.2),
+    healthCheckInterval_(0.0),
+    started_(false),
+    next_(0),
+    slots_(numConnections)
+{
+  assert(numConnections > 0);
+  memZero(&stats_, sizeof stats_);
+}
+
+ConnectionPool::~ConnectionPool()
+{
+  loop_->assertInLoopThread();
+  loop_->cancel(healthCheckTimer_);
+  for (Slot& slot : slots_)
+  {
+    if (slot.connection)
+    {
+      // the connection may outlive us, stop calling back into this pool
+      slot.connection->setConnectionCallback(defaultConnectionCallback);
+      slot.connection->setMessageCallback(defaultMessageCallback);
+      slot.connection.reset();
+    }
+    // closes the connection if it's the last owner
+    slot.client.reset();
+  }
+}
+
+void ConnectionPool::start()
+{
+  loop_->assertInLoopThread();
+  if (started_)
+  {
+    return;
+  }
+  started_ = true;
+
+  for (size_t i = 0; i < slots_.size(); ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "#%zu", i);
+    Slot& slot = slots_[i];
+    slot.client.reset(new TcpClient(loop_, serverAddr_, name_ + buf));
+    slot.client->setConnectionCallback(
+        std::bind(&ConnectionPool::onConnection, this, i, _1));
+    slot.client->setMessageCallback(
+        std::bind(&ConnectionPool::onMessage, this, i, _1, _2, _3));
+    slot.client->setWriteCompleteCallback(writeCompleteCallback_);
+    slot.client->enableRetry();
+    slot.client->setRetryJitter(reconnectJitter_);
+    slot.client->connect();
+  }
+
+  if (healthProbe_ && healthCheckInterval_ > 0)
+  {
+    healthCheckTimer_ = loop_->runEvery(
+        healthCheckInterval_, std::bind(&ConnectionPool::onHealthCheck, this));
+  }
+}
+
+TcpConnectionPtr ConnectionPool::checkout()
+{
+  loop_->assertInLoopThread();
+  const size_t n = slots_.size();
+  const TcpConnectionPtr* best = NULL;
+  int bestInFlight = 0;
+  size_t bestPending = 0;
+  size_t bestIndex = 0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    const size_t i = (next_ + k) % n;
+    const TcpConnectionPtr& conn = slots_[i].connection;
+    if (!conn || !conn->connected())
+    {
+      continue;
+    }
+    int inFlight = conn->inFlight();
+    size_t pending = conn->outputBuffer()->readableBytes();
+    if (best == NULL || inFlight < bestInFlight
+        || (inFlight == bestInFlight && pending < bestPending))
+    {
+      best = &conn;
+      bestInFlight = inFlight;
+      bestPending = pending;
+      bestIndex = i;
+      if (inFlight == 0 && pending == 0)
+      {
+        break;  // can't do better
+      }
+    }
+  }
+
+  if (best == NULL)
+  {
+    ++stats_.checkoutMisses;
+    return TcpConnectionPtr();
+  }
+  ++stats_.checkouts;
+  next_ = (bestIndex + 1) % n;
+  return *best;
+}
+
+int ConnectionPool::numConnected() const
+{
+  loop_->assertInLoopThread();
+  int connected = 0;
+  for (const Slot& slot : slots_)
+  {
+    if (slot.connection)
+    {
+      ++connected;
+    }
+  }
+  return connected;
+}
+
+void ConnectionPool::onConnection(size_t index, const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  Slot& slot = slots_[index];
+  if (conn->connected())
+  {
+    ++stats_.connects;
+    slot.connection = conn;
+    slot.lastReceive = loop_->now();
+    slot.probeSent = Timestamp::invalid();
+  }
+  else
+  {
+    ++stats_.disconnects;
+    slot.connection.reset();
+  }
+  connectionCallback_(conn);
+}
+
+void ConnectionPool::onMessage(size_t index, const TcpConnectionPtr& conn,
+                               Buffer* buf, Timestamp receiveTime)
+{
+  slots_[index].lastReceive = receiveTime;
+  messageCallback_(conn, buf, receiveTime);
+}
+
+void ConnectionPool::onHealthCheck()
+{
+  loop_->assertInLoopThread();
+  Timestamp now(loop_->now());
+  for (Slot& slot : slots_)
+  {
+    if (!slot.connection)
+    {
+      continue;
+    }
+    if (slot.probeSent.valid() && slot.lastReceive < slot.probeSent)
+    {
+      LOG_WARN << "ConnectionPool::onHealthCheck [" << name_ << "] - "
+               << slot.connection->name() << " did not answer the probe, reconnecting";
+      ++stats_.probeFailures;
+      slot.probeSent = Timestamp::invalid();
+      // TcpClient retries once it's closed
+      slot.connection->forceClose();
+    }
+    else if (timeDifference(now, slot.lastReceive) >= healthCheckInterval_)
+    {
+      ++stats_.probes;
+      slot.probeSent = now;
+      healthProbe_(slot.connection);
+    }
+    else
+    {
+      slot.probeSent = Timestamp::invalid();
+    }
+  }
+}
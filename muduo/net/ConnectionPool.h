@@ -0,0 +1,129 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CONNECTIONPOOL_H
+#define MUDUO_NET_CONNECTIONPOOL_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Callbacks.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class TcpClient;
+
+///
+/// N warm connections to one backend, owned by one EventLoop.
+///
+/// A pool is loop-local, everything but the constructor must be called in
+/// the loop thread, so checkout() takes no lock. For a multi-threaded
+/// client create one pool per EventLoop, eg. in the ThreadInitCallback.
+///
+/// The least busy connection is the one with the fewest
+/// TcpConnection::inFlight() requests, then the shortest output buffer.
+/// Callers that want in-flight accounting bracket each request with
+/// incInFlight()/decInFlight() on the checked-out connection.
+class ConnectionPool : noncopyable
+{
+ public:
+  /// Sends a probe on an idle connection, any reply marks it healthy.
+  typedef std::function<void (const TcpConnectionPtr&)> HealthProbe;
+
+  struct Stats
+  {
+    int64_t checkouts;
+    int64_t checkoutMisses;  // no connection was up
+    int64_t connects;
+    int64_t disconnects;
+    int64_t probes;
+    int64_t probeFailures;
+  };
+
+  ConnectionPool(EventLoop* loop,
+                 const InetAddress& serverAddr,
+                 const string& nameArg,
+                 int numConnections);
+  ~ConnectionPool();  // force out-line dtor, for std::unique_ptr members.
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+
+  /// Not thread safe, call before start().
+  void setConnectionCallback(const ConnectionCallback& cb)
+  { connectionCallback_ = cb; }
+  void setMessageCallback(const MessageCallback& cb)
+  { messageCallback_ = cb; }
+  void setWriteCompleteCallback(const WriteCompleteCallback& cb)
+  { writeCompleteCallback_ = cb; }
+
+  /// Jitter of reconnect delays, see Connector::setRetryJitter().
+  /// Default 0.2, call before start().
+  void setReconnectJitter(double fraction) { reconnectJitter_ = fraction; }
+
+  /// Every @c interval seconds, probes connections that received nothing
+  /// in the last interval. A connection that has not answered the previous
+  /// probe is closed and reconnected. Call before start().
+  void setHealthCheck(double interval, const HealthProbe& probe)
+  {
+    healthCheckInterval_ = interval;
+    healthProbe_ = probe;
+  }
+
+  /// Connects all, in loop thread.
+  void start();
+
+  /// Least busy live connection, or an empty pointer if none is up.
+  /// In loop thread.
+  TcpConnectionPtr checkout();
+
+  int numConnections() const { return static_cast<int>(slots_.size()); }
+  int numConnected() const;
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Slot
+  {
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr connection;
+    Timestamp lastReceive;
+    Timestamp probeSent;
+  };
+
+  void onConnection(size_t index, const TcpConnectionPtr& conn);
+  void onMessage(size_t index, const TcpConnectionPtr& conn,
+                 Buffer* buf, Timestamp receiveTime);
+  void onHealthCheck();
+
+  EventLoop* loop_;
+  const InetAddress serverAddr_;
+  const string name_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  double reconnectJitter_;
+  double healthCheckInterval_;
+  HealthProbe healthProbe_;
+  TimerId healthCheckTimer_;
+  bool started_;
+  // where checkout() starts looking, spreads ties round-robin
+  size_t next_;
+  std::vector<Slot> slots_;
+  Stats stats_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONPOOL_H
@@ -12,31 +12,86 @@
 #include "muduo/base/Logging.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/Resolver.h"
 #include "muduo/net/SocketsOps.h"
 
 #include <errno.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>  // rand_r
 
 using namespace muduo;
 using namespace muduo::net;
 
 const int Connector::kMaxRetryDelayMs;
 
+namespace
+{
+
+__thread unsigned int t_jitterSeed = 0;
+
+bool setFastOpenConnect(int sockfd)
+{
+#ifdef TCP_FASTOPEN_CONNECT
+  int optval = 1;
+  if (::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                   &optval, static_cast<socklen_t>(sizeof optval)) == 0)
+  {
+    return true;
+  }
+  LOG_SYSERR << "TCP_FASTOPEN_CONNECT failed.";
+#else
+  LOG_ERROR << "TCP_FASTOPEN_CONNECT is not supported.";
+#endif
+  return false;
+}
+
+}  // namespace
+
 Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
   : loop_(loop),
     serverAddr_(serverAddr),
+    resolver_(NULL),
+    port_(serverAddr.port()),
+    resolveSeq_(0),
     connect_(false),
     state_(kDisconnected),
-    retryDelayMs_(kInitRetryDelayMs)
+    retryDelayMs_(kInitRetryDelayMs),
+    retryJitter_(0.0),
+    fastOpen_(false),
+    deferred_(false)
 {
   LOG_DEBUG << "ctor[" << this << "]";
 }
 
+Connector::Connector(EventLoop* loop, Resolver* resolver,
+                     const string& hostname, uint16_t port)
+  : loop_(loop),
+    resolver_(CHECK_NOTNULL(resolver)),
+    hostname_(hostname),
+    port_(port),
+    resolveSeq_(0),
+    connect_(false),
+    state_(kDisconnected),
+    retryDelayMs_(kInitRetryDelayMs),
+    retryJitter_(0.0),
+    fastOpen_(false),
+    deferred_(false)
+{
+  assert(resolver->getLoop() == loop);
+  LOG_DEBUG << "ctor[" << this << "] " << hostname_ << ":" << port_;
+}
+
 Connector::~Connector()
 {
   LOG_DEBUG << "dtor[" << this << "]";
   assert(!channel_);
 }
 
+string Connector::serverName() const
+{
+  return resolver_ ? hostname_ + ":" + std::to_string(port_) : serverAddr_.toIpPort();
+}
+
 /// 在loop线程中执行startInloop函数
 void Connector::start()
 {
@@ -50,8 +105,13 @@ void Connector::startInLoop()
   /// 保证在建立连接的io线程执行
   loop_->assertInLoopThread();
   assert(state_ == kDisconnected);
-  // 执行连接
-  if (connect_)
+  // 执行连接, 有主机名的先解析
+  if (connect_ && resolver_)
+  {
+    resolver_->resolve(hostname_, std::bind(&Connector::resolved, shared_from_this(),
+                                            ++resolveSeq_, _1));
+  }
+  else if (connect_)
   {
     connect();
   }
@@ -68,9 +128,30 @@ void Connector::stop()
   // FIXME: cancel timer
 }
 
+void Connector::resolved(int64_t seq, const std::vector<InetAddress>& addrs)
+{
+  loop_->assertInLoopThread();
+  if (seq != resolveSeq_ || state_ != kDisconnected || !connect_)
+  {
+    LOG_DEBUG << "do not connect";
+  }
+  else if (addrs.empty())
+  {
+    LOG_WARN << "Connector::resolved - " << hostname_ << " did not resolve";
+    retryLater();
+  }
+  else
+  {
+    const InetAddress& addr = addrs.front();
+    serverAddr_ = InetAddress(addr.toIp(), port_, addr.family() == AF_INET6);
+    connect();
+  }
+}
+
 void Connector::stopInLoop()
 {
   loop_->assertInLoopThread();
+  ++resolveSeq_;
   if (state_ == kConnecting)
   {
     setState(kDisconnected);
@@ -84,6 +165,8 @@ void Connector::connect()
 {
   /// 创建sockfd(新建)
   int sockfd = sockets::createNonblockingOrDie(serverAddr_.family());
+  /// 失败时退回普通的connect
+  deferred_ = fastOpen_ && setFastOpenConnect(sockfd);
   /// 连接地址, 返回状态码
   int ret = sockets::connect(sockfd, serverAddr_.getSockAddr());
   int savedErrno = (ret == 0) ? 0 : errno;
@@ -103,6 +186,7 @@ void Connector::connect()
     case EADDRNOTAVAIL:
     case ECONNREFUSED:
     case ENETUNREACH: 
+    case ENOENT:  // Unix domain socket not created yet
     // 以上延时重试
       retry(sockfd);
       break;
@@ -133,7 +217,19 @@ void Connector::restart()
   setState(kDisconnected);
   retryDelayMs_ = kInitRetryDelayMs;
   connect_ = true;
-  startInLoop();
+  if (retryJitter_ > 0.0)
+  {
+    // eg. a pool that lost all its connections to one server restart
+    double delayMs = jitteredDelayMs(kInitRetryDelayMs);
+    LOG_INFO << "Connector::restart - Reconnecting to " << serverName()
+             << " in " << static_cast<int>(delayMs) << " milliseconds. ";
+    loop_->runAfter(delayMs/1000.0,
+                    std::bind(&Connector::startInLoop, shared_from_this()));
+  }
+  else
+  {
+    startInLoop();
+  }
 }
 
 /// 将建立连接的sockfd封装成channel
@@ -191,7 +287,8 @@ void Connector::handleWrite()
       retry(sockfd);
     }
     /// 处理自连接，即(sourceIp, sourcePort) = (desIp, desPort)的情况
-    else if (sockets::isSelfConnect(sockfd))
+    // a deferred connect has no peer yet, and can't have connected to itself
+    else if (!deferred_ && sockets::isSelfConnect(sockfd))
     {
       LOG_WARN << "Connector::handleWrite - Self connect";
       /// 重新连接
@@ -238,12 +335,18 @@ void Connector::retry(int sockfd)
 {
   /// 关闭sockfd
   sockets::close(sockfd);
+  retryLater();
+}
+
+void Connector::retryLater()
+{
   setState(kDisconnected);
   if (connect_) /// 定时重试
   {
-    LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
-             << " in " << retryDelayMs_ << " milliseconds. ";
-    loop_->runAfter(retryDelayMs_/1000.0,
+    double delayMs = jitteredDelayMs(retryDelayMs_);
+    LOG_INFO << "Connector::retry - Retry connecting to " << serverName()
+             << " in " << static_cast<int>(delayMs) << " milliseconds. ";
+    loop_->runAfter(delayMs/1000.0,
                     std::bind(&Connector::startInLoop, shared_from_this()));
     retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
   }
@@ -253,3 +356,18 @@ void Connector::retry(int sockfd)
   }
 }
 
+double Connector::jitteredDelayMs(int delayMs)
+{
+  if (retryJitter_ <= 0.0)
+  {
+    return delayMs;
+  }
+  if (t_jitterSeed == 0)
+  {
+    t_jitterSeed = static_cast<unsigned int>(
+        Timestamp::now().microSecondsSinceEpoch() ^ reinterpret_cast<uintptr_t>(this));
+  }
+  double r = ::rand_r(&t_jitterSeed) / static_cast<double>(RAND_MAX);  // [0, 1]
+  return delayMs * (1.0 + retryJitter_ * (2.0 * r - 1.0));
+}
+
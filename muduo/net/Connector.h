@@ -20,6 +20,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace muduo
 {
@@ -28,6 +29,7 @@ namespace net
 
 class Channel;
 class EventLoop;
+class Resolver;
 /// NewConnectionCallback: 执行连接后的回调函数
 
 class Connector : noncopyable,
@@ -38,6 +40,9 @@ class Connector : noncopyable,
   typedef std::function<void (int sockfd)> NewConnectionCallback;
 
   Connector(EventLoop* loop, const InetAddress& serverAddr);
+  /// Resolves @c hostname before every attempt, and connects to its
+  /// first address. The resolver must belong to @c loop and outlive us.
+  Connector(EventLoop* loop, Resolver* resolver, const string& hostname, uint16_t port);
   ~Connector();
   // 设置连接回调函数
   void setNewConnectionCallback(const NewConnectionCallback& cb)
@@ -47,7 +52,23 @@ class Connector : noncopyable,
   void restart();  // must be called in loop thread
   void stop();  // can be called in any thread
 
+  /// The last resolved address if connecting by hostname.
   const InetAddress& serverAddress() const { return serverAddr_; }
+  /// hostname:port, or the address if not connecting by hostname.
+  string serverName() const;
+
+  /// Scales each retry delay by a random factor in [1-fraction, 1+fraction],
+  /// so that clients dropped together don't come back in lockstep.
+  /// restart() then waits a scaled initial delay too, instead of
+  /// connecting right away. Must be called before start().
+  void setRetryJitter(double fraction) { retryJitter_ = fraction; }
+
+  /// TCP_FASTOPEN_CONNECT, the connection is handed over before the
+  /// handshake, and the first send() goes out in the SYN if the kernel has
+  /// a cookie for the server. Only for protocols where the client talks
+  /// first, as nothing is sent until it does. Must be called before start().
+  void setFastOpen(bool on) { fastOpen_ = on; }
+  bool fastOpen() const { return fastOpen_; }
 
  private:
   enum States { kDisconnected, kConnecting, kConnected };
@@ -57,24 +78,34 @@ class Connector : noncopyable,
   void setState(States s) { state_ = s; }
   void startInLoop();
   void stopInLoop();
+  void resolved(int64_t seq, const std::vector<InetAddress>& addrs);
   void connect();
   void connecting(int sockfd);
   
   void handleWrite();
   void handleError();
   void retry(int sockfd);
+  void retryLater();
+  double jitteredDelayMs(int delayMs);
   int removeAndResetChannel();
   void resetChannel();
 
   /// 主线程的loop, 用来处理建立的连接
   EventLoop* loop_;
   InetAddress serverAddr_;
+  Resolver* resolver_;
+  const string hostname_;
+  const uint16_t port_;
+  int64_t resolveSeq_;  // ignores stale answers after stop/restart
   bool connect_; // atomic
   States state_;  // FIXME: use atomic variable
   std::unique_ptr<Channel> channel_;
   
   NewConnectionCallback newConnectionCallback_;
   int retryDelayMs_;
+  double retryJitter_;
+  bool fastOpen_;
+  bool deferred_;  // connect() returned before sending the SYN
 };
 
 }  // namespace net
@@ -11,12 +11,14 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/Mutex.h"
+#include "muduo/base/TscClock.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/Poller.h"
 #include "muduo/net/SocketsOps.h"
 #include "muduo/net/TimerQueue.h"
 
 #include <algorithm>
+#include <iterator>
 
 #include <signal.h>
 #include <sys/eventfd.h>
@@ -73,12 +75,20 @@ EventLoop* EventLoop::getEventLoopOfCurrentThread()
   return t_loopInThisThread;
 }
 
+Timestamp EventLoop::cachedNow()
+{
+  return t_loopInThisThread ? t_loopInThisThread->now() : Timestamp::now();
+}
+
 EventLoop::EventLoop()
   : looping_(false),
     quit_(false),
     eventHandling_(false),
     callingPendingFunctors_(false),
     iteration_(0),
+    readBudget_(0),
+    timeBudgetNs_(0),
+    overBudgetCount_(0),
     /// 构造thread_loop的线程id
     threadId_(CurrentThread::tid()),
 
@@ -105,6 +115,7 @@ EventLoop::EventLoop()
   /// wakeupChannel_ 读的回调函数
   wakeupChannel_->setReadCallback(
       std::bind(&EventLoop::handleRead, this));
+  wakeupChannel_->setHighPriority(true);
   // wakeupfd可读, 并调poller ->update中更新之
   wakeupChannel_->enableReading();
 }
@@ -132,6 +143,9 @@ void EventLoop::loop()
   looping_ = true;
   quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
   LOG_TRACE << "EventLoop " << this << " start looping";
+  // work queued before loop(), eg. a datagram sent by a client connecting,
+  // must not wait for the first poll to return
+  doPendingFunctors();
 
   while (!quit_)
   /// loop循环未终止
@@ -147,14 +161,17 @@ void EventLoop::loop()
     {
       printActiveChannels();
     }
-    // TODO sort channel by priority
+    if (activeChannels_.size() > 1)
+    {
+      sortActiveChannels();
+    }
     // 执行活跃函数的回调函数
     eventHandling_ = true;
     for (Channel* channel : activeChannels_)
     {
       currentActiveChannel_ = channel;
       /// 处理handleEvent函数
-      currentActiveChannel_->handleEvent(pollReturnTime_); 
+      handleActiveChannel(channel);
     }
     // 清空ActiveChannel_
     currentActiveChannel_ = NULL;
@@ -172,6 +189,63 @@ void EventLoop::loop()
   looping_ = false;
 }
 
+void EventLoop::setChannelBudget(size_t readBytes, double seconds)
+{
+  readBudget_ = readBytes;
+  timeBudgetNs_ = static_cast<int64_t>(seconds * 1e9);
+}
+
+/// 高优先级的channel(定时器, wakeup, acceptor)在前, 上次超出预算的在后, 同一级保持poll的顺序
+void EventLoop::sortActiveChannels()
+{
+  sortedChannels_.clear();
+  for (Channel* channel : activeChannels_)
+  {
+    if (channel->highPriority())
+    {
+      sortedChannels_.push_back(channel);
+    }
+  }
+  for (Channel* channel : activeChannels_)
+  {
+    if (!channel->highPriority() && !channel->overBudget())
+    {
+      sortedChannels_.push_back(channel);
+    }
+  }
+  for (Channel* channel : activeChannels_)
+  {
+    if (!channel->highPriority() && channel->overBudget())
+    {
+      sortedChannels_.push_back(channel);
+    }
+  }
+  activeChannels_.swap(sortedChannels_);
+}
+
+void EventLoop::handleActiveChannel(Channel* channel)
+{
+  if (timeBudgetNs_ <= 0 || channel->highPriority())
+  {
+    channel->handleEvent(pollReturnTime_);
+  }
+  else
+  {
+    // the read budget may set it again, in TcpConnection::handleRead()
+    channel->setOverBudget(false);
+    int64_t start = TscClock::nanoseconds();
+    channel->handleEvent(pollReturnTime_);
+    if (TscClock::nanoseconds() - start > timeBudgetNs_)
+    {
+      channel->setOverBudget(true);
+    }
+  }
+  if (channel->overBudget())
+  {
+    ++overBudgetCount_;
+  }
+}
+
 /// 退出loop循环
 void EventLoop::quit()
 {
@@ -217,6 +291,46 @@ void EventLoop::queueInLoop(Functor cb)
   }
 }
 
+/// 整批任务只加一次锁, 最多唤醒一次
+void EventLoop::runInLoopBatch(std::vector<Functor>* cbs)
+{
+  if (cbs->empty())
+  {
+    return;
+  }
+  if (isInLoopThread())
+  {
+    for (const Functor& cb : *cbs)
+    {
+      cb();
+    }
+  }
+  else
+  {
+    bool wasEmpty = false;
+    {
+    MutexLockGuard lock(mutex_);
+    wasEmpty = pendingFunctors_.empty();
+    if (wasEmpty)
+    {
+      pendingFunctors_.swap(*cbs);
+    }
+    else
+    {
+      pendingFunctors_.insert(pendingFunctors_.end(),
+                              std::make_move_iterator(cbs->begin()),
+                              std::make_move_iterator(cbs->end()));
+    }
+    }
+    /// 队列非空说明loop还没取走它, 已有人唤醒过或loop正忙
+    if (wasEmpty)
+    {
+      wakeup();
+    }
+  }
+  cbs->clear();
+}
+
 /// 等待io执行的函数大小
 size_t EventLoop::queueSize() const
 {
@@ -224,6 +338,12 @@ size_t EventLoop::queueSize() const
   return pendingFunctors_.size();
 }
 
+void EventLoop::runBeforePoll(Functor cb)
+{
+  assertInLoopThread();
+  beforePollFunctors_.push_back(std::move(cb));
+}
+
 /// 定时器, 在time时刻执行TimerCallback
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
 {
@@ -271,6 +391,11 @@ void EventLoop::removeChannel(Channel* channel)
   poller_->removeChannel(channel);
 }
 
+int64_t EventLoop::interestUpdatesAvoided() const
+{
+  return poller_->interestChanges() - poller_->interestSyscalls();
+}
+
 /// eventloop has_channel, 实际是调用poller_判断监听的channel
 bool EventLoop::hasChannel(Channel* channel)
 {
@@ -314,8 +439,8 @@ void EventLoop::handleRead()
 /// 运行等待的函数
 void EventLoop::doPendingFunctors()
 {
-  /// 新建一个functor
-  std::vector<Functor> functors;
+  /// runningFunctors_与pendingFunctors_互换, 两边的容量都得以复用, 不再每轮分配
+  std::vector<Functor>& functors = runningFunctors_;
   /// 需要唤醒epoll_wait了
   callingPendingFunctors_ = true;
   /// CAS操作， 有可能线程正在执行pendingFunctors_, 因此需要CAS防止竞态
@@ -329,6 +454,19 @@ void EventLoop::doPendingFunctors()
   {
     functor();
   }
+  functors.clear();
+
+  // Flush corked output once per iteration. Still inside
+  // callingPendingFunctors_, so anything queued here wakes up the next poll.
+  while (!beforePollFunctors_.empty())
+  {
+    functors.swap(beforePollFunctors_);
+    for (const Functor& functor : functors)
+    {
+      functor();
+    }
+    functors.clear();
+  }
   callingPendingFunctors_ = false;
 }
 
@@ -17,6 +17,7 @@
 
 #include <boost/any.hpp>
 
+#include "muduo/base/Function.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Timestamp.h"
@@ -45,7 +46,9 @@ class TimerQueue;
 class EventLoop : noncopyable
 {
  public:
-  typedef std::function<void()> Functor;
+  /// Move-only, binds of a member function, a pointer and a string are
+  /// stored inline, see muduo::Function.
+  typedef muduo::Function<void()> Functor;
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for std::unique_ptr members.
@@ -68,8 +71,33 @@ class EventLoop : noncopyable
   ///
   Timestamp pollReturnTime() const { return pollReturnTime_; }
 
+  ///
+  /// Time cached once per iteration, costs no clock read.
+  /// Behind real time by however long this iteration has run,
+  /// use Timestamp::now() when that matters.
+  ///
+  Timestamp now() const
+  { return pollReturnTime_.valid() ? pollReturnTime_ : Timestamp::now(); }
+
   int64_t iteration() const { return iteration_; }
 
+  /// Fairness between the active channels of one iteration.
+  ///
+  /// A TcpConnection reads at most @c readBytes per iteration, and a channel
+  /// whose events took more than @c seconds to handle, callbacks included,
+  /// is handled after the other active channels of the next iteration.
+  /// Unread data stays in the socket, level-triggered polling reports it
+  /// again. Zero (default) means no budget.
+  /// Not thread safe, call before loop().
+  void setChannelBudget(size_t readBytes, double seconds);
+  size_t readBudget() const { return readBudget_; }
+  /// times a channel ran over its budget. Loop thread only.
+  int64_t overBudgetCount() const { return overBudgetCount_; }
+
+  /// Channel interest changes that cost no syscall, because the poller
+  /// coalesced them before polling. Loop thread only.
+  int64_t interestUpdatesAvoided() const;
+
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
@@ -80,8 +108,19 @@ class EventLoop : noncopyable
   /// Safe to call from other threads.
   void queueInLoop(Functor cb);
 
+  /// Runs all of @c cbs in order in the loop thread, and clears it.
+  /// From other threads they are queued under one lock with at most
+  /// one wakeup, instead of one of each per runInLoop().
+  /// Safe to call from other threads.
+  void runInLoopBatch(std::vector<Functor>* cbs);
+
   size_t queueSize() const;
 
+  /// Runs callback once, after pending functors, right before the loop
+  /// goes back to polling. Used to flush corked output.
+  /// Must be called in the loop thread.
+  void runBeforePoll(Functor cb);
+
   // timers, 设置定时器任务
 
   ///
@@ -136,6 +175,10 @@ class EventLoop : noncopyable
 
   static EventLoop* getEventLoopOfCurrentThread();
 
+  /// now() of the loop in this thread, or Timestamp::now() in a thread
+  /// without one. Fits Logger::setClock().
+  static Timestamp cachedNow();
+
  private:
   // EventLoop对象创建者并非本线程
   void abortNotInLoopThread();
@@ -145,6 +188,8 @@ class EventLoop : noncopyable
   void doPendingFunctors();
   // 打印ChannelList activeChannels_;
   void printActiveChannels() const; // DEBUG
+  void sortActiveChannels();
+  void handleActiveChannel(Channel* channel);
 
   typedef std::vector<Channel*> ChannelList;
   // 调用EventLoop，设置为true
@@ -155,6 +200,9 @@ class EventLoop : noncopyable
   bool callingPendingFunctors_; /* atomic */
   // 迭代次数
   int64_t iteration_;
+  size_t readBudget_;
+  int64_t timeBudgetNs_;
+  int64_t overBudgetCount_;
   /// tid
   const pid_t threadId_;
   // pollReturnTime_ 时间戳
@@ -172,11 +220,16 @@ class EventLoop : noncopyable
 
   // scratch variables
   ChannelList activeChannels_;
+  ChannelList sortedChannels_;
   Channel* currentActiveChannel_;
 
   mutable MutexLock mutex_;
   /// 任务队列
   std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+  // always in loop thread
+  std::vector<Functor> beforePollFunctors_;
+  // swapped with pendingFunctors_ by doPendingFunctors()
+  std::vector<Functor> runningFunctors_;
 };
 
 }  // namespace net
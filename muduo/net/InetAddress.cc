@@ -45,12 +45,19 @@ static const in_addr_t kInaddrLoopback = INADDR_LOOPBACK;
 using namespace muduo;
 using namespace muduo::net;
 
-static_assert(sizeof(InetAddress) == sizeof(struct sockaddr_in6),
-              "InetAddress is same size as sockaddr_in6");
+//     struct sockaddr_un {
+//         sa_family_t     sun_family;    /* AF_UNIX */
+//         char            sun_path[108]; /* pathname */
+//     };
+
+static_assert(sizeof(InetAddress) >= sizeof(struct sockaddr_un) &&
+              sizeof(InetAddress) <= sizeof(struct sockaddr_storage),
+              "InetAddress holds a sockaddr_un");
 static_assert(offsetof(sockaddr_in, sin_family) == 0, "sin_family offset 0");
 static_assert(offsetof(sockaddr_in6, sin6_family) == 0, "sin6_family offset 0");
 static_assert(offsetof(sockaddr_in, sin_port) == 2, "sin_port offset 2");
 static_assert(offsetof(sockaddr_in6, sin6_port) == 2, "sin6_port offset 2");
+static_assert(offsetof(sockaddr_un, sun_family) == 0, "sun_family offset 0");
 
 InetAddress::InetAddress(uint16_t portArg, bool loopbackOnly, bool ipv6)
 {
@@ -88,16 +95,46 @@ InetAddress::InetAddress(StringArg ip, uint16_t portArg, bool ipv6)
   }
 }
 
+InetAddress::InetAddress(const struct sockaddr_storage& addr)
+{
+  static_assert(sizeof addr >= sizeof addrun_, "sockaddr_storage holds any address");
+  memcpy(&addrun_, &addr, sizeof addrun_);
+}
+
+InetAddress InetAddress::unixDomain(StringArg path)
+{
+  InetAddress addr;
+  memZero(&addr.addrun_, sizeof addr.addrun_);
+  addr.addrun_.sun_family = AF_UNIX;
+  size_t len = strlen(path.c_str());
+  if (len >= sizeof addr.addrun_.sun_path)
+  {
+    LOG_ERROR << "InetAddress::unixDomain - path too long: " << path.c_str();
+    len = sizeof addr.addrun_.sun_path - 1;
+  }
+  memcpy(addr.addrun_.sun_path, path.c_str(), len);
+  if (addr.addrun_.sun_path[0] == '@')
+  {
+    addr.addrun_.sun_path[0] = '\0';
+  }
+  return addr;
+}
+
+socklen_t InetAddress::getSockAddrLen() const
+{
+  return sockets::sockaddrLength(getSockAddr());
+}
+
 string InetAddress::toIpPort() const
 {
-  char buf[64] = "";
+  char buf[128] = "";
   sockets::toIpPort(buf, sizeof buf, getSockAddr());
   return buf;
 }
 
 string InetAddress::toIp() const
 {
-  char buf[64] = "";
+  char buf[128] = "";
   sockets::toIp(buf, sizeof buf, getSockAddr());
   return buf;
 }
@@ -110,6 +147,10 @@ uint32_t InetAddress::ipv4NetEndian() const
 
 uint16_t InetAddress::port() const
 {
+  if (isUnixDomain())
+  {
+    return 0;
+  }
   return sockets::networkToHost16(portNetEndian());
 }
 
@@ -15,6 +15,8 @@
 #include "muduo/base/StringPiece.h"
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 namespace muduo
 {
@@ -26,7 +28,7 @@ const struct sockaddr* sockaddr_cast(const struct sockaddr_in6* addr);
 }
 
 ///
-/// Wrapper of sockaddr_in.
+/// Wrapper of sockaddr_in, sockaddr_in6 and sockaddr_un.
 ///
 /// This is an POD interface class.
 class InetAddress : public muduo::copyable
@@ -50,7 +52,22 @@ class InetAddress : public muduo::copyable
     : addr6_(addr)
   { }
 
+  explicit InetAddress(const struct sockaddr_un& addr)
+    : addrun_(addr)
+  { }
+
+  /// Constructs from whatever getsockname(2)/accept(2) returned.
+  explicit InetAddress(const struct sockaddr_storage& addr);
+
+  /// Constructs an AF_UNIX stream endpoint.
+  /// A @c path starting with '@' names a Linux abstract socket,
+  /// the name must not contain '\0'.
+  static InetAddress unixDomain(StringArg path);
+
   sa_family_t family() const { return addr_.sin_family; }
+  bool isUnixDomain() const { return family() == AF_UNIX; }
+  /// For AF_UNIX, toIp() and toIpPort() return the path, "@name" for an
+  /// abstract socket, or "" for an unnamed one. port() is 0.
   string toIp() const;
   string toIpPort() const;
   uint16_t port() const;
@@ -58,12 +75,14 @@ class InetAddress : public muduo::copyable
   // default copy/assignment are Okay
 
   const struct sockaddr* getSockAddr() const { return sockets::sockaddr_cast(&addr6_); }
+  socklen_t getSockAddrLen() const;
   void setSockAddrInet6(const struct sockaddr_in6& addr6) { addr6_ = addr6; }
 
   uint32_t ipv4NetEndian() const;
   uint16_t portNetEndian() const { return addr_.sin_port; }
 
   // resolve hostname to IP address, not changing port or sin_family
+  // blocking, use Resolver in an EventLoop
   // return true on success.
   // thread safe
   static bool resolve(StringArg hostname, InetAddress* result);
@@ -77,6 +96,7 @@ class InetAddress : public muduo::copyable
   {
     struct sockaddr_in addr_;
     struct sockaddr_in6 addr6_;
+    struct sockaddr_un addrun_;
   };
 };
 
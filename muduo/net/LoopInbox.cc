@@ -0,0 +1,100 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/LoopInbox.h"
+
+#include "muduo/base/SpscQueue.h"
+
+#include <atomic>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+struct InboxRing
+{
+  explicit InboxRing(size_t capacity)
+    : queue(capacity),
+      drainScheduled(false),
+      overflowing(0)
+  {
+  }
+
+  SpscQueue<EventLoop::Functor> queue;
+  // a drain is queued in the loop and has not started yet
+  std::atomic<bool> drainScheduled;
+  // fallback functors queued in the loop and not run yet
+  std::atomic<int> overflowing;
+};
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+namespace
+{
+
+/// 在loop线程中一次取空ring
+void drain(const std::shared_ptr<detail::InboxRing>& ring)
+{
+  // clear first, anything pushed from now on schedules another drain
+  ring->drainScheduled.store(false);
+  EventLoop::Functor cb;
+  // at most what was there when the flag was cleared, so a fast
+  // producer can't keep the loop here
+  size_t n = ring->queue.capacity();
+  while (n-- > 0 && ring->queue.tryPop(&cb))
+  {
+    cb();
+  }
+}
+
+/// ring满时的退路, 先跑完ring里更早的任务, 保持顺序
+void drainThenRun(const std::shared_ptr<detail::InboxRing>& ring,
+                  const EventLoop::Functor& cb)
+{
+  drain(ring);
+  cb();
+  ring->overflowing.fetch_sub(1);
+}
+
+}  // namespace
+
+LoopInbox::LoopInbox(EventLoop* loop, size_t capacity)
+  : loop_(loop),
+    ring_(std::make_shared<detail::InboxRing>(capacity)),
+    posted_(0),
+    wakeups_(0),
+    overflows_(0)
+{
+}
+
+LoopInbox::~LoopInbox() = default;
+
+void LoopInbox::post(EventLoop::Functor cb)
+{
+  assert(!loop_->isInLoopThread());
+  ++posted_;
+  // once overflowing, keep going through the loop's queue until the
+  // fallbacks have run, or later functors could overtake them
+  if (ring_->overflowing.load() == 0 && ring_->queue.tryPush(cb))
+  {
+    if (!ring_->drainScheduled.exchange(true))
+    {
+      ++wakeups_;
+      loop_->queueInLoop(std::bind(&drain, ring_));
+    }
+  }
+  else
+  {
+    ++overflows_;
+    ring_->overflowing.fetch_add(1);
+    loop_->queueInLoop(std::bind(&drainThenRun, ring_, std::move(cb)));
+  }
+}
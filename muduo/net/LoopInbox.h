@@ -0,0 +1,63 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_LOOPINBOX_H
+#define MUDUO_NET_LOOPINBOX_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/EventLoop.h"
+
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+namespace detail
+{
+struct InboxRing;
+}  // namespace detail
+
+///
+/// One producer thread's lane into one EventLoop.
+///
+/// post() pushes onto a fixed-capacity SPSC ring without taking the loop's
+/// mutex. The loop is woken once for everything posted until it drains
+/// the ring, and drains it in one pass. Meant for a worker thread handing
+/// results back to an IO loop, create one inbox per (thread, loop) pair.
+///
+/// Functors run in the loop thread in the order they were posted. When the
+/// ring is full, post() falls back to EventLoop::queueInLoop() without
+/// breaking that order.
+class LoopInbox : noncopyable
+{
+ public:
+  LoopInbox(EventLoop* loop, size_t capacity = 1024);
+  ~LoopInbox();
+
+  EventLoop* getLoop() const { return loop_; }
+
+  /// Producer thread only, which must not be the loop thread.
+  void post(EventLoop::Functor cb);
+
+  /// Producer thread only.
+  int64_t posted() const { return posted_; }
+  int64_t wakeups() const { return wakeups_; }
+  int64_t overflows() const { return overflows_; }
+
+ private:
+  EventLoop* loop_;
+  // shared with the drain functors queued in the loop
+  std::shared_ptr<detail::InboxRing> ring_;
+  int64_t posted_;
+  int64_t wakeups_;
+  int64_t overflows_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_LOOPINBOX_H
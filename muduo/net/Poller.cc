@@ -14,7 +14,9 @@ using namespace muduo;
 using namespace muduo::net;
 
 Poller::Poller(EventLoop* loop)
-  : ownerLoop_(loop)
+  : interestChanges_(0),
+    interestSyscalls_(0),
+    ownerLoop_(loop)
 {
 }
 
@@ -24,7 +26,6 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
   assertInLoopThread();
-  ChannelMap::const_iterator it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  return channels_.find(channel->fd()) == channel;
 }
 
@@ -11,9 +11,12 @@
 #ifndef MUDUO_NET_POLLER_H
 #define MUDUO_NET_POLLER_H
 
-#include <map>
+#include <algorithm>
 #include <vector>
 
+#include <assert.h>
+#include <stdint.h>
+
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/EventLoop.h"
 
@@ -24,6 +27,64 @@ namespace net
 
 class Channel;
 
+///
+/// fd -> Channel*, a vector indexed by fd.
+///
+/// fds are small dense integers, so lookups are an index instead of a
+/// std::map walk. Every add() bumps the fd's generation, a poller that
+/// tags its kernel registrations with it can tell events of a closed fd
+/// from events of a new Channel that reused the number.
+class ChannelTable
+{
+ public:
+  ChannelTable() : size_(0) { }
+
+  Channel* find(int fd) const
+  {
+    return static_cast<size_t>(fd) < entries_.size() ? entries_[fd].channel : NULL;
+  }
+
+  uint32_t generation(int fd) const
+  {
+    return static_cast<size_t>(fd) < entries_.size() ? entries_[fd].generation : 0;
+  }
+
+  /// returns the new generation of @c fd
+  uint32_t add(int fd, Channel* channel)
+  {
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= entries_.size())
+    {
+      entries_.resize(std::max(static_cast<size_t>(fd) + 1, entries_.size() * 2));
+    }
+    Entry& entry = entries_[fd];
+    assert(entry.channel == NULL);
+    entry.channel = channel;
+    ++size_;
+    return ++entry.generation;
+  }
+
+  void remove(int fd)
+  {
+    assert(find(fd) != NULL);
+    entries_[fd].channel = NULL;
+    --size_;
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  struct Entry
+  {
+    Entry() : channel(NULL), generation(0) { }
+    Channel* channel;
+    uint32_t generation;
+  };
+
+  std::vector<Entry> entries_;
+  size_t size_;
+};
+
 ///
 /// Base class for IO Multiplexing
 ///
@@ -57,15 +118,21 @@ class Poller : noncopyable
 
   static Poller* newDefaultPoller(EventLoop* loop);
 
+  /// Interest changes asked for by Channels, and the syscalls made for
+  /// them. Pollers that coalesce changes make fewer syscalls.
+  int64_t interestChanges() const { return interestChanges_; }
+  int64_t interestSyscalls() const { return interestSyscalls_; }
+
   void assertInLoopThread() const
   {
     ownerLoop_->assertInLoopThread();
   }
 
  protected:
- /// 一个fd->channel 的map
-  typedef std::map<int, Channel*> ChannelMap;
-  ChannelMap channels_;
+ /// fd->channel, 以fd为下标的数组
+  ChannelTable channels_;
+  int64_t interestChanges_;
+  int64_t interestSyscalls_;
 
  private:
   EventLoop* ownerLoop_;
@@ -0,0 +1,368 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/PreforkServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/ProcessInfo.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Socket.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+void noDelete(PreforkServer*)
+{
+}
+
+}  // namespace
+
+PreforkServer::PreforkServer(EventLoop* loop,
+                             const InetAddress& listenAddr,
+                             const string& nameArg,
+                             int numWorkers,
+                             ListenMode mode)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(nameArg),
+    numWorkers_(numWorkers),
+    mode_(mode),
+    masterPid_(::getpid()),
+    workers_(numWorkers),
+    statsInterval_(1.0),
+    restartDelay_(1.0),
+    started_(false),
+    stopping_(false),
+    restarts_(0),
+    guard_(this, noDelete)
+{
+  assert(numWorkers > 0);
+  /// 共享模式只建一个socket, reuseport模式每个worker一个, 由内核分配连接
+  int numSockets = mode_ == kSharedSocket ? 1 : numWorkers_;
+  for (int i = 0; i < numSockets; ++i)
+  {
+    std::unique_ptr<Socket> socket(
+        new Socket(sockets::createNonblockingOrDie(listenAddr.family())));
+    socket->setReuseAddr(true);
+    socket->setReusePort(mode_ == kReusePort);
+    socket->bindAddress(listenAddr);
+    socket->listen();
+    listenSockets_.push_back(std::move(socket));
+  }
+  for (Worker& worker : workers_)
+  {
+    worker.pid = 0;
+    worker.pipeFd = -1;
+    memZero(&worker.stats, sizeof worker.stats);
+  }
+}
+
+PreforkServer::~PreforkServer()
+{
+  loop_->assertInLoopThread();
+  stop();
+  for (int i = 0; i < numWorkers_; ++i)
+  {
+    Worker& worker = workers_[i];
+    if (worker.pid > 0)
+    {
+      ::waitpid(worker.pid, NULL, 0);
+    }
+    if (worker.channel && !worker.channel->isNoneEvent())
+    {
+      worker.channel->disableAll();
+      worker.channel->remove();
+    }
+    if (worker.pipeFd >= 0)
+    {
+      ::close(worker.pipeFd);
+    }
+  }
+}
+
+void PreforkServer::start()
+{
+  loop_->assertInLoopThread();
+  assert(!started_);
+  started_ = true;
+  LOG_INFO << "PreforkServer [" << name_ << "] forks " << numWorkers_
+           << (mode_ == kReusePort ? " workers, SO_REUSEPORT" : " workers, shared socket");
+  for (int i = 0; i < numWorkers_; ++i)
+  {
+    startWorker(i);
+  }
+}
+
+void PreforkServer::stop()
+{
+  loop_->assertInLoopThread();
+  stopping_ = true;
+  for (const Worker& worker : workers_)
+  {
+    if (worker.pid > 0)
+    {
+      ::kill(worker.pid, SIGTERM);
+    }
+  }
+}
+
+void PreforkServer::startWorker(int index)
+{
+  loop_->assertInLoopThread();
+  if (stopping_)
+  {
+    return;
+  }
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) < 0)
+  {
+    LOG_SYSFATAL << "PreforkServer::startWorker pipe2";
+  }
+  /// 缓冲的日志不能在子进程里再输出一次
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = ::fork();
+  if (pid < 0)
+  {
+    LOG_SYSERR << "PreforkServer::startWorker fork";
+    ::close(fds[0]);
+    ::close(fds[1]);
+    loop_->runAfter(restartDelay_,
+        weakCall(&PreforkServer::startWorker, index));
+    return;
+  }
+  if (pid == 0)
+  {
+    ::close(fds[0]);
+    runWorker(index, fds[1]);
+  }
+
+  ::close(fds[1]);
+  ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  Worker& worker = workers_[index];
+  worker.pid = pid;
+  worker.pipeFd = fds[0];
+  worker.input.retrieveAll();
+  memZero(&worker.stats, sizeof worker.stats);
+  worker.channel.reset(new Channel(loop_, fds[0]));
+  worker.channel->setReadCallback(
+      std::bind(&PreforkServer::handleRead, this, index));
+  // an empty pipe whose writer is gone reports POLLHUP only
+  worker.channel->setCloseCallback(
+      std::bind(&PreforkServer::handleRead, this, index));
+  worker.channel->enableReading();
+  LOG_INFO << "PreforkServer [" << name_ << "] worker " << index << " pid " << pid;
+}
+
+void PreforkServer::runWorker(int index, int pipeFd)
+{
+  ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+  if (::getppid() != masterPid_)
+  {
+    // the master died before prctl()
+    ::_exit(1);
+  }
+  for (int i = 0; i < numWorkers_; ++i)
+  {
+    if (i != index && workers_[i].pipeFd >= 0)
+    {
+      ::close(workers_[i].pipeFd);
+    }
+  }
+  /// 主进程的EventLoop属于这个线程, worker的loop只能放在新线程里
+  Thread thread(std::bind(&PreforkServer::workerMain, this, index, pipeFd),
+                name_ + "-worker");
+  thread.start();
+  thread.join();
+  fflush(stdout);
+  ::_exit(0);
+}
+
+void PreforkServer::workerMain(int index, int pipeFd)
+{
+  EventLoop loop;
+  const Socket& listenSocket = *listenSockets_[mode_ == kSharedSocket ? 0 : index];
+  int listenfd = ::dup(listenSocket.fd());
+  if (listenfd < 0)
+  {
+    LOG_SYSFATAL << "PreforkServer::workerMain dup";
+  }
+  char buf[32];
+  snprintf(buf, sizeof buf, "-%d", index);
+  TcpServer server(&loop, listenfd, name_ + buf);
+  if (workerInitCallback_)
+  {
+    workerInitCallback_(&server, index);
+  }
+  server.start();
+
+  auto report = [&]()
+  {
+    WorkerStats stats;
+    memZero(&stats, sizeof stats);
+    stats.pid = ::getpid();
+    stats.index = index;
+    stats.connections = static_cast<int64_t>(server.numConnections());
+    stats.accepted = server.acceptedConnections();
+    stats.rejected = server.rejectedConnections();
+    stats.loopLag = server.loopLag();
+    stats.cpuSeconds = ProcessInfo::cpuTime().total();
+    stats.when = Timestamp::now();
+    // a record is smaller than PIPE_BUF, so it is written whole
+    ssize_t n = ::write(pipeFd, &stats, sizeof stats);
+    if (n < 0 && errno == EPIPE)
+    {
+      LOG_WARN << "PreforkServer [" << name_ << "] master is gone";
+      loop.quit();
+    }
+  };
+  loop.runInLoop(report);
+  loop.runEvery(statsInterval_, report);
+  loop.loop();
+}
+
+void PreforkServer::handleRead(int index)
+{
+  loop_->assertInLoopThread();
+  Worker& worker = workers_[index];
+  int savedErrno = 0;
+  ssize_t n = worker.input.readFd(worker.pipeFd, &savedErrno);
+  if (n > 0)
+  {
+    while (worker.input.readableBytes() >= sizeof(WorkerStats))
+    {
+      memcpy(&worker.stats, worker.input.peek(), sizeof(WorkerStats));
+      worker.input.retrieve(sizeof(WorkerStats));
+    }
+  }
+  else if (n == 0 || savedErrno != EAGAIN)
+  {
+    /// 写端关闭说明worker退出了, channel不能在自己的回调里析构
+    worker.channel->disableAll();
+    worker.channel->remove();
+    loop_->queueInLoop(
+        weakCall(&PreforkServer::resetChannel, index));
+    reap(index);
+  }
+}
+
+void PreforkServer::resetChannel(int index)
+{
+  Worker& worker = workers_[index];
+  worker.channel.reset();
+  ::close(worker.pipeFd);
+  worker.pipeFd = -1;
+}
+
+void PreforkServer::reap(int index)
+{
+  loop_->assertInLoopThread();
+  Worker& worker = workers_[index];
+  int status = 0;
+  pid_t pid = ::waitpid(worker.pid, &status, WNOHANG);
+  if (pid == 0)
+  {
+    // the pipe closes a little before the process exits
+    loop_->runAfter(0.01,
+        weakCall(&PreforkServer::reap, index));
+    return;
+  }
+
+  if (pid < 0)
+  {
+    LOG_SYSERR << "PreforkServer::reap waitpid " << worker.pid;
+  }
+  else if (WIFSIGNALED(status))
+  {
+    LOG_WARN << "PreforkServer [" << name_ << "] worker " << index << " pid " << pid
+             << " killed by signal " << WTERMSIG(status);
+  }
+  else
+  {
+    LOG_WARN << "PreforkServer [" << name_ << "] worker " << index << " pid " << pid
+             << " exited with " << WEXITSTATUS(status);
+  }
+  worker.pid = 0;
+  if (!stopping_)
+  {
+    ++restarts_;
+    loop_->runAfter(restartDelay_,
+        weakCall(&PreforkServer::startWorker, index));
+  }
+}
+
+std::function<void ()> PreforkServer::weakCall(void (PreforkServer::*func)(int), int index)
+{
+  std::weak_ptr<PreforkServer> guard(guard_);
+  return [guard, func, index]()
+  {
+    std::shared_ptr<PreforkServer> self(guard.lock());
+    if (self)
+    {
+      (self.get()->*func)(index);
+    }
+  };
+}
+
+std::vector<PreforkServer::WorkerStats> PreforkServer::workerStats() const
+{
+  loop_->assertInLoopThread();
+  std::vector<WorkerStats> stats;
+  for (const Worker& worker : workers_)
+  {
+    stats.push_back(worker.stats);
+  }
+  return stats;
+}
+
+PreforkServer::WorkerStats PreforkServer::totalStats() const
+{
+  loop_->assertInLoopThread();
+  WorkerStats total;
+  memZero(&total, sizeof total);
+  for (const Worker& worker : workers_)
+  {
+    const WorkerStats& stats = worker.stats;
+    total.connections += stats.connections;
+    total.accepted += stats.accepted;
+    total.rejected += stats.rejected;
+    total.loopLag = std::max(total.loopLag, stats.loopLag);
+    total.cpuSeconds += stats.cpuSeconds;
+    if (total.when < stats.when)
+    {
+      total.when = stats.when;
+    }
+  }
+  return total;
+}
+
+std::vector<pid_t> PreforkServer::workerPids() const
+{
+  loop_->assertInLoopThread();
+  std::vector<pid_t> pids;
+  for (const Worker& worker : workers_)
+  {
+    if (worker.pid > 0)
+    {
+      pids.push_back(worker.pid);
+    }
+  }
+  return pids;
+}
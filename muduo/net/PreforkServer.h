@@ -0,0 +1,140 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PREFORKSERVER_H
+#define MUDUO_NET_PREFORKSERVER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/InetAddress.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+class Socket;
+class TcpServer;
+
+///
+/// Multi-process server. The master opens the listening sockets and forks
+/// workers, each running its own TcpServer, and usually its own thread pool.
+///
+/// The master restarts workers that die, and collects the stats they send
+/// over a pipe every statsInterval seconds. The master loop does nothing
+/// else, it should stay single threaded, as fork(2) copies only the calling
+/// thread and any lock another thread held stays locked in the child.
+///
+/// Workers die with the master. A restarted worker takes over the same
+/// listening socket, so connections queued meanwhile are not lost.
+class PreforkServer : noncopyable
+{
+ public:
+  enum ListenMode
+  {
+    kSharedSocket,  // one socket, every worker accepts from it
+    kReusePort,     // one SO_REUSEPORT socket per worker, the kernel balances
+  };
+
+  /// Called in the worker, in its loop thread, before TcpServer::start().
+  /// Sets callbacks, thread number, etc.
+  typedef std::function<void (TcpServer*, int index)> WorkerInitCallback;
+
+  /// Sent by each worker, and aggregated by the master.
+  struct WorkerStats
+  {
+    pid_t pid;
+    int index;
+    int64_t connections;  // open now
+    int64_t accepted;
+    int64_t rejected;
+    double loopLag;       // seconds, see TcpServer::setMaxLoopLag()
+    double cpuSeconds;    // user + system
+    Timestamp when;
+  };
+
+  PreforkServer(EventLoop* loop,
+                const InetAddress& listenAddr,
+                const string& nameArg,
+                int numWorkers,
+                ListenMode mode = kReusePort);
+  ~PreforkServer();  // stops the workers
+
+  const string& name() const { return name_; }
+  int numWorkers() const { return numWorkers_; }
+
+  /// Not thread safe, call before start().
+  void setWorkerInitCallback(const WorkerInitCallback& cb)
+  { workerInitCallback_ = cb; }
+  /// Not thread safe, call before start().
+  void setStatsInterval(double seconds) { statsInterval_ = seconds; }
+  /// Delay before a dead worker is restarted. Not thread safe.
+  void setRestartDelay(double seconds) { restartDelay_ = seconds; }
+
+  /// Forks the workers. In a worker it does not return, the process
+  /// exits when the worker loop quits. In the master loop thread.
+  void start();
+  /// Kills the workers with SIGTERM, and does not restart them.
+  void stop();
+
+  // in the master loop thread
+  /// latest stats of each worker, pid 0 if it has not reported yet
+  std::vector<WorkerStats> workerStats() const;
+  /// sum of the above, pid and index are 0, loopLag the largest
+  WorkerStats totalStats() const;
+  int64_t restarts() const { return restarts_; }
+  std::vector<pid_t> workerPids() const;
+
+ private:
+  struct Worker
+  {
+    pid_t pid;
+    int pipeFd;
+    std::unique_ptr<Channel> channel;
+    Buffer input;
+    WorkerStats stats;
+  };
+
+  void startWorker(int index);
+  void runWorker(int index, int pipeFd);  // in the child, never returns
+  void workerMain(int index, int pipeFd);
+  void handleRead(int index);
+  void reap(int index);
+  void resetChannel(int index);
+  /// calls (this->*func)(index), unless this is destroyed by then
+  std::function<void ()> weakCall(void (PreforkServer::*func)(int), int index);
+
+  EventLoop* loop_;
+  const string name_;
+  const int numWorkers_;
+  const ListenMode mode_;
+  const pid_t masterPid_;
+  // one socket for kSharedSocket, one per worker for kReusePort
+  std::vector<std::unique_ptr<Socket>> listenSockets_;
+  std::vector<Worker> workers_;
+  WorkerInitCallback workerInitCallback_;
+  double statsInterval_;
+  double restartDelay_;
+  bool started_;
+  bool stopping_;
+  int64_t restarts_;
+  // expires with this object, guards the timers of reap() and restarts
+  std::shared_ptr<PreforkServer> guard_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_PREFORKSERVER_H
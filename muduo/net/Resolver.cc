@@ -0,0 +1,705 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/UdpChannel.h"
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypeSOA = 6;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kClassIN = 1;
+const int kRcodeNoError = 0;
+const int kRcodeNxDomain = 3;
+const size_t kHeaderSize = 12;
+
+void appendUint16(string* out, uint16_t x)
+{
+  out->push_back(static_cast<char>(x >> 8));
+  out->push_back(static_cast<char>(x & 0xff));
+}
+
+/// www.example.com -> 3www7example3com0
+bool encodeName(const string& name, string* out)
+{
+  if (name.empty() || name.size() > 253)
+  {
+    return false;
+  }
+  size_t start = 0;
+  while (start <= name.size())
+  {
+    size_t dot = name.find('.', start);
+    if (dot == string::npos)
+    {
+      dot = name.size();
+    }
+    size_t len = dot - start;
+    if (len == 0 || len > 63)
+    {
+      return false;
+    }
+    out->push_back(static_cast<char>(len));
+    out->append(name, start, len);
+    start = dot + 1;
+  }
+  out->push_back('\0');
+  return true;
+}
+
+/// 只带一个问题的递归查询
+string makeQuery(uint16_t id, const string& name, uint16_t qtype)
+{
+  string query;
+  appendUint16(&query, id);
+  appendUint16(&query, 0x0100);  // RD
+  appendUint16(&query, 1);       // QDCOUNT
+  appendUint16(&query, 0);
+  appendUint16(&query, 0);
+  appendUint16(&query, 0);
+  encodeName(name, &query);
+  appendUint16(&query, qtype);
+  appendUint16(&query, kClassIN);
+  return query;
+}
+
+/// bounds-checked reader of a DNS message
+class Reader
+{
+ public:
+  Reader(const char* data, size_t len)
+    : data_(reinterpret_cast<const uint8_t*>(data)),
+      len_(len),
+      pos_(0)
+  {
+  }
+
+  size_t position() const { return pos_; }
+
+  bool readUint16(uint16_t* x)
+  {
+    if (len_ - pos_ < 2)
+      return false;
+    *x = static_cast<uint16_t>((data_[pos_] << 8) | data_[pos_+1]);
+    pos_ += 2;
+    return true;
+  }
+
+  bool readUint32(uint32_t* x)
+  {
+    uint16_t high = 0, low = 0;
+    if (!readUint16(&high) || !readUint16(&low))
+      return false;
+    *x = (static_cast<uint32_t>(high) << 16) | low;
+    return true;
+  }
+
+  bool skip(size_t n)
+  {
+    if (len_ - pos_ < n)
+      return false;
+    pos_ += n;
+    return true;
+  }
+
+  bool read(void* out, size_t n)
+  {
+    if (len_ - pos_ < n)
+      return false;
+    memcpy(out, data_ + pos_, n);
+    pos_ += n;
+    return true;
+  }
+
+  /// Reads a possibly compressed name, in lower case.
+  bool readName(string* name)
+  {
+    name->clear();
+    size_t pos = pos_;
+    bool jumped = false;
+    for (int jumps = 0; jumps < 64; )
+    {
+      if (pos >= len_)
+        return false;
+      uint8_t len = data_[pos];
+      if ((len & 0xc0) == 0xc0)
+      {
+        if (pos + 1 >= len_)
+          return false;
+        if (!jumped)
+        {
+          pos_ = pos + 2;
+          jumped = true;
+        }
+        pos = ((len & 0x3f) << 8) | data_[pos+1];
+        ++jumps;
+      }
+      else if (len == 0)
+      {
+        if (!jumped)
+        {
+          pos_ = pos + 1;
+        }
+        return true;
+      }
+      else
+      {
+        if (pos + 1 + len > len_ || len > 63)
+          return false;
+        if (!name->empty())
+          name->push_back('.');
+        for (size_t i = pos + 1; i < pos + 1 + len; ++i)
+        {
+          name->push_back(static_cast<char>(tolower(data_[i])));
+        }
+        pos += 1 + len;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const uint8_t* data_;
+  const size_t len_;
+  size_t pos_;
+};
+
+struct Response
+{
+  uint16_t id;
+  int rcode;
+  string qname;
+  uint16_t qtype;
+  std::vector<InetAddress> addrs;
+  uint32_t ttl;          // smallest of addrs
+  uint32_t negativeTtl;  // from SOA in the authority section, 0 if none
+};
+
+bool parseResponse(const char* data, size_t len, Response* r)
+{
+  Reader reader(data, len);
+  uint16_t flags = 0, qdcount = 0, ancount = 0, nscount = 0, arcount = 0;
+  if (!reader.readUint16(&r->id) || !reader.readUint16(&flags)
+      || !reader.readUint16(&qdcount) || !reader.readUint16(&ancount)
+      || !reader.readUint16(&nscount) || !reader.readUint16(&arcount))
+    return false;
+  if (!(flags & 0x8000) || qdcount != 1)
+    return false;
+  r->rcode = flags & 0x0f;
+  uint16_t qclass = 0;
+  if (!reader.readName(&r->qname) || !reader.readUint16(&r->qtype)
+      || !reader.readUint16(&qclass))
+    return false;
+
+  r->ttl = UINT32_MAX;
+  r->negativeTtl = 0;
+  for (int i = 0; i < ancount + nscount; ++i)
+  {
+    string owner;
+    uint16_t type = 0, klass = 0, rdlength = 0;
+    uint32_t ttl = 0;
+    if (!reader.readName(&owner) || !reader.readUint16(&type)
+        || !reader.readUint16(&klass) || !reader.readUint32(&ttl)
+        || !reader.readUint16(&rdlength))
+      return false;
+    size_t end = reader.position() + rdlength;
+    // CNAMEs come before the records of the canonical name, skip them
+    if (i < ancount && klass == kClassIN && type == kTypeA && rdlength == 4)
+    {
+      struct sockaddr_in addr;
+      memZero(&addr, sizeof addr);
+      addr.sin_family = AF_INET;
+      reader.read(&addr.sin_addr, 4);
+      r->addrs.push_back(InetAddress(addr));
+      r->ttl = std::min(r->ttl, ttl);
+    }
+    else if (i < ancount && klass == kClassIN && type == kTypeAAAA && rdlength == 16)
+    {
+      struct sockaddr_in6 addr;
+      memZero(&addr, sizeof addr);
+      addr.sin6_family = AF_INET6;
+      reader.read(&addr.sin6_addr, 16);
+      r->addrs.push_back(InetAddress(addr));
+      r->ttl = std::min(r->ttl, ttl);
+    }
+    else if (i >= ancount && type == kTypeSOA)
+    {
+      // negative answers live for min(SOA TTL, SOA MINIMUM), RFC 2308
+      string mname, rname;
+      uint32_t fields[5];
+      if (!reader.readName(&mname) || !reader.readName(&rname))
+        return false;
+      for (uint32_t& field : fields)
+      {
+        if (!reader.readUint32(&field))
+          return false;
+      }
+      r->negativeTtl = std::min(ttl, fields[4]);
+    }
+    if (reader.position() > end || !reader.skip(end - reader.position()))
+      return false;
+  }
+  return true;
+}
+
+/// 小写, 去掉末尾的点
+string normalize(const string& hostname)
+{
+  string name(hostname);
+  if (!name.empty() && name.back() == '.')
+  {
+    name.pop_back();
+  }
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  return name;
+}
+
+bool parseIp(const string& ip, InetAddress* addr)
+{
+  struct sockaddr_in addr4;
+  memZero(&addr4, sizeof addr4);
+  if (::inet_pton(AF_INET, ip.c_str(), &addr4.sin_addr) == 1)
+  {
+    addr4.sin_family = AF_INET;
+    *addr = InetAddress(addr4);
+    return true;
+  }
+  struct sockaddr_in6 addr6;
+  memZero(&addr6, sizeof addr6);
+  if (::inet_pton(AF_INET6, ip.c_str(), &addr6.sin6_addr) == 1)
+  {
+    addr6.sin6_family = AF_INET6;
+    *addr = InetAddress(addr6);
+    return true;
+  }
+  return false;
+}
+
+bool ipv4First(const InetAddress& lhs, const InetAddress& rhs)
+{
+  return lhs.family() == AF_INET && rhs.family() != AF_INET;
+}
+
+}  // namespace
+
+DnsCache::DnsCache(double minTtl, double maxTtl, double maxNegativeTtl, size_t maxEntries)
+  : minTtl_(minTtl),
+    maxTtl_(maxTtl),
+    maxNegativeTtl_(maxNegativeTtl),
+    maxEntries_(maxEntries),
+    hits_(0),
+    misses_(0),
+    coalesced_(0)
+{
+  assert(minTtl <= maxTtl);
+  assert(maxEntries > 0);
+}
+
+size_t DnsCache::size() const
+{
+  MutexLockGuard lock(mutex_);
+  return entries_.size();
+}
+
+void DnsCache::clear()
+{
+  MutexLockGuard lock(mutex_);
+  entries_.clear();
+}
+
+int64_t DnsCache::hits() const
+{
+  MutexLockGuard lock(mutex_);
+  return hits_;
+}
+
+int64_t DnsCache::misses() const
+{
+  MutexLockGuard lock(mutex_);
+  return misses_;
+}
+
+int64_t DnsCache::coalesced() const
+{
+  MutexLockGuard lock(mutex_);
+  return coalesced_;
+}
+
+DnsCache::Lookup DnsCache::lookup(const string& name, Timestamp now,
+                                  EventLoop* loop, const ResolveCallback& cb,
+                                  std::vector<InetAddress>* addrs)
+{
+  MutexLockGuard lock(mutex_);
+  auto it = entries_.find(name);
+  if (it != entries_.end() && now < it->second.expiration)
+  {
+    ++hits_;
+    *addrs = it->second.addrs;
+    return kHit;
+  }
+  Waiter waiter = { loop, cb };
+  auto inflight = inflight_.find(name);
+  if (inflight != inflight_.end())
+  {
+    ++coalesced_;
+    inflight->second.push_back(waiter);
+    return kJoined;
+  }
+  ++misses_;
+  inflight_[name].push_back(waiter);
+  return kMiss;
+}
+
+void DnsCache::complete(const string& name, const std::vector<InetAddress>& addrs,
+                        double ttl, bool negative, Timestamp now)
+{
+  std::vector<Waiter> waiters;
+  {
+  MutexLockGuard lock(mutex_);
+  if (ttl > 0)
+  {
+    ttl = negative ? std::min(ttl, maxNegativeTtl_) : std::min(ttl, maxTtl_);
+    ttl = std::max(ttl, minTtl_);
+    if (entries_.size() >= maxEntries_ && entries_.find(name) == entries_.end())
+    {
+      for (auto it = entries_.begin(); it != entries_.end(); )
+      {
+        if (it->second.expiration <= now)
+          it = entries_.erase(it);
+        else
+          ++it;
+      }
+      if (entries_.size() >= maxEntries_)
+      {
+        entries_.erase(entries_.begin());
+      }
+    }
+    Entry& entry = entries_[name];
+    entry.addrs = addrs;
+    entry.expiration = addTime(now, ttl);
+  }
+  auto it = inflight_.find(name);
+  if (it != inflight_.end())
+  {
+    waiters.swap(it->second);
+    inflight_.erase(it);
+  }
+  }
+
+  for (const Waiter& waiter : waiters)
+  {
+    waiter.loop->queueInLoop(std::bind(waiter.callback, addrs));
+  }
+}
+
+Resolver::Resolver(EventLoop* loop)
+  : Resolver(loop, systemNameserver(), std::make_shared<DnsCache>())
+{
+}
+
+Resolver::Resolver(EventLoop* loop,
+                   const InetAddress& nameserver,
+                   const std::shared_ptr<DnsCache>& cache)
+  : loop_(CHECK_NOTNULL(loop)),
+    nameserver_(nameserver),
+    cache_(cache ? cache : std::make_shared<DnsCache>()),
+    channel_(new UdpChannel(loop, InetAddress(0, false, nameserver.family() == AF_INET6),
+                            "Resolver")),
+    timeout_(1.0),
+    attempts_(2),
+    random_(std::random_device()()),
+    queriesSent_(0),
+    timeouts_(0)
+{
+  channel_->setBatchSize(8);
+  channel_->setDatagramCallback(
+      std::bind(&Resolver::onDatagram, this, _2, _3, std::placeholders::_4));
+  channel_->start();
+}
+
+Resolver::~Resolver()
+{
+  loop_->assertInLoopThread();
+  for (auto& it : queries_)
+  {
+    loop_->cancel(it.second.timer);
+    cache_->complete(it.first, std::vector<InetAddress>(), 0, false, loop_->now());
+  }
+}
+
+InetAddress Resolver::systemNameserver()
+{
+  string conf;
+  FileUtil::readFile("/etc/resolv.conf", 64*1024, &conf);
+  size_t pos = 0;
+  while (pos < conf.size())
+  {
+    size_t eol = conf.find('\n', pos);
+    if (eol == string::npos)
+    {
+      eol = conf.size();
+    }
+    char ip[64];
+    string line(conf, pos, eol - pos);
+    if (sscanf(line.c_str(), " nameserver %63[^% \t]", ip) == 1)
+    {
+      InetAddress addr;
+      if (parseIp(ip, &addr))
+      {
+        return InetAddress(ip, 53, addr.family() == AF_INET6);
+      }
+    }
+    pos = eol + 1;
+  }
+  return InetAddress("127.0.0.1", 53);
+}
+
+void Resolver::loadHostsFile(StringArg path)
+{
+  string hosts;
+  int err = FileUtil::readFile(path, 1024*1024, &hosts);
+  if (err)
+  {
+    LOG_ERROR << "Resolver::loadHostsFile " << path.c_str() << " " << strerror_tl(err);
+    return;
+  }
+  size_t pos = 0;
+  while (pos < hosts.size())
+  {
+    size_t eol = hosts.find('\n', pos);
+    if (eol == string::npos)
+    {
+      eol = hosts.size();
+    }
+    string line(hosts, pos, std::min(hosts.find('#', pos), eol) - pos);
+    pos = eol + 1;
+
+    std::vector<string> fields;
+    size_t start = line.find_first_not_of(" \t\r");
+    while (start != string::npos)
+    {
+      size_t end = line.find_first_of(" \t\r", start);
+      fields.push_back(line.substr(start, end == string::npos ? end : end - start));
+      start = line.find_first_not_of(" \t\r", end == string::npos ? line.size() : end);
+    }
+    InetAddress addr;
+    if (fields.size() < 2 || !parseIp(fields[0], &addr))
+    {
+      continue;
+    }
+    for (size_t i = 1; i < fields.size(); ++i)
+    {
+      std::vector<InetAddress>& addrs = hosts_[normalize(fields[i])];
+      addrs.push_back(addr);
+      std::stable_sort(addrs.begin(), addrs.end(), ipv4First);
+    }
+  }
+}
+
+void Resolver::setTimeout(double timeout, int attempts)
+{
+  assert(timeout > 0);
+  assert(attempts > 0);
+  timeout_ = timeout;
+  attempts_ = attempts;
+}
+
+void Resolver::resolve(const string& hostname, const ResolveCallback& cb)
+{
+  if (loop_->isInLoopThread())
+  {
+    resolveInLoop(hostname, cb);
+  }
+  else
+  {
+    loop_->runInLoop(std::bind(&Resolver::resolveInLoop, this, hostname, cb));  // FIXME: unsafe
+  }
+}
+
+/// 依次查: IP字面量, hosts文件, 缓存(或已在查询中), 最后发请求
+void Resolver::resolveInLoop(const string& hostname, const ResolveCallback& cb)
+{
+  loop_->assertInLoopThread();
+  std::vector<InetAddress> addrs;
+  InetAddress literal;
+  if (parseIp(hostname, &literal))
+  {
+    addrs.push_back(literal);
+    loop_->queueInLoop(std::bind(cb, addrs));
+    return;
+  }
+
+  string name(normalize(hostname));
+  auto host = hosts_.find(name);
+  if (host != hosts_.end())
+  {
+    loop_->queueInLoop(std::bind(cb, host->second));
+    return;
+  }
+  string encoded;
+  if (!encodeName(name, &encoded))
+  {
+    LOG_ERROR << "Resolver::resolve - invalid name " << hostname;
+    loop_->queueInLoop(std::bind(cb, addrs));
+    return;
+  }
+
+  DnsCache::Lookup result = cache_->lookup(name, loop_->now(), loop_, cb, &addrs);
+  if (result == DnsCache::kHit)
+  {
+    loop_->queueInLoop(std::bind(cb, addrs));
+  }
+  else if (result == DnsCache::kMiss)
+  {
+    Query& query = queries_[name];
+    for (int type = 0; type < kNumTypes; ++type)
+    {
+      query.ids[type] = nextId();
+      names_[query.ids[type]] = name;
+    }
+    query.attempts = 1;
+    send(name, &query);
+    query.timer = loop_->runAfter(timeout_, std::bind(&Resolver::onTimeout, this, name));
+  }
+}
+
+void Resolver::send(const string& name, Query* query)
+{
+  for (int type = 0; type < kNumTypes; ++type)
+  {
+    if (!query->answers[type].done)
+    {
+      channel_->send(makeQuery(query->ids[type], name, type == kA ? kTypeA : kTypeAAAA),
+                     nameserver_);
+      ++queriesSent_;
+    }
+  }
+}
+
+void Resolver::onTimeout(const string& name)
+{
+  auto it = queries_.find(name);
+  assert(it != queries_.end());
+  Query& query = it->second;
+  ++timeouts_;
+  if (query.attempts < attempts_)
+  {
+    ++query.attempts;
+    LOG_DEBUG << "Resolver::onTimeout " << name << " attempt " << query.attempts;
+    send(name, &query);
+    query.timer = loop_->runAfter(timeout_, std::bind(&Resolver::onTimeout, this, name));
+  }
+  else
+  {
+    LOG_WARN << "Resolver::onTimeout " << name << " no answer from "
+             << nameserver_.toIpPort();
+    for (Answer& answer : query.answers)
+    {
+      answer.done = true;
+    }
+    finish(name);
+  }
+}
+
+void Resolver::onDatagram(const char* data, size_t len, const InetAddress& peerAddr)
+{
+  Response response;
+  if (peerAddr.toIpPort() != nameserver_.toIpPort() || len < kHeaderSize
+      || !parseResponse(data, len, &response))
+  {
+    return;
+  }
+  auto byId = names_.find(response.id);
+  if (byId == names_.end() || byId->second != response.qname)
+  {
+    return;
+  }
+  const string name(byId->second);
+  Query& query = queries_[name];
+  int type = query.ids[kA] == response.id ? kA : kAAAA;
+  if (response.qtype != (type == kA ? kTypeA : kTypeAAAA))
+  {
+    return;
+  }
+  names_.erase(byId);
+
+  Answer& answer = query.answers[type];
+  answer.done = true;
+  if (response.rcode == kRcodeNoError && !response.addrs.empty())
+  {
+    answer.addrs.swap(response.addrs);
+    answer.ttl = response.ttl;
+  }
+  else if (response.rcode == kRcodeNoError || response.rcode == kRcodeNxDomain)
+  {
+    answer.negative = true;
+    answer.ttl = response.negativeTtl;
+  }
+  else
+  {
+    LOG_WARN << "Resolver " << name << " rcode " << response.rcode;
+  }
+
+  if (query.answers[kA].done && query.answers[kAAAA].done)
+  {
+    finish(name);
+  }
+}
+
+/// 合并A和AAAA的结果, 取较小的TTL; 有一个失败且没有地址则不缓存
+void Resolver::finish(const string& name)
+{
+  auto it = queries_.find(name);
+  assert(it != queries_.end());
+  Query& query = it->second;
+  loop_->cancel(query.timer);
+  for (uint16_t id : query.ids)
+  {
+    names_.erase(id);
+  }
+
+  std::vector<InetAddress> addrs;
+  double ttl = 0;
+  bool negative = true;
+  for (const Answer& answer : query.answers)
+  {
+    addrs.insert(addrs.end(), answer.addrs.begin(), answer.addrs.end());
+    if (answer.ttl > 0)
+    {
+      ttl = ttl > 0 ? std::min(ttl, answer.ttl) : answer.ttl;
+    }
+    negative = negative && answer.negative;
+  }
+  if (addrs.empty() && !negative)
+  {
+    ttl = 0;
+  }
+  queries_.erase(it);
+  LOG_DEBUG << "Resolver " << name << " " << addrs.size() << " addresses, ttl " << ttl;
+  cache_->complete(name, addrs, ttl, addrs.empty(), loop_->now());
+}
+
+uint16_t Resolver::nextId()
+{
+  uint16_t id = 0;
+  do
+  {
+    id = static_cast<uint16_t>(random_());
+  } while (names_.find(id) != names_.end());
+  return id;
+}
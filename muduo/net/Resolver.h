@@ -0,0 +1,180 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_RESOLVER_H
+#define MUDUO_NET_RESOLVER_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class UdpChannel;
+
+/// Addresses of a hostname, port 0, IPv4 first. Empty if it didn't resolve.
+typedef std::function<void (const std::vector<InetAddress>&)> ResolveCallback;
+
+///
+/// Answers of DNS lookups, positive and negative, kept for their TTL.
+///
+/// Thread safe, one cache is meant to be shared by the Resolver of every
+/// loop. It also coalesces lookups: while a name is being looked up,
+/// resolving it again, on any loop, waits for that same query.
+class DnsCache : noncopyable
+{
+ public:
+  /// TTLs are clamped to [minTtl, maxTtl], negative ones to at most
+  /// maxNegativeTtl, all in seconds.
+  explicit DnsCache(double minTtl = 1.0,
+                    double maxTtl = 3600.0,
+                    double maxNegativeTtl = 60.0,
+                    size_t maxEntries = 64*1024);
+
+  size_t size() const;
+  void clear();
+
+  int64_t hits() const;
+  int64_t misses() const;
+  /// lookups that joined a query in flight
+  int64_t coalesced() const;
+
+ private:
+  friend class Resolver;
+
+  enum Lookup { kHit, kJoined, kMiss };
+
+  struct Entry
+  {
+    std::vector<InetAddress> addrs;
+    Timestamp expiration;
+  };
+
+  struct Waiter
+  {
+    EventLoop* loop;
+    ResolveCallback callback;
+  };
+
+  /// kHit fills @c addrs. On kMiss the caller must query, then complete().
+  Lookup lookup(const string& name, Timestamp now,
+                EventLoop* loop, const ResolveCallback& cb,
+                std::vector<InetAddress>* addrs);
+  /// Caches for @c ttl seconds, 0 means don't, and calls back the waiters.
+  void complete(const string& name, const std::vector<InetAddress>& addrs,
+                double ttl, bool negative, Timestamp now);
+
+  const double minTtl_;
+  const double maxTtl_;
+  const double maxNegativeTtl_;
+  const size_t maxEntries_;
+  mutable MutexLock mutex_;
+  std::map<string, Entry> entries_ GUARDED_BY(mutex_);
+  std::map<string, std::vector<Waiter>> inflight_ GUARDED_BY(mutex_);
+  int64_t hits_ GUARDED_BY(mutex_);
+  int64_t misses_ GUARDED_BY(mutex_);
+  int64_t coalesced_ GUARDED_BY(mutex_);
+};
+
+///
+/// Non-blocking stub resolver of one EventLoop, asks a recursive
+/// nameserver for A and AAAA records over UDP.
+///
+/// Names are absolute, search domains are not applied. IP literals and
+/// names loaded by loadHostsFile() don't go to the nameserver.
+/// Truncated answers are used as they are, there is no TCP fallback.
+///
+/// Must be destroyed in the loop thread, lookups still in flight then
+/// call back with no address.
+class Resolver : noncopyable
+{
+ public:
+  /// Nameserver and a cache of its own from /etc/resolv.conf
+  explicit Resolver(EventLoop* loop);
+  Resolver(EventLoop* loop,
+           const InetAddress& nameserver,
+           const std::shared_ptr<DnsCache>& cache);
+  ~Resolver();
+
+  EventLoop* getLoop() const { return loop_; }
+  const InetAddress& nameserver() const { return nameserver_; }
+  const std::shared_ptr<DnsCache>& cache() const { return cache_; }
+
+  /// First nameserver in /etc/resolv.conf, or 127.0.0.1:53.
+  static InetAddress systemNameserver();
+
+  /// Adds the names in a hosts(5) file, they never expire.
+  /// Not thread safe, call before resolve().
+  void loadHostsFile(StringArg path = "/etc/hosts");
+
+  /// Waits @c timeout seconds for an answer, and asks at most
+  /// @c attempts times. Not thread safe, call before resolve().
+  void setTimeout(double timeout, int attempts);
+
+  /// Calls back in the loop thread, never before returning.
+  /// Thread safe.
+  void resolve(const string& hostname, const ResolveCallback& cb);
+
+  // loop thread only
+  int64_t queriesSent() const { return queriesSent_; }
+  int64_t timeouts() const { return timeouts_; }
+
+ private:
+  enum RecordType { kA, kAAAA, kNumTypes };
+
+  struct Answer
+  {
+    Answer() : done(false), negative(false), ttl(0) { }
+    bool done;
+    bool negative;  // NXDOMAIN or no records of this type
+    double ttl;     // 0 if failed
+    std::vector<InetAddress> addrs;
+  };
+
+  struct Query
+  {
+    uint16_t ids[kNumTypes];
+    Answer answers[kNumTypes];
+    int attempts;
+    TimerId timer;
+  };
+
+  void resolveInLoop(const string& hostname, const ResolveCallback& cb);
+  void send(const string& name, Query* query);
+  void onTimeout(const string& name);
+  void onDatagram(const char* data, size_t len, const InetAddress& peerAddr);
+  void finish(const string& name);
+  uint16_t nextId();
+
+  EventLoop* loop_;
+  const InetAddress nameserver_;
+  std::shared_ptr<DnsCache> cache_;
+  std::unique_ptr<UdpChannel> channel_;
+  double timeout_;
+  int attempts_;
+  std::map<string, std::vector<InetAddress>> hosts_;
+  std::map<string, Query> queries_;
+  std::map<uint16_t, string> names_;  // query id to name
+  std::mt19937 random_;
+  int64_t queriesSent_;
+  int64_t timeouts_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_RESOLVER_H
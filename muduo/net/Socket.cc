@@ -34,6 +34,44 @@ bool Socket::getTcpInfo(struct tcp_info* tcpi) const
   return ::getsockopt(sockfd_, SOL_TCP, TCP_INFO, tcpi, &len) == 0;
 }
 
+namespace
+{
+
+// struct tcp_info of linux/tcp.h up to tcpi_delivery_rate (4.9),
+// <linux/tcp.h> doesn't mix with <netinet/tcp.h>.
+struct TcpInfoExt
+{
+  struct tcp_info info;
+  uint64_t pacingRate;
+  uint64_t maxPacingRate;
+  uint64_t bytesAcked;
+  uint64_t bytesReceived;
+  uint32_t segsOut;
+  uint32_t segsIn;
+  uint32_t notsentBytes;
+  uint32_t minRtt;
+  uint32_t dataSegsIn;
+  uint32_t dataSegsOut;
+  uint64_t deliveryRate;
+};
+
+}  // namespace
+
+bool Socket::getTcpInfo(struct tcp_info* tcpi, uint64_t* deliveryRate) const
+{
+  TcpInfoExt ext;
+  socklen_t len = sizeof ext;
+  memZero(&ext, len);
+  if (::getsockopt(sockfd_, SOL_TCP, TCP_INFO, &ext, &len) != 0)
+  {
+    return false;
+  }
+  *tcpi = ext.info;
+  // fields the kernel didn't fill in stay zero
+  *deliveryRate = ext.deliveryRate;
+  return true;
+}
+
 // ::getsocketopt string format, 获取套接字选项用字符串输出
 bool Socket::getTcpInfoString(char* buf, int len) const
 {
@@ -76,12 +114,12 @@ void Socket::listen()
 /// 接受, 返回的connfd
 int Socket::accept(InetAddress* peeraddr)
 {
-  struct sockaddr_in6 addr;
+  struct sockaddr_storage addr;
   memZero(&addr, sizeof addr);
   int connfd = sockets::accept(sockfd_, &addr);
   if (connfd >= 0)
   {
-    peeraddr->setSockAddrInet6(addr);
+    *peeraddr = InetAddress(addr);
   }
   return connfd;
 }
@@ -100,6 +138,52 @@ void Socket::setTcpNoDelay(bool on)
   // FIXME CHECK
 }
 
+void Socket::setTcpNotSentLowat(int bytes)
+{
+#ifdef TCP_NOTSENT_LOWAT
+  int optval = bytes;  // 0 falls back to sysctl net.ipv4.tcp_notsent_lowat
+  int ret = ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                         &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "TCP_NOTSENT_LOWAT failed.";
+  }
+#else
+  LOG_ERROR << "TCP_NOTSENT_LOWAT is not supported.";
+#endif
+}
+
+void Socket::setRecvTimestamps(bool on)
+{
+#ifdef SO_TIMESTAMPNS
+  int optval = on ? 1 : 0;
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_TIMESTAMPNS,
+                         &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_TIMESTAMPNS failed.";
+  }
+#else
+  LOG_ERROR << "SO_TIMESTAMPNS is not supported.";
+#endif
+}
+
+void Socket::setMaxPacingRate(uint32_t bytesPerSecond)
+{
+#ifdef SO_MAX_PACING_RATE
+  // ~0U is the kernel's "unlimited"
+  uint32_t optval = bytesPerSecond > 0 ? bytesPerSecond : ~0U;
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_MAX_PACING_RATE,
+                         &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_MAX_PACING_RATE failed.";
+  }
+#else
+  LOG_ERROR << "SO_MAX_PACING_RATE is not supported.";
+#endif
+}
+
 void Socket::setReuseAddr(bool on)
 {
   int optval = on ? 1 : 0;
@@ -126,6 +210,21 @@ void Socket::setReusePort(bool on)
 #endif
 }
 
+void Socket::setTcpFastOpen(int queueLength)
+{
+#ifdef TCP_FASTOPEN
+  int optval = queueLength;
+  int ret = ::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN,
+                         &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "TCP_FASTOPEN failed.";
+  }
+#else
+  LOG_ERROR << "TCP_FASTOPEN is not supported.";
+#endif
+}
+
 /// 设置SO_KEEPALIVE
 void Socket::setKeepAlive(bool on)
 {
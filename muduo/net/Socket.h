@@ -13,6 +13,8 @@
 
 #include "muduo/base/noncopyable.h"
 
+#include <stdint.h>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -45,6 +47,9 @@ class Socket : noncopyable
   int fd() const { return sockfd_; }
   // return true if success.
   bool getTcpInfo(struct tcp_info*) const;
+  /// Also gets tcpi_delivery_rate in bytes per second, which glibc's
+  /// struct tcp_info leaves out. Zero if the kernel doesn't report it.
+  bool getTcpInfo(struct tcp_info*, uint64_t* deliveryRate) const;
   bool getTcpInfoString(char* buf, int len) const;
 
   /// abort if address in use
@@ -65,6 +70,23 @@ class Socket : noncopyable
   ///
   void setTcpNoDelay(bool on);
 
+  ///
+  /// Set TCP_NOTSENT_LOWAT, writable only when unsent bytes in the kernel
+  /// are below @c bytes. Zero restores the system default.
+  ///
+  void setTcpNotSentLowat(int bytes);
+
+  ///
+  /// Enable/disable SO_TIMESTAMPNS, software receive timestamps
+  /// for Buffer::readFd(int, int*, Timestamp*)
+  ///
+  void setRecvTimestamps(bool on);
+
+  ///
+  /// SO_MAX_PACING_RATE in bytes per second, 0 removes the cap
+  ///
+  void setMaxPacingRate(uint32_t bytesPerSecond);
+
   ///
   /// Enable/disable SO_REUSEADDR
   ///
@@ -80,6 +102,13 @@ class Socket : noncopyable
   ///
   void setKeepAlive(bool on);
 
+  ///
+  /// TCP_FASTOPEN on a listening socket, at most @c queueLength
+  /// connections whose SYN carried data wait for accept(), 0 disables.
+  /// The server side also needs bit 2 of sysctl net.ipv4.tcp_fastopen.
+  ///
+  void setTcpFastOpen(int queueLength);
+
  private:
   const int sockfd_;
 };
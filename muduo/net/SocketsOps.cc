@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>  // snprintf
+#include <stddef.h>  // offsetof
 #include <sys/socket.h>
 #include <sys/uio.h>  // readv
 #include <unistd.h>
@@ -64,6 +65,16 @@ const struct sockaddr* sockets::sockaddr_cast(const struct sockaddr_in* addr)
   return static_cast<const struct sockaddr*>(implicit_cast<const void*>(addr));
 }
 
+const struct sockaddr* sockets::sockaddr_cast(const struct sockaddr_storage* addr)
+{
+  return static_cast<const struct sockaddr*>(implicit_cast<const void*>(addr));
+}
+
+struct sockaddr* sockets::sockaddr_cast(struct sockaddr_storage* addr)
+{
+  return static_cast<struct sockaddr*>(implicit_cast<void*>(addr));
+}
+
 const struct sockaddr_in* sockets::sockaddr_in_cast(const struct sockaddr* addr)
 {
   return static_cast<const struct sockaddr_in*>(implicit_cast<const void*>(addr));
@@ -73,12 +84,36 @@ const struct sockaddr_in6* sockets::sockaddr_in6_cast(const struct sockaddr* add
 {
   return static_cast<const struct sockaddr_in6*>(implicit_cast<const void*>(addr));
 }
+
+const struct sockaddr_un* sockets::sockaddr_un_cast(const struct sockaddr* addr)
+{
+  return static_cast<const struct sockaddr_un*>(implicit_cast<const void*>(addr));
+}
+
+socklen_t sockets::sockaddrLength(const struct sockaddr* addr)
+{
+  if (addr->sa_family == AF_UNIX)
+  {
+    const struct sockaddr_un* addrun = sockaddr_un_cast(addr);
+    const size_t maxLen = sizeof addrun->sun_path;
+    size_t len = addrun->sun_path[0] == '\0'
+        ? 1 + ::strnlen(addrun->sun_path + 1, maxLen - 1)  // abstract
+        : ::strnlen(addrun->sun_path, maxLen);
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+  }
+  else if (addr->sa_family == AF_INET)
+  {
+    return static_cast<socklen_t>(sizeof(struct sockaddr_in));
+  }
+  return static_cast<socklen_t>(sizeof(struct sockaddr_in6));
+}
 /// 核心函数, create, bind, listen, connect, readv, 
 // 创建socket，返回文件描述符
 int sockets::createNonblockingOrDie(sa_family_t family)
 {
+  const int protocol = family == AF_UNIX ? 0 : IPPROTO_TCP;
 #if VALGRIND
-  int sockfd = ::socket(family, SOCK_STREAM, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -86,7 +121,7 @@ int sockets::createNonblockingOrDie(sa_family_t family)
 
   setNonBlockAndCloseOnExec(sockfd);
 #else
-  int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -95,9 +130,19 @@ int sockets::createNonblockingOrDie(sa_family_t family)
   return sockfd;
 }
 
+int sockets::createUdpNonblockingOrDie(sa_family_t family)
+{
+  int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (sockfd < 0)
+  {
+    LOG_SYSFATAL << "sockets::createUdpNonblockingOrDie";
+  }
+  return sockfd;
+}
+
 void sockets::bindOrDie(int sockfd, const struct sockaddr* addr)
 {
-  int ret = ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+  int ret = ::bind(sockfd, addr, sockaddrLength(addr));
   if (ret < 0)
   {
     LOG_SYSFATAL << "sockets::bindOrDie";
@@ -113,7 +158,7 @@ void sockets::listenOrDie(int sockfd)
   }
 }
 
-int sockets::accept(int sockfd, struct sockaddr_in6* addr)
+int sockets::accept(int sockfd, struct sockaddr_storage* addr)
 {
   socklen_t addrlen = static_cast<socklen_t>(sizeof *addr);
 #if VALGRIND || defined (NO_ACCEPT4)
@@ -126,7 +171,11 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
   if (connfd < 0)
   {
     int savedErrno = errno;
-    LOG_SYSERR << "Socket::accept";
+    // another process sharing the listening socket got there first
+    if (savedErrno != EAGAIN)
+    {
+      LOG_SYSERR << "Socket::accept";
+    }
     switch (savedErrno)
     {
       case EAGAIN:
@@ -160,7 +209,7 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
 /// 调用socket底层方法
 int sockets::connect(int sockfd, const struct sockaddr* addr)
 {
-  return ::connect(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+  return ::connect(sockfd, addr, sockaddrLength(addr));
 }
 
 ssize_t sockets::read(int sockfd, void *buf, size_t count)
@@ -197,6 +246,11 @@ void sockets::shutdownWrite(int sockfd)
 void sockets::toIpPort(char* buf, size_t size,
                        const struct sockaddr* addr)
 {
+  if (addr->sa_family == AF_UNIX)
+  {
+    toIp(buf, size, addr);
+    return;
+  }
   if (addr->sa_family == AF_INET6)
   {
     buf[0] = '[';
@@ -231,6 +285,23 @@ void sockets::toIp(char* buf, size_t size,
     const struct sockaddr_in6* addr6 = sockaddr_in6_cast(addr);
     ::inet_ntop(AF_INET6, &addr6->sin6_addr, buf, static_cast<socklen_t>(size));
   }
+  else if (addr->sa_family == AF_UNIX)
+  {
+    // "@name" for abstract, "" for unnamed
+    const struct sockaddr_un* addrun = sockaddr_un_cast(addr);
+    const size_t maxLen = sizeof addrun->sun_path;
+    if (addrun->sun_path[0] == '\0')
+    {
+      size_t len = ::strnlen(addrun->sun_path + 1, maxLen - 1);
+      snprintf(buf, size, "%s%.*s", len > 0 ? "@" : "",
+               static_cast<int>(len), addrun->sun_path + 1);
+    }
+    else
+    {
+      snprintf(buf, size, "%.*s",
+               static_cast<int>(::strnlen(addrun->sun_path, maxLen)), addrun->sun_path);
+    }
+  }
 }
 
 void sockets::fromIpPort(const char* ip, uint16_t port,
@@ -270,9 +341,9 @@ int sockets::getSocketError(int sockfd)
   }
 }
 
-struct sockaddr_in6 sockets::getLocalAddr(int sockfd)
+struct sockaddr_storage sockets::getLocalAddr(int sockfd)
 {
-  struct sockaddr_in6 localaddr;
+  struct sockaddr_storage localaddr;
   memZero(&localaddr, sizeof localaddr);
   socklen_t addrlen = static_cast<socklen_t>(sizeof localaddr);
   if (::getsockname(sockfd, sockaddr_cast(&localaddr), &addrlen) < 0)
@@ -282,9 +353,9 @@ struct sockaddr_in6 sockets::getLocalAddr(int sockfd)
   return localaddr;
 }
 
-struct sockaddr_in6 sockets::getPeerAddr(int sockfd)
+struct sockaddr_storage sockets::getPeerAddr(int sockfd)
 {
-  struct sockaddr_in6 peeraddr;
+  struct sockaddr_storage peeraddr;
   memZero(&peeraddr, sizeof peeraddr);
   socklen_t addrlen = static_cast<socklen_t>(sizeof peeraddr);
   if (::getpeername(sockfd, sockaddr_cast(&peeraddr), &addrlen) < 0)
@@ -296,19 +367,21 @@ struct sockaddr_in6 sockets::getPeerAddr(int sockfd)
 
 bool sockets::isSelfConnect(int sockfd)
 {
-  struct sockaddr_in6 localaddr = getLocalAddr(sockfd);
-  struct sockaddr_in6 peeraddr = getPeerAddr(sockfd);
-  if (localaddr.sin6_family == AF_INET)
+  struct sockaddr_storage localaddr = getLocalAddr(sockfd);
+  struct sockaddr_storage peeraddr = getPeerAddr(sockfd);
+  if (localaddr.ss_family == AF_INET)
   {
-    const struct sockaddr_in* laddr4 = reinterpret_cast<struct sockaddr_in*>(&localaddr);
-    const struct sockaddr_in* raddr4 = reinterpret_cast<struct sockaddr_in*>(&peeraddr);
+    const struct sockaddr_in* laddr4 = sockaddr_in_cast(sockaddr_cast(&localaddr));
+    const struct sockaddr_in* raddr4 = sockaddr_in_cast(sockaddr_cast(&peeraddr));
     return laddr4->sin_port == raddr4->sin_port
         && laddr4->sin_addr.s_addr == raddr4->sin_addr.s_addr;
   }
-  else if (localaddr.sin6_family == AF_INET6)
+  else if (localaddr.ss_family == AF_INET6)
   {
-    return localaddr.sin6_port == peeraddr.sin6_port
-        && memcmp(&localaddr.sin6_addr, &peeraddr.sin6_addr, sizeof localaddr.sin6_addr) == 0;
+    const struct sockaddr_in6* laddr6 = sockaddr_in6_cast(sockaddr_cast(&localaddr));
+    const struct sockaddr_in6* raddr6 = sockaddr_in6_cast(sockaddr_cast(&peeraddr));
+    return laddr6->sin6_port == raddr6->sin6_port
+        && memcmp(&laddr6->sin6_addr, &raddr6->sin6_addr, sizeof laddr6->sin6_addr) == 0;
   }
   else
   {
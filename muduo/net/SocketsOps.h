@@ -12,6 +12,7 @@
 #define MUDUO_NET_SOCKETSOPS_H
 
 #include <arpa/inet.h>
+#include <sys/un.h>
 
 namespace muduo
 {
@@ -24,11 +25,15 @@ namespace sockets
 /// Creates a non-blocking socket file descriptor,
 /// abort if any error.
 int createNonblockingOrDie(sa_family_t family);
+///
+/// Creates a non-blocking UDP socket file descriptor,
+/// abort if any error.
+int createUdpNonblockingOrDie(sa_family_t family);
 
 int  connect(int sockfd, const struct sockaddr* addr);
 void bindOrDie(int sockfd, const struct sockaddr* addr);
 void listenOrDie(int sockfd);
-int  accept(int sockfd, struct sockaddr_in6* addr);
+int  accept(int sockfd, struct sockaddr_storage* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
@@ -50,11 +55,18 @@ int getSocketError(int sockfd);
 const struct sockaddr* sockaddr_cast(const struct sockaddr_in* addr);
 const struct sockaddr* sockaddr_cast(const struct sockaddr_in6* addr);
 struct sockaddr* sockaddr_cast(struct sockaddr_in6* addr);
+const struct sockaddr* sockaddr_cast(const struct sockaddr_storage* addr);
+struct sockaddr* sockaddr_cast(struct sockaddr_storage* addr);
 const struct sockaddr_in* sockaddr_in_cast(const struct sockaddr* addr);
 const struct sockaddr_in6* sockaddr_in6_cast(const struct sockaddr* addr);
+const struct sockaddr_un* sockaddr_un_cast(const struct sockaddr* addr);
+
+/// Length to pass to bind(2)/connect(2), an abstract AF_UNIX name
+/// is taken up to its first '\0'.
+socklen_t sockaddrLength(const struct sockaddr* addr);
 
-struct sockaddr_in6 getLocalAddr(int sockfd);
-struct sockaddr_in6 getPeerAddr(int sockfd);
+struct sockaddr_storage getLocalAddr(int sockfd);
+struct sockaddr_storage getPeerAddr(int sockfd);
 bool isSelfConnect(int sockfd);
 
 }  // namespace sockets
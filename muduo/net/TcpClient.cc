@@ -13,7 +13,9 @@
 #include "muduo/net/Connector.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/SocketsOps.h"
+#include "muduo/net/Transport.h"
 
+#include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
 
 using namespace muduo;
@@ -55,14 +57,15 @@ TcpClient::TcpClient(EventLoop* loop,
                      const InetAddress& serverAddr,
                      const string& nameArg)
   : loop_(CHECK_NOTNULL(loop)),
-
     connector_(new Connector(loop, serverAddr)),
     name_(nameArg),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     retry_(false),
     connect_(true),
-    nextConnId_(1)
+    nextConnId_(1),
+    fastOpenHits_(0),
+    fastOpenMisses_(0)
 {
   /// 注册connector_连接后回调函数
   connector_->setNewConnectionCallback(
@@ -72,6 +75,29 @@ TcpClient::TcpClient(EventLoop* loop,
            << "] - connector " << get_pointer(connector_);
 }
 
+TcpClient::TcpClient(EventLoop* loop,
+                     Resolver* resolver,
+                     const string& host,
+                     uint16_t port,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    connector_(new Connector(loop, resolver, host, port)),
+    name_(nameArg),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    retry_(false),
+    connect_(true),
+    nextConnId_(1),
+    fastOpenHits_(0),
+    fastOpenMisses_(0)
+{
+  connector_->setNewConnectionCallback(
+      std::bind(&TcpClient::newConnection, this, _1));
+  // FIXME setConnectFailedCallback
+  LOG_INFO << "TcpClient::TcpClient[" << name_
+           << "] - connector " << get_pointer(connector_);
+}
+
 TcpClient::~TcpClient()
 {
   LOG_INFO << "TcpClient::~TcpClient[" << name_
@@ -103,12 +129,22 @@ TcpClient::~TcpClient()
   }
 }
 
+void TcpClient::setRetryJitter(double fraction)
+{
+  connector_->setRetryJitter(fraction);
+}
+
+void TcpClient::setFastOpen(bool on)
+{
+  connector_->setFastOpen(on);
+}
+
 /// 连接, 调用connector_
 void TcpClient::connect()
 {
   // FIXME: check state
   LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
-           << connector_->serverAddress().toIpPort();
+           << connector_->serverName();
   /// 连接
   connect_ = true;
   connector_->start();
@@ -137,7 +173,9 @@ void TcpClient::stop()
 void TcpClient::newConnection(int sockfd)
 {
   loop_->assertInLoopThread();
-  InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+  // before the handshake of TCP Fast Open, getpeername() says ENOTCONN
+  InetAddress peerAddr(connector_->fastOpen() ? connector_->serverAddress()
+                                              : InetAddress(sockets::getPeerAddr(sockfd)));
   char buf[32];
   snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
   ++nextConnId_;
@@ -156,6 +194,10 @@ void TcpClient::newConnection(int sockfd)
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  if (transportFactory_)
+  {
+    conn->setTransport(transportFactory_());
+  }
   conn->setCloseCallback(
       std::bind(&TcpClient::removeConnection, this, _1)); // FIXME: unsafe
   {
@@ -177,6 +219,19 @@ void TcpClient::removeConnection(const TcpConnectionPtr& conn)
     assert(connection_ == conn);
     connection_.reset();
   }
+  if (connector_->fastOpen())
+  {
+    /// 连接关闭时socket还没关, TCP_INFO仍可读
+    struct tcp_info tcpi;
+    if (conn->getTcpInfo(&tcpi) && (tcpi.tcpi_options & TCPI_OPT_SYN_DATA))
+    {
+      ++fastOpenHits_;
+    }
+    else
+    {
+      ++fastOpenMisses_;
+    }
+  }
   /// 执行connectDestroyed
   loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
 
@@ -20,16 +20,23 @@ namespace net
 {
 
 class Connector;
+class Resolver;
 typedef std::shared_ptr<Connector> ConnectorPtr;
 
 class TcpClient : noncopyable
 {
  public:
   // TcpClient(EventLoop* loop);
-  // TcpClient(EventLoop* loop, const string& host, uint16_t port);
   TcpClient(EventLoop* loop,
             const InetAddress& serverAddr,
             const string& nameArg);
+  /// Resolves @c host through @c resolver before each connect,
+  /// see Connector. The resolver must belong to @c loop.
+  TcpClient(EventLoop* loop,
+            Resolver* resolver,
+            const string& host,
+            uint16_t port,
+            const string& nameArg);
   ~TcpClient();  // force out-line dtor, for std::unique_ptr members.
 
   void connect();
@@ -45,6 +52,17 @@ class TcpClient : noncopyable
   EventLoop* getLoop() const { return loop_; }
   bool retry() const { return retry_; }
   void enableRetry() { retry_ = true; }
+  /// See Connector::setRetryJitter(), call before connect().
+  void setRetryJitter(double fraction);
+  /// See Connector::setFastOpen(), call before connect(). The connection
+  /// callback then runs before the handshake, and what it sends rides in
+  /// the SYN.
+  void setFastOpen(bool on);
+
+  /// Closed connections whose SYN data was acked by the server, and those
+  /// where it was not, eg. no cookie yet. In loop thread.
+  int64_t fastOpenHits() const { return fastOpenHits_; }
+  int64_t fastOpenMisses() const { return fastOpenMisses_; }
 
   const string& name() const
   { return name_; }
@@ -64,6 +82,13 @@ class TcpClient : noncopyable
   void setWriteCompleteCallback(WriteCompleteCallback cb)
   { writeCompleteCallback_ = std::move(cb); }
 
+  /// Set transport factory, eg. TlsContext::clientTransportFactory().
+  /// The connection callback runs once the handshake is done, a connection
+  /// whose handshake fails is closed without being reported.
+  /// Not thread safe.
+  void setTransportFactory(TransportFactory factory)
+  { transportFactory_ = std::move(factory); }
+
  private:
   /// Not thread safe, but in loop
   void newConnection(int sockfd);
@@ -77,11 +102,14 @@ class TcpClient : noncopyable
   ConnectionCallback connectionCallback_;
   MessageCallback messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
+  TransportFactory transportFactory_;
   
   bool retry_;   // atomic
   bool connect_; // atomic
   // always in loop thread
   int nextConnId_;
+  int64_t fastOpenHits_;
+  int64_t fastOpenMisses_;
   mutable MutexLock mutex_;
 
   /// 封装connection
@@ -14,8 +14,13 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
+#include "muduo/net/TokenBucket.h"
+#include "muduo/net/Transport.h"
+
+#include <algorithm>
 
 #include <errno.h>
+#include <sched.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -42,18 +47,42 @@ TcpConnection::TcpConnection(EventLoop* loop,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)), // loop对象
+    migrating_(false),
+    directCalls_(0),
+    migrations_(0),
     name_(nameArg),
     state_(kConnecting),
     
     reading_(true),
+    autoCork_(false),
+    kernelReceiveTime_(false),
+    corkPending_(false),
+    handshaking_(false),
     socket_(new Socket(sockfd)),
     /// 构造channel_对象
     channel_(new Channel(loop, sockfd)),
+    transportHeld_(0),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    lowWaterMark_(0),
+    inputHighWaterMark_(0),
+    inputLowWaterMark_(0),
+    highInFlight_(0),
+    lowInFlight_(0),
+    inputThrottled_(false),
+    rateThrottled_(false),
+    outputQueued_(0)
+{
+  setChannelCallbacks();
+  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
+            << " fd=" << sockfd;
+  socket_->setKeepAlive(true);
+}
+
+/// 在channel中设置回调函数
+void TcpConnection::setChannelCallbacks()
 {
-  /// 在channel中设置回调函数
   /// 可读回调函数
   channel_->setReadCallback(
       std::bind(&TcpConnection::handleRead, this, _1));
@@ -64,9 +93,6 @@ TcpConnection::TcpConnection(EventLoop* loop,
       std::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(
       std::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
-            << " fd=" << sockfd;
-  socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
@@ -83,6 +109,11 @@ bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
   return socket_->getTcpInfo(tcpi);
 }
 
+bool TcpConnection::getTcpInfo(struct tcp_info* tcpi, uint64_t* deliveryRate) const
+{
+  return socket_->getTcpInfo(tcpi, deliveryRate);
+}
+
 string TcpConnection::getTcpInfoString() const
 {
   char buf[1024];
@@ -102,7 +133,7 @@ void TcpConnection::send(const StringPiece& message)
   if (state_ == kConnected)
   {
     /// 必须是创建eventloop的线程
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread())
     {
       sendInLoop(message);
     }
@@ -111,7 +142,7 @@ void TcpConnection::send(const StringPiece& message)
       /// 函数指针, 指向&TcpConnection::sendInLoop;
       void (TcpConnection::*fp)(const StringPiece& message) = &TcpConnection::sendInLoop;
       /// 在eventloop的线程中运行&TcpConnection::sendInLoop
-      loop_->runInLoop(
+      runInLoop(
           std::bind(fp,
                     this,     // FIXME
                     message.as_string()));
@@ -126,7 +157,7 @@ void TcpConnection::send(Buffer* buf)
   if (state_ == kConnected)
   {
     /// fd所属线程直接写
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread())
     {
       sendInLoop(buf->peek(), buf->readableBytes());
       buf->retrieveAll();
@@ -134,7 +165,7 @@ void TcpConnection::send(Buffer* buf)
     else
     {
       void (TcpConnection::*fp)(const StringPiece& message) = &TcpConnection::sendInLoop;
-      loop_->runInLoop(
+      runInLoop(
         /// 执行fp函数
           std::bind(fp,
                     this,     // FIXME
@@ -156,7 +187,7 @@ void TcpConnection::sendInLoop(const StringPiece& message)
 /// 发送数据, 核心是调用sockets::write
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool faultError = false;
@@ -165,12 +196,21 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     LOG_WARN << "disconnected, give up writing";
     return;
   }
+  // corked, leave it to flushCorkedInLoop()
+  if (autoCork_ && !channel_->isWriting() && !handshaking_)
+  {
+    if (!corkPending_)
+    {
+      corkPending_ = true;
+      getLoop()->runBeforePoll(followLoop(&TcpConnection::flushCorkedInLoop));
+    }
+  }
   // if no thing in output queue, try writing directly
   /// 没有正在写channel_ channal可写, 且没有要读的字节
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  else if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0 && !handshaking_)
   {
     /// 向sockets中channel_->fd()写data数据, 直接写, 写了nwrote字节
-    nwrote = sockets::write(channel_->fd(), data, len);
+    nwrote = writeFd(data, len);
     /// 写成功
     if (nwrote >= 0)
     {
@@ -178,7 +218,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
       if (remaining == 0 && writeCompleteCallback_)
       {
         /// 将writeCompleteCallback_回调函数加入到队列中, 执行之
-        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        getLoop()->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
       }
     }
     /// 写失败
@@ -205,16 +245,337 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         && oldLen < highWaterMark_
         && highWaterMarkCallback_)
     {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      getLoop()->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
     }
     //// 先放入outputbuffer
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
-    
-    if (!channel_->isWriting())
+    queueOutput(static_cast<const char*>(data)+nwrote, remaining, nwrote > 0);
+    if (backlogPolicy_.enabled())
+    {
+      checkBacklog();
+    }
+
+    // handshakeInLoop() starts writing once the transport is ready
+    if (!channel_->isWriting() && !corkPending_ && !handshaking_ && !rateThrottled_)
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+ssize_t TcpConnection::writeFd(const void* data, size_t len)
+{
+  if (!rateLimit_ && !sharedRateLimit_)
+  {
+    return writeSocket(data, len);
+  }
+
+  size_t granted = takeTokens(len);
+  // a transport retries with no less than it was offered, eg. OpenSSL
+  // fails a shorter retry of a pending record, so go into debt for it
+  size_t held = std::min(len, transportHeld_);
+  if (granted < held)
+  {
+    Timestamp now(Timestamp::now());
+    if (rateLimit_)
+    {
+      rateLimit_->charge(now, held - granted);
+    }
+    if (sharedRateLimit_)
+    {
+      sharedRateLimit_->charge(now, held - granted);
+    }
+    granted = held;
+  }
+  if (granted == 0)
+  {
+    throttleWriting(len);
+    errno = EWOULDBLOCK;
+    return -1;
+  }
+  ssize_t n = writeSocket(data, granted);
+  int savedErrno = errno;
+  size_t unused = n > 0 ? granted - static_cast<size_t>(n) : granted;
+  if (unused > 0)
+  {
+    if (rateLimit_)
+    {
+      rateLimit_->giveBack(unused);
+    }
+    if (sharedRateLimit_)
+    {
+      sharedRateLimit_->giveBack(unused);
+    }
+  }
+  errno = savedErrno;
+  return n;
+}
+
+ssize_t TcpConnection::writeSocket(const void* data, size_t len)
+{
+  ssize_t n = transport_ ? transport_->write(channel_->fd(), data, len)
+                         : sockets::write(channel_->fd(), data, len);
+  if (transport_)
+  {
+    // a short write may leave any of the bytes offered inside the transport
+    size_t written = n > 0 ? static_cast<size_t>(n) : 0;
+    transportHeld_ = std::max(transportHeld_ > written ? transportHeld_ - written : 0,
+                              len - written);
+  }
+  // TCP Fast Open without a cookie, the first write sent a bare SYN,
+  // the data goes once the socket turns writable
+  if (n < 0 && errno == EINPROGRESS)
+  {
+    errno = EWOULDBLOCK;
+  }
+  return n;
+}
+
+/// 从连接自己的和共享的令牌桶各取len个令牌, 取两者的较小值
+size_t TcpConnection::takeTokens(size_t len)
+{
+  Timestamp now(Timestamp::now());
+  size_t n = len;
+  if (rateLimit_)
+  {
+    n = rateLimit_->take(now, n);
+  }
+  if (sharedRateLimit_ && n > 0)
+  {
+    size_t shared = sharedRateLimit_->take(now, n);
+    if (rateLimit_)
+    {
+      rateLimit_->giveBack(n - shared);
+    }
+    n = shared;
+  }
+  return n;
+}
+
+void TcpConnection::throttleWriting(size_t want)
+{
+  rateThrottled_ = true;
+  if (channel_->isWriting())
+  {
+    channel_->disableWriting();
+  }
+  // wake up for a worthwhile write, not for every few bytes
+  const size_t kMinChunk = 4096;
+  size_t chunk = std::min(want, kMinChunk);
+  Timestamp now(Timestamp::now());
+  double wait = 0.0;
+  if (rateLimit_)
+  {
+    wait = std::max(wait, rateLimit_->waitFor(now, chunk));
+  }
+  if (sharedRateLimit_)
+  {
+    wait = std::max(wait, sharedRateLimit_->waitFor(now, chunk));
+  }
+  getLoop()->runAfter(wait, followLoop(&TcpConnection::resumeWritingInLoop));
+}
+
+void TcpConnection::resumeWritingInLoop()
+{
+  getLoop()->assertInLoopThread();
+  rateThrottled_ = false;
+  if (state_ == kDisconnected)
+  {
+    return;
+  }
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    channel_->enableWriting();
+  }
+  else if (state_ == kDisconnecting)
+  {
+    shutdownInLoop();
+  }
+}
+
+void TcpConnection::setRateLimit(double bytesPerSecond, size_t burst)
+{
+  rateLimit_.reset(bytesPerSecond > 0 ? new TokenBucket(bytesPerSecond, burst) : NULL);
+}
+
+void TcpConnection::setMaxPacingRate(uint32_t bytesPerSecond)
+{
+  socket_->setMaxPacingRate(bytesPerSecond);
+}
+
+void TcpConnection::setBacklogPolicy(const BacklogPolicy& policy,
+                                     const std::shared_ptr<BacklogStats>& stats)
+{
+  backlogPolicy_ = policy;
+  backlogStats_ = stats;
+  if (!policy.enabled())
+  {
+    pendingSends_.clear();
+  }
+}
+
+/// 追加到outputBuffer_, 有积压策略时记下每次send的位置和时间
+void TcpConnection::queueOutput(const void* data, size_t len, bool started)
+{
+  outputBuffer_.append(static_cast<const char*>(data), len);
+  if (backlogPolicy_.enabled())
+  {
+    PendingSend pending = { outputQueued_,
+                            outputQueued_ + static_cast<int64_t>(len),
+                            getLoop()->now(),
+                            started };
+    pendingSends_.push_back(pending);
+  }
+  outputQueued_ += static_cast<int64_t>(len);
+}
+
+void TcpConnection::checkBacklog()
+{
+  size_t backlog = outputBuffer_.readableBytes();
+  Timestamp now = getLoop()->now();
+  bool tooBig = backlogPolicy_.maxBytes > 0 && backlog > backlogPolicy_.maxBytes;
+  bool tooOld = backlogPolicy_.maxAge > 0
+      && !pendingSends_.empty()
+      && timeDifference(now, pendingSends_.front().queued) > backlogPolicy_.maxAge;
+  if (!tooBig && !tooOld)
+  {
+    return;
+  }
+
+  if (backlogPolicy_.action == BacklogPolicy::kDropOldest)
+  {
+    dropOldest(tooBig, now);
+  }
+  else if (state_ == kConnected)
+  {
+    LOG_WARN << "TcpConnection::checkBacklog [" << name_ << "] - slow consumer, "
+             << backlog << " bytes queued, disconnecting";
+    if (backlogStats_)
+    {
+      backlogStats_->disconnects.increment();
+    }
+    // nothing more will be written, give the memory back now
+    outputBuffer_.retrieveAll();
+    outputBuffer_.shrink(0);
+    pendingSends_.clear();
+    forceClose();
+  }
+}
+
+/// 丢弃最旧的整条消息, 已经写出一部分的那条保留, 否则对端收到的数据会错位;
+/// transport_可能已经收下(加密或压缩)的也保留
+void TcpConnection::dropOldest(bool tooBig, Timestamp now)
+{
+  size_t backlog = outputBuffer_.readableBytes();
+  size_t target = tooBig ? backlogPolicy_.maxBytes / 2 : backlog;
+  int64_t pinned = outputQueued_ - static_cast<int64_t>(backlog)
+      + static_cast<int64_t>(transportHeld_);
+  std::deque<PendingSend>::iterator first = pendingSends_.begin();
+  while (first != pendingSends_.end() && (first->started || first->begin < pinned))
+  {
+    ++first;
+  }
+  std::deque<PendingSend>::iterator last = first;
+  size_t dropped = 0;
+  while (last != pendingSends_.end()
+         && (backlog - dropped > target
+             || (backlogPolicy_.maxAge > 0
+                 && timeDifference(now, last->queued) > backlogPolicy_.maxAge)))
+  {
+    dropped += static_cast<size_t>(last->end - last->begin);
+    ++last;
+  }
+  if (dropped == 0)
+  {
+    return;
+  }
+
+  int64_t written = outputQueued_ - static_cast<int64_t>(backlog);
+  size_t offset = static_cast<size_t>(first->begin - written);
+  outputBuffer_.erase(offset, dropped);
+  size_t messages = static_cast<size_t>(last - first);
+  for (std::deque<PendingSend>::iterator it = last; it != pendingSends_.end(); ++it)
+  {
+    it->begin -= static_cast<int64_t>(dropped);
+    it->end -= static_cast<int64_t>(dropped);
+  }
+  pendingSends_.erase(first, last);
+  outputQueued_ -= static_cast<int64_t>(dropped);
+  LOG_DEBUG << "TcpConnection::dropOldest [" << name_ << "] - dropped "
+            << messages << " sends, " << dropped << " bytes";
+  if (backlogStats_)
+  {
+    backlogStats_->droppedMessages.add(static_cast<int64_t>(messages));
+    backlogStats_->droppedBytes.add(static_cast<int64_t>(dropped));
+  }
+}
+
+/// outputBuffer_已写出n字节, 跌破低水位时通知生产者
+void TcpConnection::retrieveWritten(size_t n)
+{
+  size_t oldLen = outputBuffer_.readableBytes();
+  outputBuffer_.retrieve(n);
+  size_t remaining = outputBuffer_.readableBytes();
+  int64_t written = outputQueued_ - static_cast<int64_t>(remaining);
+  while (!pendingSends_.empty() && pendingSends_.front().end <= written)
+  {
+    pendingSends_.pop_front();
+  }
+  if (!pendingSends_.empty() && pendingSends_.front().begin < written)
+  {
+    pendingSends_.front().started = true;
+  }
+  if (lowWaterMarkCallback_
+      && oldLen > lowWaterMark_
+      && remaining <= lowWaterMark_
+      && remaining > 0)
+  {
+    getLoop()->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(), remaining));
+  }
+}
+
+/// 一次write写出本轮循环中积攒的数据
+void TcpConnection::flushCorkedInLoop()
+{
+  getLoop()->assertInLoopThread();
+  corkPending_ = false;
+  if (state_ == kDisconnected || channel_->isWriting() || rateThrottled_)
+  {
+    return;
+  }
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    ssize_t n = writeFd(outputBuffer_.peek(), outputBuffer_.readableBytes());
+    if (n > 0)
+    {
+      retrieveWritten(n);
+    }
+    else if (errno != EWOULDBLOCK)
+    {
+      LOG_SYSERR << "TcpConnection::flushCorkedInLoop";
+      if (errno == EPIPE || errno == ECONNRESET)
+      {
+        return;
+      }
+    }
+  }
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    if (!rateThrottled_)
     {
       channel_->enableWriting();
     }
   }
+  else
+  {
+    if (writeCompleteCallback_)
+    {
+      getLoop()->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+      shutdownInLoop();
+    }
+  }
 }
 
 
@@ -226,18 +587,22 @@ void TcpConnection::shutdown()
   {
     setState(kDisconnecting);
     // FIXME: shared_from_this()?
-    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+    runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
   }
 }
 
 
 void TcpConnection::shutdownInLoop()
 {
-  loop_->assertInLoopThread();
-  /// 如果不再写
-  if (!channel_->isWriting())
+  getLoop()->assertInLoopThread();
+  /// 如果不再写, 被cork住的数据由flushCorkedInLoop写完再shutdown
+  if (!channel_->isWriting() && !corkPending_ && !rateThrottled_)
   {
     // we are not writing
+    if (transport_)
+    {
+      transport_->shutdown(channel_->fd());
+    }
     socket_->shutdownWrite();
   }
 }
@@ -249,7 +614,7 @@ void TcpConnection::forceClose()
   if (state_ == kConnected || state_ == kDisconnecting)
   {
     setState(kDisconnecting);
-    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
   }
 }
 
@@ -258,7 +623,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
   if (state_ == kConnected || state_ == kDisconnecting)
   {
     setState(kDisconnecting);
-    loop_->runAfter(
+    getLoop()->runAfter(
         seconds,
         makeWeakCallback(shared_from_this(),
                          &TcpConnection::forceClose));  // not forceCloseInLoop to avoid race condition
@@ -267,7 +632,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
 
 void TcpConnection::forceCloseInLoop()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   if (state_ == kConnected || state_ == kDisconnecting)
   {
     // as if we received 0 byte in handleRead();
@@ -275,6 +640,179 @@ void TcpConnection::forceCloseInLoop()
   }
 }
 
+void TcpConnection::migrateTo(EventLoop* target)
+{
+  {
+  MutexLockGuard lock(mutex_);
+  ++migrations_;
+  migrating_ = true;
+  }
+  // queued, never run right away: handleEvent() of the old channel may be on the stack
+  queueInLoop(std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target));
+}
+
+/// 之前直接排进本loop的调用要先执行, 等它们都入队后把真正的迁移排在后面
+void TcpConnection::migrateInLoop(EventLoop* target)
+{
+  getLoop()->assertInLoopThread();
+  // a queueInLoop() that missed migrating_ is between two instructions
+  while (directCalls_.load() > 0)
+  {
+    sched_yield();
+  }
+  getLoop()->queueInLoop(std::bind(&TcpConnection::moveInLoop, shared_from_this(), target));
+}
+
+/// 在原loop线程里把channel从poller摘下, 换成属于目标loop的新channel,
+/// 缓冲区和其它状态都在TcpConnection里, 不用搬
+void TcpConnection::moveInLoop(EventLoop* target)
+{
+  if (!getLoop()->isInLoopThread())
+  {
+    // queued behind an earlier move
+    getLoop()->queueInLoop(std::bind(&TcpConnection::moveInLoop, shared_from_this(), target));
+    return;
+  }
+  if (state_ != kConnected || target == loop_)
+  {
+    MutexLockGuard lock(mutex_);
+    --migrations_;
+    finishMigrating();
+    return;
+  }
+  LOG_DEBUG << "TcpConnection::moveInLoop [" << name_ << "] fd=" << channel_->fd();
+  bool reading = channel_->isReading();
+  bool writing = channel_->isWriting();
+  channel_->disableAll();
+  channel_->remove();
+  channel_.reset(new Channel(target, socket_->fd()));
+  setChannelCallbacks();
+  channel_->tie(shared_from_this());
+  EventLoop* from = getLoop();
+  {
+  MutexLockGuard lock(mutex_);
+  loop_ = target;
+  --migrations_;
+  finishMigrating();
+  }
+  target->queueInLoop(
+      std::bind(&TcpConnection::attachInLoop, shared_from_this(), from, reading, writing));
+}
+
+/// 没有迁移在等, 队列也空了, 跨线程调用恢复直接排进loop
+void TcpConnection::finishMigrating()
+{
+  mutex_.assertLocked();
+  if (migrations_ == 0 && pendingFunctors_.empty())
+  {
+    migrating_ = false;
+  }
+}
+
+void TcpConnection::attachInLoop(EventLoop* from, bool reading, bool writing)
+{
+  getLoop()->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    return;
+  }
+  // a send() run here meanwhile may have enabled writing already
+  if (reading && !channel_->isReading())
+  {
+    channel_->enableReading();
+  }
+  if (writing && !channel_->isWriting())
+  {
+    channel_->enableWriting();
+  }
+  if (migrateCallback_)
+  {
+    migrateCallback_(shared_from_this(), from);
+  }
+}
+
+void TcpConnection::runInLoop(Functor cb)
+{
+  if (getLoop()->isInLoopThread())
+  {
+    cb();
+  }
+  else
+  {
+    queueInLoop(std::move(cb));
+  }
+}
+
+/// 平时直接排进所在loop; 迁移期间先排进连接自己的队列,
+/// 整个队列跟着连接走, 顺序不变
+void TcpConnection::queueInLoop(Functor cb)
+{
+  // counted, so migrateInLoop() can tell when these have all reached the old loop
+  directCalls_.fetch_add(1);
+  if (!migrating_.load())
+  {
+    getLoop()->queueInLoop(std::move(cb));
+    directCalls_.fetch_sub(1);
+    return;
+  }
+  directCalls_.fetch_sub(1);
+
+  EventLoop* loop = NULL;
+  {
+  MutexLockGuard lock(mutex_);
+  if (pendingFunctors_.empty())
+  {
+    loop = loop_;
+  }
+  pendingFunctors_.push_back(std::move(cb));
+  }
+  if (loop)
+  {
+    loop->queueInLoop(std::bind(&TcpConnection::doPendingFunctors, shared_from_this()));
+  }
+}
+
+void TcpConnection::doPendingFunctors()
+{
+  std::vector<Functor> functors;
+  {
+  MutexLockGuard lock(mutex_);
+  if (!getLoop()->isInLoopThread())
+  {
+    // queued in the loop we migrated from
+    getLoop()->queueInLoop(std::bind(&TcpConnection::doPendingFunctors, shared_from_this()));
+    return;
+  }
+  functors.swap(pendingFunctors_);
+  }
+
+  // the move itself is queued in the loop, so they all run here
+  for (Functor& functor : functors)
+  {
+    functor();
+  }
+
+  MutexLockGuard lock(mutex_);
+  finishMigrating();
+}
+
+TcpConnection::Functor TcpConnection::followLoop(void (TcpConnection::*method)())
+{
+  return std::bind(&TcpConnection::runFollowing,
+                   std::weak_ptr<TcpConnection>(shared_from_this()), method);
+}
+
+void TcpConnection::runFollowing(const std::weak_ptr<TcpConnection>& weak,
+                                 void (TcpConnection::*method)())
+{
+  TcpConnectionPtr conn(weak.lock());
+  if (conn)
+  {
+    // a timer of the old loop fires after migrateTo()
+    conn->runInLoop(std::bind(method, conn));
+  }
+}
+
 const char* TcpConnection::stateToString() const
 {
   switch (state_)
@@ -298,30 +836,45 @@ void TcpConnection::setTcpNoDelay(bool on)
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setTcpNotSentLowat(int bytes)
+{
+  socket_->setTcpNotSentLowat(bytes);
+}
+
+void TcpConnection::setKernelReceiveTime(bool on)
+{
+  socket_->setRecvTimestamps(on);
+  kernelReceiveTime_ = on;
+}
+
 void TcpConnection::startRead()
 {
-  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
+  runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
 }
 
 void TcpConnection::startReadInLoop()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   /// 设置channel可读
   if (!reading_ || !channel_->isReading())
   {
-    channel_->enableReading();
+    if (!inputThrottled_)
+    {
+      channel_->enableReading();
+      readTransportPending();
+    }
     reading_ = true;
   }
 }
 
 void TcpConnection::stopRead()
 {
-  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
+  runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
 }
 
 void TcpConnection::stopReadInLoop()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   if (reading_ || channel_->isReading())
   {
     channel_->disableReading();
@@ -329,26 +882,159 @@ void TcpConnection::stopReadInLoop()
   }
 }
 
+void TcpConnection::incInFlight()
+{
+  int n = inFlight_.incrementAndGet();
+  if (highInFlight_ > 0 && n >= highInFlight_ && !inputThrottled_)
+  {
+    runInLoop(std::bind(&TcpConnection::updateInputThrottleInLoop, shared_from_this()));
+  }
+}
+
+void TcpConnection::decInFlight()
+{
+  int n = inFlight_.decrementAndGet();
+  // a resume held back by the byte mark needs another look later on
+  if (highInFlight_ > 0 && n <= lowInFlight_ && inputThrottled_)
+  {
+    runInLoop(std::bind(&TcpConnection::updateInputThrottleInLoop, shared_from_this()));
+  }
+}
+
+void TcpConnection::resumeReadIfBelowLowMark()
+{
+  runInLoop(std::bind(&TcpConnection::updateInputThrottleInLoop, shared_from_this()));
+}
+
+/// 输入端背压, 根据未处理字节数和in-flight请求数暂停/恢复读
+void TcpConnection::updateInputThrottleInLoop()
+{
+  getLoop()->assertInLoopThread();
+  if (state_ != kConnected)
+  {
+    return;
+  }
+  const size_t unprocessed = inputBuffer_.readableBytes();
+  const int inFlight = inFlight_.get();
+  if (!inputThrottled_)
+  {
+    if ((inputHighWaterMark_ > 0 && unprocessed >= inputHighWaterMark_)
+        || (highInFlight_ > 0 && inFlight >= highInFlight_))
+    {
+      LOG_DEBUG << name_ << " pause reading, unprocessed=" << unprocessed
+                << " inFlight=" << inFlight;
+      inputThrottled_ = true;
+      if (channel_->isReading())
+      {
+        channel_->disableReading();
+      }
+      // a decInFlight() that read the flag before it was set won't call back
+      if (highInFlight_ > 0 && inFlight_.get() <= lowInFlight_)
+      {
+        updateInputThrottleInLoop();
+      }
+    }
+  }
+  else if ((inputHighWaterMark_ == 0 || unprocessed <= inputLowWaterMark_)
+           && (highInFlight_ == 0 || inFlight <= lowInFlight_))
+  {
+    LOG_DEBUG << name_ << " resume reading, unprocessed=" << unprocessed
+              << " inFlight=" << inFlight;
+    inputThrottled_ = false;
+    if (reading_)
+    {
+      channel_->enableReading();
+      readTransportPending();
+    }
+    if (unprocessed > 0)
+    {
+      messageCallback_(shared_from_this(), &inputBuffer_, getLoop()->pollReturnTime());
+      updateInputThrottleInLoop();
+    }
+  }
+}
+
 /// 连接建立函数, 
 /// 注册TcpConnection的channel到loop poller的epoll
 void TcpConnection::connectEstablished()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   assert(state_ == kConnecting);
   setState(kConnected);
   // channel绑定到Connection, 后者用shared_ptr维护
   channel_->tie(shared_from_this());
   /// 设置TcpConnection的channel, 向poller注册监听的fd
   channel_->enableReading();
+  if (transport_)
+  {
+    handshaking_ = true;
+    handshakeInLoop(Timestamp::now());
+    return;
+  }
   /// 建立连接后, 会调用连接回调函数
   connectionCallback_(shared_from_this());
 }
 
+void TcpConnection::setTransport(std::unique_ptr<Transport> transport)
+{
+  assert(state_ == kConnecting);
+  transport_ = std::move(transport);
+}
+
+/// 推进transport_的握手, 完成后才调用连接回调函数
+void TcpConnection::handshakeInLoop(Timestamp receiveTime)
+{
+  getLoop()->assertInLoopThread();
+  switch (transport_->handshake(channel_->fd()))
+  {
+    case Transport::kHandshakeWantRead:
+      if (channel_->isWriting())
+      {
+        channel_->disableWriting();
+      }
+      break;
+
+    case Transport::kHandshakeWantWrite:
+      if (!channel_->isWriting())
+      {
+        channel_->enableWriting();
+      }
+      break;
+
+    case Transport::kHandshakeFailed:
+      LOG_ERROR << "TcpConnection::handshakeInLoop [" << name_ << "] - handshake failed";
+      handleClose();
+      break;
+
+    case Transport::kHandshakeDone:
+      handshaking_ = false;
+      // sends made during the handshake are waiting in outputBuffer_
+      if (outputBuffer_.readableBytes() > 0)
+      {
+        if (!channel_->isWriting())
+        {
+          channel_->enableWriting();
+        }
+      }
+      else if (channel_->isWriting())
+      {
+        channel_->disableWriting();
+      }
+      connectionCallback_(shared_from_this());
+      // application data may have arrived along with the last handshake message
+      if (state_ == kConnected && channel_->isReading())
+      {
+        handleRead(receiveTime);
+      }
+      break;
+  }
+}
+
 
 /// 连接销毁， 关闭channel
 void TcpConnection::connectDestroyed()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
 
   if (state_ == kConnected)
   {
@@ -356,31 +1042,93 @@ void TcpConnection::connectDestroyed()
     /// 关闭channel
     channel_->disableAll();
 
-    // 关闭连接时也会调用连接回调函数
-    connectionCallback_(shared_from_this());
+    // 关闭连接时也会调用连接回调函数, 握手没完成的连接没报告过建立
+    if (!handshaking_)
+    {
+      connectionCallback_(shared_from_this());
+    }
   }
   channel_->remove();
 }
 
 
+/// transport_留着的输入poller不会通知, 本轮事件处理完再读
+void TcpConnection::readTransportPending()
+{
+  if (transport_ && transport_->pending() && channel_->isReading())
+  {
+    getLoop()->queueInLoop(followLoop(&TcpConnection::readPendingInLoop));
+  }
+}
+
+void TcpConnection::readPendingInLoop()
+{
+  getLoop()->assertInLoopThread();
+  if (state_ == kConnected && channel_->isReading() && !handshaking_)
+  {
+    handleRead(Timestamp::now());
+  }
+}
+
 /// handleRead, 实际调用messageCallback_回调函数
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   int savedErrno = 0;
 
+  if (handshaking_)
+  {
+    handshakeInLoop(receiveTime);
+    return;
+  }
+
   /// 一旦可读, inputBuffer_自动读取channel_->fd()的数据。放入inputBuffer_的writable中了
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = 0;
+  size_t budget = getLoop()->readBudget();
+  if (transport_)
+  {
+    n = transport_->read(channel_->fd(), &inputBuffer_, &savedErrno);
+  }
+  else if (kernelReceiveTime_ || budget > 0)
+  {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno,
+                            kernelReceiveTime_ ? &receiveTime : NULL, budget);
+    if (budget > 0)
+    {
+      // probably more to read, let the other connections go first next time
+      channel_->setOverBudget(n > 0 && static_cast<size_t>(n) >= budget);
+    }
+  }
+  else
+  {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  }
   if (n > 0)
   {
     /// 数据读取到inputbuffer中之后, 再自动执行回调函数(用户注册的数据处理函数)
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (inputHighWaterMark_ > 0 || highInFlight_ > 0)
+    {
+      updateInputThrottleInLoop();
+    }
+    readTransportPending();
   }
   /// 没有字节说明读完毕
   else if (n == 0)
   {
     handleClose();
   }
+  else if (transport_)
+  {
+    // EAGAIN: only protocol records this time
+    if (savedErrno != EAGAIN)
+    {
+      errno = savedErrno;
+      LOG_SYSERR << "TcpConnection::handleRead";
+      // the stream can't be decoded any further
+      handleClose();
+    }
+  }
   else
   {
     errno = savedErrno;
@@ -392,18 +1140,21 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 /// 写回调函数
 void TcpConnection::handleWrite()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
+  if (handshaking_)
+  {
+    handshakeInLoop(getLoop()->pollReturnTime());
+    return;
+  }
   /// channel可写
   if (channel_->isWriting())
   {
 
     /// 写socket, 向fd从
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
+    ssize_t n = writeFd(outputBuffer_.peek(), outputBuffer_.readableBytes());
     if (n > 0)
     {
-      outputBuffer_.retrieve(n);
+      retrieveWritten(n);
       if (outputBuffer_.readableBytes() == 0)
       {
         channel_->disableWriting();
@@ -411,7 +1162,7 @@ void TcpConnection::handleWrite()
         /// 执行写毕回调函数
         if (writeCompleteCallback_)
         {
-          loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+          getLoop()->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
         }
         if (state_ == kDisconnecting)
         {
@@ -419,7 +1170,7 @@ void TcpConnection::handleWrite()
         }
       }
     }
-    else
+    else if (errno != EWOULDBLOCK)
     {
       LOG_SYSERR << "TcpConnection::handleWrite";
       // if (state_ == kDisconnecting)
@@ -438,7 +1189,7 @@ void TcpConnection::handleWrite()
 
 void TcpConnection::handleClose()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
   assert(state_ == kConnected || state_ == kDisconnecting);
   // we don't close fd, leave it to dtor, so we can find leaks easily.
@@ -447,7 +1198,11 @@ void TcpConnection::handleClose()
   channel_->disableAll();
 
   TcpConnectionPtr guardThis(shared_from_this());
-  connectionCallback_(guardThis);
+  /// 握手失败或对端中止的连接没报告过建立, 只做清理
+  if (!handshaking_)
+  {
+    connectionCallback_(guardThis);
+  }
   // must be the last line
   closeCallback_(guardThis);
 }
@@ -11,14 +11,20 @@
 #ifndef MUDUO_NET_TCPCONNECTION_H
 #define MUDUO_NET_TCPCONNECTION_H
 
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Mutex.h"
 #include "muduo/base/noncopyable.h"
 #include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Buffer.h"
 #include "muduo/net/InetAddress.h"
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <vector>
 
 #include <boost/any.hpp>
 
@@ -41,6 +47,39 @@ class Channel;
 
 class EventLoop;
 class Socket;
+class TokenBucket;
+class Transport;
+
+///
+/// Limits on the output backlog of a consumer that stops reading,
+/// see TcpConnection::setBacklogPolicy(). Zero means no limit.
+///
+struct BacklogPolicy
+{
+  enum Action
+  {
+    kDisconnect,  // force close the connection
+    kDropOldest,  // drop whole queued sends, oldest first
+  };
+
+  BacklogPolicy()
+    : maxBytes(0), maxAge(0.0), action(kDisconnect)
+  { }
+
+  bool enabled() const { return maxBytes > 0 || maxAge > 0; }
+
+  size_t maxBytes;  // bytes waiting in outputBuffer()
+  double maxAge;    // seconds the oldest unsent byte has waited
+  Action action;
+};
+
+/// What the policy did, shared by the connections of a server. Thread safe.
+struct BacklogStats : noncopyable
+{
+  AtomicInt64 disconnects;
+  AtomicInt64 droppedMessages;
+  AtomicInt64 droppedBytes;
+};
 
 ///
 /// TCP connection, for both client and server usage.
@@ -70,6 +109,8 @@ class TcpConnection : noncopyable,
   bool disconnected() const { return state_ == kDisconnected; }
   // return true if success.
   bool getTcpInfo(struct tcp_info*) const;
+  /// See Socket::getTcpInfo().
+  bool getTcpInfo(struct tcp_info*, uint64_t* deliveryRate) const;
   string getTcpInfoString() const;
 
   // 发送message
@@ -82,12 +123,90 @@ class TcpConnection : noncopyable,
   void forceClose();
   void forceCloseWithDelay(double seconds);
   void setTcpNoDelay(bool on);
+  /// Limits unsent bytes queued in the kernel, see Socket::setTcpNotSentLowat().
+  void setTcpNotSentLowat(int bytes);
+
+  /// Passes the kernel's receive timestamp of the data, instead of the
+  /// time poll returned, as MessageCallback's receiveTime, so it includes
+  /// the time spent queued in the socket. EventLoop::pollReturnTime() is
+  /// still the time the loop saw it. Data that arrives without a timestamp
+  /// keeps the poll time. Ignored with a transport, eg. TLS.
+  /// Off by default. Must be called in the loop thread, or before
+  /// connectEstablished().
+  void setKernelReceiveTime(bool on);
+
+  /// Egress rate limit, a token bucket of @c burst bytes refilled at
+  /// @c bytesPerSecond. Once it runs dry, writing pauses and data waits in
+  /// outputBuffer() until a loop timer says there are tokens again, so
+  /// high water mark callbacks still apply. Zero rate turns it off.
+  /// Must be called in the loop thread, or before connectEstablished().
+  void setRateLimit(double bytesPerSecond, size_t burst);
+  /// A bucket shared with other connections, on top of setRateLimit().
+  void setSharedRateLimit(const std::shared_ptr<TokenBucket>& bucket)
+  { sharedRateLimit_ = bucket; }
+  /// Lets the kernel pace instead, needs the fq qdisc or TCP internal
+  /// pacing (Linux 4.13). Zero removes the cap.
+  void setMaxPacingRate(uint32_t bytesPerSecond);
+
+  /// Slow consumer policy, checked by every send() that has to queue.
+  ///
+  /// kDropOldest drops down to half of @c maxBytes, and all sends older
+  /// than @c maxAge. A send whose first bytes are written already is kept.
+  /// @c stats may be shared with other connections, or null.
+  /// Must be called in the loop thread, or before connectEstablished().
+  void setBacklogPolicy(const BacklogPolicy& policy,
+                        const std::shared_ptr<BacklogStats>& stats);
+
+  /// Coalesces sends made within one loop iteration.
+  ///
+  /// When on, send() in the loop thread only appends to the output buffer,
+  /// which is written once right before the loop goes back to polling.
+  /// Off by default. Must be called in the loop thread.
+  void setAutoCork(bool on) { autoCork_ = on; }
+  bool autoCork() const { return autoCork_; }
+
   // reading or not
   void startRead();
   void stopRead();
 
   bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
+  /// Moves the connection to @c target, eg. another loop of the server's
+  /// thread pool, to take a hot connection off a busy loop.
+  ///
+  /// The channel leaves the current poller and registers with @c target's,
+  /// buffers, timers and pending sends come along, in order. Done in the
+  /// current loop thread, at the end of its iteration; getLoop() returns
+  /// @c target from then on, and callbacks run in its thread. Ignored once
+  /// the connection is closing. Thread safe. Only for server connections,
+  /// a TcpClient's connection must stay in the client's loop.
+  /// examples/rebalance moves connections by their byte rates.
+  void migrateTo(EventLoop* target);
+
+  /// Input-side backpressure.
+  ///
+  /// Reading pauses when unprocessed bytes left in inputBuffer() after the
+  /// message callback reach @c highWaterMark, or when in-flight requests
+  /// reach @c highInFlight. It resumes once both are back at the low marks,
+  /// leaving the peer to TCP flow control meanwhile. On resume, leftover
+  /// input is handed to the message callback again.
+  /// @c highWaterMark must exceed the largest message, a partial one left at
+  /// the mark waits for bytes that are never read.
+  /// Zero high marks (default) disable the check. Must be called in the loop thread.
+  void setInputWaterMark(size_t highWaterMark, size_t lowWaterMark)
+  { inputHighWaterMark_ = highWaterMark; inputLowWaterMark_ = lowWaterMark; }
+  void setInFlightWaterMark(int highInFlight, int lowInFlight)
+  { highInFlight_ = highInFlight; lowInFlight_ = lowInFlight; }
+  /// Checks the input marks again, for input retrieved outside the message
+  /// callback, eg. by deferred processing, or marks changed while paused.
+  /// Thread safe.
+  void resumeReadIfBelowLowMark();
+
+  /// Counts requests handed off to other threads. Thread safe.
+  void incInFlight();
+  void decInFlight();
+  int inFlight() { return inFlight_.get(); }
+
   /// context
   void setContext(const boost::any& context)
   { context_ = context; }
@@ -114,6 +233,12 @@ class TcpConnection : noncopyable,
   void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
   { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+  /// Asks a streaming producer for more data before the output buffer runs dry.
+  /// Called when a write drains the output buffer to @c lowWaterMark or below,
+  /// but not to empty, which is left to WriteCompleteCallback.
+  void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+  { lowWaterMarkCallback_ = cb; lowWaterMark_ = lowWaterMark; }
+
   /// 输入的Buffer
   Buffer* inputBuffer()
   { return &inputBuffer_; }
@@ -125,6 +250,14 @@ class TcpConnection : noncopyable,
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }
+  /// Internal use only.
+  void setMigrateCallback(const MigrateCallback& cb)
+  { migrateCallback_ = cb; }
+
+  /// Reads and writes go through @c transport, eg. TLS.
+  /// Internal use only, set by TcpServer/TcpClient before connectEstablished().
+  void setTransport(std::unique_ptr<Transport> transport);
+  Transport* transport() const { return transport_.get(); }
 
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
@@ -133,6 +266,8 @@ class TcpConnection : noncopyable,
 
  private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+  // same as EventLoop::Functor, a cross-thread send() stays allocation free
+  typedef muduo::Function<void ()> Functor;
 
   /// 处理函数
   void handleRead(Timestamp receiveTime);
@@ -143,22 +278,69 @@ class TcpConnection : noncopyable,
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
   void shutdownInLoop();
+  void flushCorkedInLoop();
+  void retrieveWritten(size_t n);
+  void handshakeInLoop(Timestamp receiveTime);
+  ssize_t writeFd(const void* data, size_t len);
+  ssize_t writeSocket(const void* data, size_t len);
+  void queueOutput(const void* data, size_t len, bool started);
+  void checkBacklog();
+  void dropOldest(bool tooBig, Timestamp now);
+  size_t takeTokens(size_t len);
+  void throttleWriting(size_t want);
+  void resumeWritingInLoop();
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
   void setState(StateE s) { state_ = s; }
   const char* stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
-
-  /// TcpConnection的loop
-  EventLoop* loop_;
+  void readTransportPending();
+  void readPendingInLoop();
+  void updateInputThrottleInLoop();
+  void setChannelCallbacks();
+  void migrateInLoop(EventLoop* target);
+  void moveInLoop(EventLoop* target);
+  void attachInLoop(EventLoop* from, bool reading, bool writing);
+  void finishMigrating() REQUIRES(mutex_);
+  /// Like EventLoop's. While a migration is pending the calls go to a queue
+  /// of the connection that follows it to another loop, so cross-thread
+  /// calls keep their order.
+  void runInLoop(Functor cb);
+  void queueInLoop(Functor cb);
+  void doPendingFunctors();
+  /// wraps @c method for a callback of the loop, eg. a timer, so it runs
+  /// in the loop the connection is in by then, see migrateTo()
+  Functor followLoop(void (TcpConnection::*method)());
+  static void runFollowing(const std::weak_ptr<TcpConnection>& weak,
+                           void (TcpConnection::*method)());
+
+  /// TcpConnection的loop, changed by migrateInLoop(), read by send(),
+  /// runInLoop() and getLoop() from any thread
+  std::atomic<EventLoop*> loop_;
+  /// set by migrateTo(), until the move is done and pendingFunctors_ drained
+  std::atomic<bool> migrating_;
+  /// queueInLoop() calls posting straight to loop_
+  std::atomic<int> directCalls_;
+  // held while loop_ changes, so queueInLoop() posts to the loop it drains in
+  mutable MutexLock mutex_;
+  int migrations_ GUARDED_BY(mutex_);
+  std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
   const string name_;
   StateE state_;  // FIXME: use atomic variable
   bool reading_;
+  bool autoCork_;
+  bool kernelReceiveTime_;
+  bool corkPending_;  // flushCorkedInLoop() is queued
+  bool handshaking_;  // transport_ not ready, connection callback held back
   // we don't expose those classes to client.
   /// socket和channel
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
+  std::unique_ptr<Transport> transport_;
+  // front bytes of outputBuffer_ offered to transport_ and not reported
+  // written, it may hold them, eg. in a pending TLS record
+  size_t transportHeld_;
   // IP地址
   const InetAddress localAddr_;
   const InetAddress peerAddr_;
@@ -169,8 +351,20 @@ class TcpConnection : noncopyable,
   /// 写毕回调函数
   WriteCompleteCallback writeCompleteCallback_;
   HighWaterMarkCallback highWaterMarkCallback_;
+  LowWaterMarkCallback lowWaterMarkCallback_;
   CloseCallback closeCallback_;
+  MigrateCallback migrateCallback_;
   size_t highWaterMark_;
+  size_t lowWaterMark_;
+  size_t inputHighWaterMark_;
+  size_t inputLowWaterMark_;
+  int highInFlight_;
+  int lowInFlight_;
+  AtomicInt32 inFlight_;
+  std::atomic<bool> inputThrottled_;  // set in the loop thread, read by inc/decInFlight()
+  std::unique_ptr<TokenBucket> rateLimit_;
+  std::shared_ptr<TokenBucket> sharedRateLimit_;
+  bool rateThrottled_;  // out of tokens, writing resumes on a timer
 
   /// 注意两个缓冲区
   // inputBuffer, client写, server读
@@ -179,6 +373,19 @@ class TcpConnection : noncopyable,
 
   Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
 
+  /// A send() queued in outputBuffer_, at offsets counted by outputQueued_.
+  struct PendingSend
+  {
+    int64_t begin;
+    int64_t end;
+    Timestamp queued;
+    bool started;  // its first bytes are written
+  };
+  BacklogPolicy backlogPolicy_;
+  std::shared_ptr<BacklogStats> backlogStats_;
+  std::deque<PendingSend> pendingSends_;  // only with a backlog policy
+  int64_t outputQueued_;  // bytes ever appended to outputBuffer_
+
   /// context_
   boost::any context_;
   // FIXME: creationTime_, lastReceiveTime_
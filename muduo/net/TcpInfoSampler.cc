@@ -0,0 +1,272 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/TcpInfoSampler.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/WeakCallback.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <algorithm>
+
+#include <inttypes.h>
+#include <math.h>
+#include <netinet/tcp.h>
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+TcpInfoSampler::Histogram::Histogram()
+  : count_(0),
+    sum_(0),
+    max_(0)
+{
+  memZero(buckets_, sizeof buckets_);
+}
+
+void TcpInfoSampler::Histogram::add(uint64_t value)
+{
+  int index = value == 0 ? 0 : 64 - __builtin_clzll(value);
+  ++buckets_[std::min(index, kBuckets - 1)];
+  ++count_;
+  sum_ += value;
+  max_ = std::max(max_, value);
+}
+
+void TcpInfoSampler::Histogram::merge(const Histogram& rhs)
+{
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    buckets_[i] += rhs.buckets_[i];
+  }
+  count_ += rhs.count_;
+  sum_ += rhs.sum_;
+  max_ = std::max(max_, rhs.max_);
+}
+
+double TcpInfoSampler::Histogram::mean() const
+{
+  return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+uint64_t TcpInfoSampler::Histogram::percentile(double p) const
+{
+  int64_t rank = static_cast<int64_t>(ceil(p * static_cast<double>(count_)));
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    seen += buckets_[i];
+    if (seen >= rank && seen > 0)
+    {
+      uint64_t upper = i == 0 ? 0 : (static_cast<uint64_t>(1) << i) - 1;
+      return std::min(upper, max_);
+    }
+  }
+  return max_;
+}
+
+void TcpInfoSampler::Histograms::merge(const Histograms& rhs)
+{
+  rtt.merge(rhs.rtt);
+  rttvar.merge(rhs.rttvar);
+  cwnd.merge(rhs.cwnd);
+  unacked.merge(rhs.unacked);
+  retransmits.merge(rhs.retransmits);
+  deliveryRate.merge(rhs.deliveryRate);
+}
+
+namespace
+{
+
+void appendHistogram(string* out, const char* name, const TcpInfoSampler::Histogram& h)
+{
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "%-18s count=%" PRId64 " mean=%.1f p50=%" PRIu64 " p90=%" PRIu64
+           " p99=%" PRIu64 " max=%" PRIu64 "\n",
+           name, h.count(), h.mean(), h.percentile(0.5), h.percentile(0.9),
+           h.percentile(0.99), h.max());
+  out->append(buf);
+}
+
+}  // namespace
+
+string TcpInfoSampler::Histograms::toString() const
+{
+  string result;
+  appendHistogram(&result, "rtt_us", rtt);
+  appendHistogram(&result, "rttvar_us", rttvar);
+  appendHistogram(&result, "cwnd", cwnd);
+  appendHistogram(&result, "unacked", unacked);
+  appendHistogram(&result, "retransmits", retransmits);
+  appendHistogram(&result, "delivery_rate_Bps", deliveryRate);
+  return result;
+}
+
+TcpInfoSampler::TcpInfoSampler(EventLoop* loop, double interval, int budget)
+  : loop_(CHECK_NOTNULL(loop)),
+    interval_(interval),
+    budget_(budget),
+    cursor_(0),
+    samples_(0)
+{
+  assert(interval > 0);
+  assert(budget > 0);
+}
+
+TcpInfoSampler::~TcpInfoSampler()
+{
+  loop_->cancel(timer_);
+}
+
+void TcpInfoSampler::start()
+{
+  // the timer may still fire once after we are gone
+  timer_ = loop_->runEvery(interval_,
+                           makeWeakCallback(shared_from_this(), &TcpInfoSampler::onTick));
+}
+
+void TcpInfoSampler::add(const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  assert(conn->getLoop() == loop_);
+  Entry entry;
+  entry.conn = conn;
+  entry.latest.name = conn->name();
+  entry.latest.peer = conn->peerAddress().toIpPort();
+  entry.sampled = false;
+  MutexLockGuard lock(mutex_);
+  entries_.push_back(std::move(entry));
+}
+
+void TcpInfoSampler::remove(const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  MutexLockGuard lock(mutex_);
+  for (size_t i = 0; i < entries_.size(); ++i)
+  {
+    if (entries_[i].conn.lock() == conn)
+    {
+      entries_[i] = std::move(entries_.back());
+      entries_.pop_back();
+      break;
+    }
+  }
+}
+
+/// 每个tick最多采样budget_个连接, 轮转
+void TcpInfoSampler::onTick()
+{
+  loop_->assertInLoopThread();
+  Timestamp now(loop_->now());
+  MutexLockGuard lock(mutex_);
+  size_t todo = std::min(entries_.size(), static_cast<size_t>(budget_));
+  for (; todo > 0 && !entries_.empty(); --todo)
+  {
+    if (cursor_ >= entries_.size())
+    {
+      cursor_ = 0;
+    }
+    Entry& entry = entries_[cursor_];
+    TcpConnectionPtr conn(entry.conn.lock());
+    struct tcp_info tcpi;
+    uint64_t deliveryRate = 0;
+    if (!conn || conn->disconnected() || !conn->getTcpInfo(&tcpi, &deliveryRate))
+    {
+      // the last entry takes its place, and is sampled next
+      if (cursor_ + 1 != entries_.size())
+      {
+        entry = std::move(entries_.back());
+      }
+      entries_.pop_back();
+      continue;
+    }
+
+    Sample& s = entry.latest;
+    s.when = now;
+    s.rtt = tcpi.tcpi_rtt;
+    s.rttvar = tcpi.tcpi_rttvar;
+    s.cwnd = tcpi.tcpi_snd_cwnd;
+    s.unacked = tcpi.tcpi_unacked;
+    s.retransmits = tcpi.tcpi_retransmits;
+    s.totalRetrans = tcpi.tcpi_total_retrans;
+    s.deliveryRate = deliveryRate;
+    entry.sampled = true;
+
+    histograms_.rtt.add(s.rtt);
+    histograms_.rttvar.add(s.rttvar);
+    histograms_.cwnd.add(s.cwnd);
+    histograms_.unacked.add(s.unacked);
+    histograms_.retransmits.add(s.retransmits);
+    if (deliveryRate > 0)
+    {
+      histograms_.deliveryRate.add(deliveryRate);
+    }
+    ++samples_;
+    ++cursor_;
+  }
+}
+
+int64_t TcpInfoSampler::samples() const
+{
+  MutexLockGuard lock(mutex_);
+  return samples_;
+}
+
+TcpInfoSampler::Histograms TcpInfoSampler::histograms() const
+{
+  MutexLockGuard lock(mutex_);
+  return histograms_;
+}
+
+std::vector<TcpInfoSampler::Sample> TcpInfoSampler::worst(size_t n) const
+{
+  std::vector<Sample> result;
+  {
+  MutexLockGuard lock(mutex_);
+  for (const Entry& entry : entries_)
+  {
+    if (entry.sampled)
+    {
+      result.push_back(entry.latest);
+    }
+  }
+  }
+  sortByBadness(&result, n);
+  return result;
+}
+
+void TcpInfoSampler::reset()
+{
+  MutexLockGuard lock(mutex_);
+  histograms_ = Histograms();
+  samples_ = 0;
+}
+
+void TcpInfoSampler::sortByBadness(std::vector<Sample>* samples, size_t n)
+{
+  n = std::min(n, samples->size());
+  std::partial_sort(samples->begin(), samples->begin() + static_cast<ptrdiff_t>(n), samples->end(),
+                    [](const Sample& lhs, const Sample& rhs)
+                    { return lhs.badness() > rhs.badness(); });
+  samples->resize(n);
+}
+
+string TcpInfoSampler::toString(const std::vector<Sample>& samples)
+{
+  string result;
+  char buf[512];
+  for (const Sample& s : samples)
+  {
+    snprintf(buf, sizeof buf,
+             "%s %s rtt=%u rttvar=%u cwnd=%u unacked=%u retransmits=%u "
+             "total_retrans=%u delivery_rate=%" PRIu64 " at %s\n",
+             s.name.c_str(), s.peer.c_str(), s.rtt, s.rttvar, s.cwnd, s.unacked,
+             s.retransmits, s.totalRetrans, s.deliveryRate,
+             s.when.toFormattedString(false).c_str());
+    result.append(buf);
+  }
+  return result;
+}
@@ -0,0 +1,143 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TCPINFOSAMPLER_H
+#define MUDUO_NET_TCPINFOSAMPLER_H
+
+#include "muduo/base/copyable.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Callbacks.h"
+#include "muduo/net/TimerId.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Periodic TCP_INFO of the connections of one EventLoop.
+///
+/// Every @c interval seconds, samples the next @c budget connections
+/// round-robin, so a full pass over N connections takes N / budget ticks
+/// and a tick never costs more than @c budget getsockopt() calls.
+/// Samples go into histograms and a latest-sample-per-connection table,
+/// both readable from any thread, eg. an Inspector.
+///
+/// Enabled per server with TcpServer::enableTcpInfoSampling().
+class TcpInfoSampler : noncopyable,
+                       public std::enable_shared_from_this<TcpInfoSampler>
+{
+ public:
+  struct Sample
+  {
+    string name;
+    string peer;
+    Timestamp when;
+    uint32_t rtt;           // smoothed, usec
+    uint32_t rttvar;        // usec
+    uint32_t cwnd;          // segments
+    uint32_t unacked;       // segments
+    uint32_t retransmits;   // unrecovered RTO timeouts
+    uint32_t totalRetrans;  // for the whole connection
+    uint64_t deliveryRate;  // bytes per second, 0 if unknown
+
+    /// Approximates the kernel's RTO, larger is worse.
+    uint64_t badness() const { return rtt + 4 * static_cast<uint64_t>(rttvar); }
+  };
+
+  /// Log2 buckets, bucket i counts values in [2^(i-1), 2^i).
+  class Histogram : public copyable
+  {
+   public:
+    static const int kBuckets = 48;
+
+    Histogram();
+    void add(uint64_t value);
+    void merge(const Histogram& rhs);
+    int64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const;
+    /// Upper bound of the bucket holding the @c p quantile, 0 < p <= 1.
+    uint64_t percentile(double p) const;
+
+   private:
+    int64_t buckets_[kBuckets];
+    int64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+  };
+
+  struct Histograms
+  {
+    Histogram rtt;
+    Histogram rttvar;
+    Histogram cwnd;
+    Histogram unacked;
+    Histogram retransmits;
+    Histogram deliveryRate;
+
+    void merge(const Histograms& rhs);
+    string toString() const;
+  };
+
+  TcpInfoSampler(EventLoop* loop, double interval, int budget);
+  ~TcpInfoSampler();
+
+  EventLoop* getLoop() const { return loop_; }
+
+  /// Thread safe.
+  void start();
+
+  /// Adds a connection of this loop, dropped once it disconnects.
+  /// In loop thread.
+  void add(const TcpConnectionPtr& conn);
+  /// Drops a connection that moved to another loop. In loop thread.
+  void remove(const TcpConnectionPtr& conn);
+
+  /// Thread safe.
+  int64_t samples() const;
+  Histograms histograms() const;
+  /// Latest samples of the @c n worst connections, worst first.
+  std::vector<Sample> worst(size_t n) const;
+  /// Clears histograms, keeps the connections.
+  void reset();
+
+  /// Worst first.
+  static void sortByBadness(std::vector<Sample>* samples, size_t n);
+  static string toString(const std::vector<Sample>& samples);
+
+ private:
+  struct Entry
+  {
+    std::weak_ptr<TcpConnection> conn;
+    Sample latest;
+    bool sampled;
+  };
+
+  void onTick();
+
+  EventLoop* loop_;
+  const double interval_;
+  const int budget_;
+  TimerId timer_;
+  // next entry to sample, in loop thread
+  size_t cursor_;
+  mutable MutexLock mutex_;
+  std::vector<Entry> entries_ GUARDED_BY(mutex_);
+  Histograms histograms_ GUARDED_BY(mutex_);
+  int64_t samples_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TCPINFOSAMPLER_H
@@ -9,31 +9,125 @@
 #include "muduo/net/TcpServer.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/WeakCallback.h"
 #include "muduo/net/Acceptor.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/SocketsOps.h"
+#include "muduo/net/TokenBucket.h"
+#include "muduo/net/Transport.h"
 
+#include <algorithm>
+
+#include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+/// 测量loop的调度延迟, 即定时器晚到了多久
+class LagProbe : noncopyable,
+                 public std::enable_shared_from_this<LagProbe>
+{
+ public:
+  LagProbe(EventLoop* loop, double interval)
+    : loop_(loop),
+      intervalUs_(static_cast<int64_t>(interval * Timestamp::kMicroSecondsPerSecond))
+  {
+  }
+
+  ~LagProbe()
+  {
+    loop_->cancel(timer_);
+  }
+
+  void start()
+  {
+    lastTick_.getAndSet(Timestamp::now().microSecondsSinceEpoch());
+    timer_ = loop_->runEvery(static_cast<double>(intervalUs_) / Timestamp::kMicroSecondsPerSecond,
+                             makeWeakCallback(shared_from_this(), &LagProbe::tick));
+  }
+
+  /// Thread safe. A stuck loop shows up before its timer gets to fire.
+  int64_t lagUs(Timestamp now)
+  {
+    int64_t overdue = now.microSecondsSinceEpoch() - lastTick_.get() - intervalUs_;
+    return std::max(lastLag_.get(), overdue);
+  }
+
+ private:
+  void tick()
+  {
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    int64_t last = lastTick_.getAndSet(now);
+    lastLag_.getAndSet(std::max(now - last - intervalUs_, static_cast<int64_t>(0)));
+  }
+
+  EventLoop* loop_;
+  const int64_t intervalUs_;
+  TimerId timer_;
+  AtomicInt64 lastTick_;
+  AtomicInt64 lastLag_;
+};
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
                      Option option)
-  : loop_(CHECK_NOTNULL(loop)),
-    ipPort_(listenAddr.toIpPort()),
+  /// 初始化acceptor监听连接, 创建sockfd, bind address
+  : TcpServer(loop, new Acceptor(CHECK_NOTNULL(loop), listenAddr, option == kReusePort),
+              listenAddr.toIpPort(), nameArg)
+{
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     int listenfd,
+                     const string& nameArg)
+  : TcpServer(loop, new Acceptor(CHECK_NOTNULL(loop), listenfd),
+              InetAddress(sockets::getLocalAddr(listenfd)).toIpPort(), nameArg)
+{
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     Acceptor* acceptor,
+                     const string& ipPort,
+                     const string& nameArg)
+  : loop_(loop),
+    ipPort_(ipPort),
     name_(nameArg),
-    /// 初始化acceptor监听连接, 创建sockfd, bind address
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    acceptor_(acceptor),
     /// 初始化threadPool
     threadPool_(new EventLoopThreadPool(loop, name_)),
 
     /// 初始化connection回调函数和message回调函数
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
+    rateLimit_(0.0),
+    rateLimitBurst_(0),
+    kernelReceiveTime_(false),
+    fastOpen_(false),
+    backlogStats_(std::make_shared<BacklogStats>()),
+    maxConnectionsHigh_(0),
+    maxConnectionsLow_(0),
+    maxLagHigh_(0.0),
+    maxLagLow_(0.0),
+    lagProbeInterval_(0.0),
+    overloaded_(false),
+    rejected_(0),
+    fastOpenAccepted_(0),
+    tcpInfoInterval_(0.0),
+    tcpInfoBudget_(0),
     nextConnId_(1)
 {
   /// 设置acceptor对象的NewConnectionCallback为&TcpServer::newConnection
@@ -48,6 +142,7 @@ TcpServer::~TcpServer()
 {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  loop_->cancel(admissionTimer_);
 
   for (auto& item : connections_)
   {
@@ -64,6 +159,30 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setAggregateRateLimit(double bytesPerSecond, size_t burst)
+{
+  if (bytesPerSecond > 0)
+  {
+    aggregateRateLimit_ = std::make_shared<TokenBucket>(bytesPerSecond, burst);
+  }
+  else
+  {
+    aggregateRateLimit_.reset();
+  }
+}
+
+void TcpServer::setKernelReceiveTime(bool on)
+{
+  kernelReceiveTime_ = on;
+  acceptor_->setRecvTimestamps(on);
+}
+
+void TcpServer::setFastOpen(int queueLength)
+{
+  fastOpen_ = queueLength > 0;
+  acceptor_->setFastOpen(queueLength);
+}
+
 void TcpServer::start()
 {
   if (started_.getAndSet(1) == 0)
@@ -72,6 +191,30 @@ void TcpServer::start()
     /// thread对象和loop对象均存储在threadPool对应的列表中
     threadPool_->start(threadInitCallback_);
 
+    if (tcpInfoInterval_ > 0)
+    {
+      for (EventLoop* ioLoop : threadPool_->getAllLoops())
+      {
+        samplers_.push_back(
+            std::make_shared<TcpInfoSampler>(ioLoop, tcpInfoInterval_, tcpInfoBudget_));
+        samplers_.back()->start();
+      }
+    }
+
+    if (maxLagHigh_ > 0)
+    {
+      for (EventLoop* ioLoop : threadPool_->getAllLoops())
+      {
+        lagProbes_.push_back(std::make_shared<detail::LagProbe>(ioLoop, lagProbeInterval_));
+        lagProbes_.back()->start();
+      }
+    }
+    if (maxLagHigh_ > 0 || maxConnectionsHigh_ > 0)
+    {
+      admissionTimer_ = loop_->runEvery(lagProbeInterval_ > 0 ? lagProbeInterval_ : 0.1,
+                                        std::bind(&TcpServer::updateAdmission, this));
+    }
+
     assert(!acceptor_->listening());
 
     /// 在eventloop进程(即主线程)中运行listen监听
@@ -91,6 +234,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
   /// 主线程的作用只是刚开始建立连接，以后的处理通话等由特定的工作线程进行
 
   /// 返回threadPool_ loop列表的下一个loop, (每个loop来自不同线程)
+  if (overloaded_ && !overloadResponse_.empty())
+  {
+    // best effort, the send buffer of a new socket has room
+    ++rejected_;
+    sockets::write(sockfd, overloadResponse_.data(), overloadResponse_.size());
+    sockets::close(sockfd);
+    return;
+  }
   EventLoop* ioLoop = threadPool_->getNextLoop();
   char buf[64];
   snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
@@ -115,12 +266,48 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  if (transportFactory_)
+  {
+    conn->setTransport(transportFactory_());
+  }
+  if (kernelReceiveTime_)
+  {
+    conn->setKernelReceiveTime(true);
+  }
+  if (fastOpen_)
+  {
+    /// 接受时SYN已经处理完, TCPI_OPT_SYN_DATA表示SYN里的数据被收下了
+    struct tcp_info tcpi;
+    if (conn->getTcpInfo(&tcpi) && (tcpi.tcpi_options & TCPI_OPT_SYN_DATA))
+    {
+      ++fastOpenAccepted_;
+    }
+  }
+  if (rateLimit_ > 0)
+  {
+    conn->setRateLimit(rateLimit_, rateLimitBurst_);
+  }
+  if (aggregateRateLimit_)
+  {
+    conn->setSharedRateLimit(aggregateRateLimit_);
+  }
+  if (backlogPolicy_.enabled())
+  {
+    conn->setBacklogPolicy(backlogPolicy_, backlogStats_);
+  }
   conn->setCloseCallback(
       std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
 
   // 在ioLoop的线程(创建loop的子线程)中执行&TcpConnection::connectEstablished, 
   // 连接建立主要是注册channel到ioLoop 的poller
   ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+  updateAdmission();
+  if (!samplers_.empty())
+  {
+    conn->setMigrateCallback(
+        std::bind(&TcpServer::connectionMigrated, this, _1, _2)); // FIXME: unsafe
+    ioLoop->runInLoop(std::bind(&TcpInfoSampler::add, samplerOf(ioLoop), conn));
+  }
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr& conn)
@@ -138,6 +325,7 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
   size_t n = connections_.erase(conn->name());
   (void)n;
   assert(n == 1);
+  updateAdmission();
   /// 得到ioLoop
   EventLoop* ioLoop = conn->getLoop();
   /// 执行TcpConnectio的connectDestroyed
@@ -145,3 +333,106 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
       std::bind(&TcpConnection::connectDestroyed, conn));
 }
 
+
+/// 在目标loop线程里, 连接的TCP_INFO采样换到目标loop的采样器
+void TcpServer::connectionMigrated(const TcpConnectionPtr& conn, EventLoop* from)
+{
+  std::shared_ptr<TcpInfoSampler> sampler(samplerOf(conn->getLoop()));
+  if (sampler)
+  {
+    sampler->add(conn);
+  }
+  sampler = samplerOf(from);
+  if (sampler)
+  {
+    from->runInLoop(std::bind(&TcpInfoSampler::remove, sampler, conn));
+  }
+}
+
+std::shared_ptr<TcpInfoSampler> TcpServer::samplerOf(EventLoop* ioLoop) const
+{
+  for (const auto& sampler : samplers_)
+  {
+    if (sampler->getLoop() == ioLoop)
+    {
+      return sampler;
+    }
+  }
+  assert(false);
+  return std::shared_ptr<TcpInfoSampler>();
+}
+
+TcpInfoSampler::Histograms TcpServer::tcpInfoHistograms() const
+{
+  TcpInfoSampler::Histograms result;
+  for (const auto& sampler : samplers_)
+  {
+    result.merge(sampler->histograms());
+  }
+  return result;
+}
+
+std::vector<TcpInfoSampler::Sample> TcpServer::worstConnections(size_t n) const
+{
+  std::vector<TcpInfoSampler::Sample> result;
+  for (const auto& sampler : samplers_)
+  {
+    std::vector<TcpInfoSampler::Sample> worst = sampler->worst(n);
+    result.insert(result.end(), worst.begin(), worst.end());
+  }
+  TcpInfoSampler::sortByBadness(&result, n);
+  return result;
+}
+
+void TcpServer::resetTcpInfo()
+{
+  for (const auto& sampler : samplers_)
+  {
+    sampler->reset();
+  }
+}
+
+double TcpServer::loopLag() const
+{
+  Timestamp now(Timestamp::now());
+  int64_t lagUs = 0;
+  for (const auto& probe : lagProbes_)
+  {
+    lagUs = std::max(lagUs, probe->lagUs(now));
+  }
+  return static_cast<double>(lagUs) / Timestamp::kMicroSecondsPerSecond;
+}
+
+/// 过载时停止accept, 连接留在listen backlog中; 恢复有滞后区间
+void TcpServer::updateAdmission()
+{
+  loop_->assertInLoopThread();
+  if (maxConnectionsHigh_ == 0 && maxLagHigh_ <= 0)
+  {
+    return;
+  }
+  size_t numConnections = connections_.size();
+  double lag = maxLagHigh_ > 0 ? loopLag() : 0.0;
+  if (!overloaded_)
+  {
+    if ((maxConnectionsHigh_ > 0 && numConnections >= maxConnectionsHigh_)
+        || (maxLagHigh_ > 0 && lag >= maxLagHigh_))
+    {
+      overloaded_ = true;
+      LOG_WARN << "TcpServer [" << name_ << "] overloaded, " << numConnections
+               << " connections, loop lag " << lag;
+      if (overloadResponse_.empty())
+      {
+        acceptor_->pause();
+      }
+    }
+  }
+  else if ((maxConnectionsHigh_ == 0 || numConnections <= maxConnectionsLow_)
+           && (maxLagHigh_ <= 0 || lag <= maxLagLow_))
+  {
+    overloaded_ = false;
+    LOG_INFO << "TcpServer [" << name_ << "] accepting again, " << numConnections
+             << " connections, loop lag " << lag;
+    acceptor_->resume();
+  }
+}
@@ -14,8 +14,11 @@
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Types.h"
 #include "muduo/net/TcpConnection.h"
+#include "muduo/net/TcpInfoSampler.h"
+#include "muduo/net/TimerId.h"
 
 #include <map>
+#include <vector>
 
 namespace muduo
 {
@@ -25,6 +28,12 @@ namespace net
 class Acceptor;
 class EventLoop;
 class EventLoopThreadPool;
+class TokenBucket;
+
+namespace detail
+{
+class LagProbe;
+}
 
 ///
 /// TCP server, supports single-threaded and thread-pool models.
@@ -46,6 +55,10 @@ class TcpServer : noncopyable
             const InetAddress& listenAddr,
             const string& nameArg,
             Option option = kNoReusePort);
+  /// Takes over a bound, non-blocking socket, see PreforkServer.
+  TcpServer(EventLoop* loop,
+            int listenfd,
+            const string& nameArg);
   ~TcpServer();  // force out-line dtor, for std::unique_ptr members.
 
   const string& ipPort() const { return ipPort_; }
@@ -91,13 +104,95 @@ class TcpServer : noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Set transport factory, eg. TlsContext::serverTransportFactory().
+  /// The connection callback runs once the handshake is done, a connection
+  /// whose handshake fails is closed without being reported.
+  /// Not thread safe.
+  void setTransportFactory(const TransportFactory& factory)
+  { transportFactory_ = factory; }
+
+  /// Egress limit of every connection, see TcpConnection::setRateLimit().
+  /// Not thread safe, applies to connections accepted afterwards.
+  void setRateLimit(double bytesPerSecond, size_t burst)
+  { rateLimit_ = bytesPerSecond; rateLimitBurst_ = burst; }
+
+  /// Egress limit of all connections together, shared across IO loops.
+  /// Not thread safe, applies to connections accepted afterwards.
+  void setAggregateRateLimit(double bytesPerSecond, size_t burst);
+
+  /// See TcpConnection::setKernelReceiveTime(). Set on the listening
+  /// socket too, so data that arrives before accept() is stamped.
+  /// Not thread safe.
+  void setKernelReceiveTime(bool on);
+
+  /// TCP Fast Open, the request in the SYN of a returning client is
+  /// delivered with the accept, saving a round trip. At most @c queueLength
+  /// such connections wait for accept(), 0 turns it off. Needs bit 2 of
+  /// sysctl net.ipv4.tcp_fastopen. Not thread safe.
+  void setFastOpen(int queueLength);
+
+  /// Slow consumer policy of every connection, see
+  /// TcpConnection::setBacklogPolicy(). Not thread safe, applies to
+  /// connections accepted afterwards.
+  void setBacklogPolicy(const BacklogPolicy& policy)
+  { backlogPolicy_ = policy; }
+  /// Summed over all connections. Thread safe.
+  const std::shared_ptr<BacklogStats>& backlogStats() const { return backlogStats_; }
+
+  /// Admission control, stops accepting once @c high connections are open
+  /// and starts again when they are down to @c low. New connections wait in
+  /// the listen backlog meanwhile, so the open ones don't all slow down.
+  /// Zero @c high (default) means no limit. Must be called before @c start
+  void setMaxConnections(size_t high, size_t low)
+  { maxConnectionsHigh_ = high; maxConnectionsLow_ = low; }
+
+  /// Same for the lag of the IO loops, how late in seconds a timer fires
+  /// that each loop runs every @c probeInterval seconds. The largest lag
+  /// counts. Must be called before @c start
+  void setMaxLoopLag(double high, double low, double probeInterval = 0.05)
+  { maxLagHigh_ = high; maxLagLow_ = low; lagProbeInterval_ = probeInterval; }
+
+  /// While overloaded, accepts anyway, writes @c response and closes,
+  /// instead of leaving connections in the backlog. Not thread safe.
+  void setOverloadResponse(const string& response)
+  { overloadResponse_ = response; }
+
+  /// In loop thread.
+  size_t numConnections() const { return connections_.size(); }
+  int64_t acceptedConnections() const { return nextConnId_ - 1; }
+  bool overloaded() const { return overloaded_; }
+  int64_t rejectedConnections() const { return rejected_; }
+  /// connections whose SYN carried data, with a valid cookie
+  int64_t fastOpenConnections() const { return fastOpenAccepted_; }
+  /// Largest lag of the IO loops in seconds, valid after calling start().
+  double loopLag() const;
+
+  /// Samples TCP_INFO of every connection, see TcpInfoSampler.
+  /// Each IO loop samples @c budget of its connections every @c interval seconds.
+  /// Off by default. Must be called before @c start
+  void enableTcpInfoSampling(double interval = 1.0, int budget = 64)
+  { tcpInfoInterval_ = interval; tcpInfoBudget_ = budget; }
+
+  /// All IO loops together, valid after calling start(). Thread safe.
+  TcpInfoSampler::Histograms tcpInfoHistograms() const;
+  std::vector<TcpInfoSampler::Sample> worstConnections(size_t n) const;
+  void resetTcpInfo();
+
  private:
+  TcpServer(EventLoop* loop,
+            Acceptor* acceptor,
+            const string& ipPort,
+            const string& nameArg);
   /// Not thread safe, but in loop
   void newConnection(int sockfd, const InetAddress& peerAddr);
   /// Thread safe.
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  void connectionMigrated(const TcpConnectionPtr& conn, EventLoop* from);
+  std::shared_ptr<TcpInfoSampler> samplerOf(EventLoop* ioLoop) const;
+  /// In loop, pauses or resumes accepting
+  void updateAdmission();
 
   /// 连接的映射, name->TcpConnection
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;
@@ -113,7 +208,31 @@ class TcpServer : noncopyable
   ConnectionCallback connectionCallback_;
   MessageCallback messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
+  TransportFactory transportFactory_;
   ThreadInitCallback threadInitCallback_;
+  double rateLimit_;
+  size_t rateLimitBurst_;
+  std::shared_ptr<TokenBucket> aggregateRateLimit_;
+  bool kernelReceiveTime_;
+  bool fastOpen_;
+  BacklogPolicy backlogPolicy_;
+  std::shared_ptr<BacklogStats> backlogStats_;
+  size_t maxConnectionsHigh_;
+  size_t maxConnectionsLow_;
+  double maxLagHigh_;
+  double maxLagLow_;
+  double lagProbeInterval_;
+  string overloadResponse_;
+  // one per IO loop, not changed after start()
+  std::vector<std::shared_ptr<detail::LagProbe>> lagProbes_;
+  TimerId admissionTimer_;
+  bool overloaded_;
+  int64_t rejected_;
+  int64_t fastOpenAccepted_;
+  double tcpInfoInterval_;
+  int tcpInfoBudget_;
+  // one per IO loop, not changed after start()
+  std::vector<std::shared_ptr<TcpInfoSampler>> samplers_;
   AtomicInt32 started_;
   // always in loop thread
   int nextConnId_;
@@ -110,6 +110,7 @@ TimerQueue::TimerQueue(EventLoop* loop)
   /// 设置channel 读回调函数为handleRead,
   timerfdChannel_.setReadCallback(
       std::bind(&TimerQueue::handleRead, this));
+  timerfdChannel_.setHighPriority(true);
   // we are always reading the timerfd, we disarm it with timerfd_settime.
   timerfdChannel_.enableReading();
 }
@@ -210,7 +211,12 @@ void TimerQueue::handleRead()
   /// 执行超期定时序列的任务
   for (const Entry& it : expired)
   {
-    it.second->run();
+    /// 同一批中被先执行的回调取消的, 不再执行
+    ActiveTimer timer(it.second, it.second->sequence());
+    if (cancelingTimers_.find(timer) == cancelingTimers_.end())
+    {
+      it.second->run();
+    }
   }
   callingExpiredTimers_ = false;
 
@@ -0,0 +1,59 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/TokenBucket.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+TokenBucket::TokenBucket(double bytesPerSecond, size_t burst)
+  : rate_(bytesPerSecond),
+    burst_(burst),
+    tokens_(static_cast<double>(burst)),
+    last_(Timestamp::now())
+{
+  assert(bytesPerSecond > 0);
+  assert(burst > 0);
+}
+
+void TokenBucket::refill(Timestamp now)
+{
+  double elapsed = timeDifference(now, last_);
+  if (elapsed > 0)
+  {
+    tokens_ = std::min(static_cast<double>(burst_), tokens_ + elapsed * rate_);
+    last_ = now;
+  }
+}
+
+size_t TokenBucket::take(Timestamp now, size_t want)
+{
+  MutexLockGuard lock(mutex_);
+  refill(now);
+  size_t n = tokens_ > 0 ? std::min(want, static_cast<size_t>(tokens_)) : 0;
+  tokens_ -= static_cast<double>(n);
+  return n;
+}
+
+void TokenBucket::charge(Timestamp now, size_t n)
+{
+  MutexLockGuard lock(mutex_);
+  refill(now);
+  tokens_ -= static_cast<double>(n);
+}
+
+void TokenBucket::giveBack(size_t n)
+{
+  MutexLockGuard lock(mutex_);
+  tokens_ = std::min(static_cast<double>(burst_), tokens_ + static_cast<double>(n));
+}
+
+double TokenBucket::waitFor(Timestamp now, size_t n)
+{
+  MutexLockGuard lock(mutex_);
+  refill(now);
+  double missing = static_cast<double>(std::min(n, burst_)) - tokens_;
+  return missing > 0 ? missing / rate_ : 0.0;
+}
@@ -0,0 +1,53 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TOKENBUCKET_H
+#define MUDUO_NET_TOKENBUCKET_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Timestamp.h"
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Token bucket of bytes, refilled at @c rate per second up to @c burst.
+///
+/// Thread safe, so one bucket can cap several connections on different
+/// loops, see TcpServer::setAggregateRateLimit().
+class TokenBucket : noncopyable
+{
+ public:
+  /// Starts full.
+  TokenBucket(double bytesPerSecond, size_t burst);
+
+  double rate() const { return rate_; }
+  size_t burst() const { return burst_; }
+
+  /// Takes up to @c want tokens, returns how many were taken.
+  size_t take(Timestamp now, size_t want);
+  /// Returns tokens taken but not used.
+  void giveBack(size_t n);
+  /// Takes @c n tokens even if there are fewer, later take() waits out the debt.
+  void charge(Timestamp now, size_t n);
+  /// Seconds until @c n tokens, at most burst(), are available.
+  double waitFor(Timestamp now, size_t n);
+
+ private:
+  void refill(Timestamp now) REQUIRES(mutex_);
+
+  const double rate_;
+  const size_t burst_;
+  MutexLock mutex_;
+  double tokens_ GUARDED_BY(mutex_);
+  Timestamp last_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TOKENBUCKET_H
@@ -0,0 +1,66 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TRANSPORT_H
+#define MUDUO_NET_TRANSPORT_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <sys/types.h>  // ssize_t
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+
+///
+/// Byte stream layer between a TcpConnection and its socket, eg. TLS.
+///
+/// TcpConnection reads and writes through it instead of the plain socket,
+/// so MessageCallback and send() see application bytes only.
+/// All calls are made in the loop thread of the connection.
+class Transport : noncopyable
+{
+ public:
+  enum HandshakeState
+  {
+    kHandshakeDone,
+    kHandshakeWantRead,
+    kHandshakeWantWrite,
+    kHandshakeFailed,
+  };
+
+  virtual ~Transport() = default;
+
+  /// Called when the connection is established, then on every readable or
+  /// writable event until it returns kHandshakeDone or kHandshakeFailed.
+  /// The connection callback is held back until it's done.
+  virtual HandshakeState handshake(int sockfd) = 0;
+
+  /// Same contract as Buffer::readFd(): returns bytes appended to @c buf,
+  /// 0 on EOF, or -1 with @c *savedErrno set. EAGAIN means nothing for the
+  /// application this time, other errors close the connection.
+  /// Must drain whatever it has buffered, the poller won't tell again,
+  /// unless pending() says so.
+  virtual ssize_t read(int sockfd, Buffer* buf, int* savedErrno) = 0;
+
+  /// After read(), true if it holds input back, eg. to bound its output.
+  /// The connection then calls read() again without waiting for the socket.
+  virtual bool pending() const { return false; }
+
+  /// Same contract as ::write(2), errno is EWOULDBLOCK when it can't make
+  /// progress now.
+  virtual ssize_t write(int sockfd, const void* data, size_t len) = 0;
+
+  /// Called right before shutdown(SHUT_WR), eg. sends TLS close_notify.
+  virtual void shutdown(int sockfd) = 0;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TRANSPORT_H
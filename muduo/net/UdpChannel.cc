@@ -0,0 +1,387 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/UdpChannel.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/WeakCallback.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Socket.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <errno.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+void noDelete(UdpChannel*)
+{
+}
+
+const size_t kControlSize = CMSG_SPACE(sizeof(int));
+
+}  // namespace
+
+/// recvmmsg(2)用到的一批缓冲区, 只在start时分配一次
+struct UdpChannel::RecvBatch
+{
+  RecvBatch(int batchSize, size_t size)
+    : datagramSize(size),
+      data(batchSize * size),
+      control(batchSize * kControlSize),
+      iovecs(batchSize),
+      addrs(batchSize),
+      msgs(batchSize)
+  {
+  }
+
+  void reset()
+  {
+    for (size_t i = 0; i < msgs.size(); ++i)
+    {
+      iovecs[i].iov_base = &data[i * datagramSize];
+      iovecs[i].iov_len = datagramSize;
+      struct msghdr& hdr = msgs[i].msg_hdr;
+      hdr.msg_name = &addrs[i];
+      hdr.msg_namelen = static_cast<socklen_t>(sizeof addrs[i]);
+      hdr.msg_iov = &iovecs[i];
+      hdr.msg_iovlen = 1;
+      hdr.msg_control = &control[i * kControlSize];
+      hdr.msg_controllen = kControlSize;
+      hdr.msg_flags = 0;
+      msgs[i].msg_len = 0;
+    }
+  }
+
+  const size_t datagramSize;
+  std::vector<char> data;
+  std::vector<char> control;
+  std::vector<struct iovec> iovecs;
+  std::vector<struct sockaddr_in6> addrs;
+  std::vector<struct mmsghdr> msgs;
+};
+
+/// sendmmsg(2)用到的一批头部, 第一次flush时分配, 之后复用
+struct UdpChannel::SendBatch
+{
+  explicit SendBatch(int batchSize)
+    : control(batchSize * kSegmentControlSize),
+      iovecs(batchSize),
+      msgs(batchSize)
+  {
+  }
+
+  static const size_t kSegmentControlSize = CMSG_SPACE(sizeof(uint16_t));
+
+  std::vector<char> control;
+  std::vector<struct iovec> iovecs;
+  std::vector<struct mmsghdr> msgs;
+};
+
+UdpChannel::UdpChannel(EventLoop* loop,
+                       const InetAddress& bindAddr,
+                       const string& nameArg,
+                       bool reuseport)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(nameArg),
+    socket_(new Socket(sockets::createUdpNonblockingOrDie(bindAddr.family()))),
+    channel_(new Channel(loop, socket_->fd())),
+    batchSize_(32),
+    maxDatagramSize_(2048),
+    gsoSegmentSize_(0),
+    gro_(false),
+    flushPending_(false),
+    guard_(this, noDelete),
+    datagramsReceived_(0),
+    datagramsSent_(0),
+    datagramsDropped_(0)
+{
+  // with SO_REUSEADDR, two sockets binding port 0 may get the same port,
+  // and the replies of one go to the other
+  socket_->setReuseAddr(bindAddr.port() != 0);
+  socket_->setReusePort(reuseport);
+  socket_->bindAddress(bindAddr);
+  localAddr_ = InetAddress(sockets::getLocalAddr(socket_->fd()));
+  channel_->setReadCallback(
+      std::bind(&UdpChannel::handleRead, this, _1));
+  channel_->setWriteCallback(
+      std::bind(&UdpChannel::handleWrite, this));
+  LOG_DEBUG << "UdpChannel::ctor[" << name_ << "] at " << this
+            << " fd=" << socket_->fd() << " " << localAddr_.toIpPort();
+}
+
+UdpChannel::~UdpChannel()
+{
+  LOG_DEBUG << "UdpChannel::dtor[" << name_ << "] at " << this;
+  loop_->assertInLoopThread();
+  channel_->disableAll();
+  channel_->remove();
+}
+
+void UdpChannel::setBatchSize(int batchSize)
+{
+  assert(!recvBatch_);
+  assert(batchSize > 0);
+  batchSize_ = batchSize;
+}
+
+void UdpChannel::setMaxDatagramSize(size_t maxDatagramSize)
+{
+  assert(!recvBatch_);
+  maxDatagramSize_ = maxDatagramSize;
+}
+
+void UdpChannel::enableGro(bool on)
+{
+  assert(!recvBatch_);
+#ifdef UDP_GRO
+  int optval = on ? 1 : 0;
+  if (::setsockopt(socket_->fd(), SOL_UDP, UDP_GRO,
+                   &optval, static_cast<socklen_t>(sizeof optval)) < 0)
+  {
+    LOG_SYSERR << "UDP_GRO failed.";
+    return;
+  }
+  gro_ = on;
+#else
+  if (on)
+  {
+    LOG_ERROR << "UDP_GRO is not supported.";
+  }
+#endif
+}
+
+void UdpChannel::setGsoSegmentSize(int segmentSize)
+{
+#ifdef UDP_SEGMENT
+  gsoSegmentSize_ = segmentSize;
+#else
+  if (segmentSize > 0)
+  {
+    LOG_ERROR << "UDP_SEGMENT is not supported.";
+  }
+#endif
+}
+
+void UdpChannel::start()
+{
+  loop_->runInLoop(std::bind(&UdpChannel::startInLoop, this));  // FIXME: unsafe
+}
+
+void UdpChannel::startInLoop()
+{
+  loop_->assertInLoopThread();
+  if (!recvBatch_)
+  {
+    // a GRO read may carry up to 64KiB of coalesced datagrams
+    size_t datagramSize = gro_ ? std::max<size_t>(maxDatagramSize_, 65536)
+                               : maxDatagramSize_;
+    recvBatch_.reset(new RecvBatch(batchSize_, datagramSize));
+  }
+  channel_->enableReading();
+}
+
+void UdpChannel::handleRead(Timestamp receiveTime)
+{
+  loop_->assertInLoopThread();
+  RecvBatch& batch = *recvBatch_;
+  batch.reset();
+  int n = ::recvmmsg(socket_->fd(), &batch.msgs[0],
+                     static_cast<unsigned int>(batch.msgs.size()), 0, NULL);
+  if (n < 0)
+  {
+    if (errno != EAGAIN && errno != EINTR)
+    {
+      LOG_SYSERR << "UdpChannel::handleRead";
+    }
+    return;
+  }
+
+  for (int i = 0; i < n; ++i)
+  {
+    const struct msghdr& hdr = batch.msgs[i].msg_hdr;
+    const char* data = static_cast<const char*>(batch.iovecs[i].iov_base);
+    size_t len = batch.msgs[i].msg_len;
+    InetAddress peerAddr(batch.addrs[i]);
+    if (hdr.msg_flags & MSG_TRUNC)
+    {
+      LOG_WARN << "UdpChannel::handleRead [" << name_ << "] - datagram from "
+               << peerAddr.toIpPort() << " truncated to " << len << " bytes";
+    }
+
+    size_t segment = len;
+#ifdef UDP_GRO
+    if (gro_)
+    {
+      for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL;
+           cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&hdr), cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+          int gsoSize = 0;
+          ::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+          if (gsoSize > 0)
+          {
+            segment = static_cast<size_t>(gsoSize);
+          }
+        }
+      }
+    }
+#endif
+
+    // GRO coalesces same-sized datagrams from one peer, the last may be shorter
+    for (size_t offset = 0; offset < len || offset == 0; offset += segment)
+    {
+      size_t segLen = std::min(segment, len - offset);
+      ++datagramsReceived_;
+      if (datagramCallback_)
+      {
+        datagramCallback_(this, data + offset, segLen, peerAddr, receiveTime);
+      }
+      if (segLen == 0)
+      {
+        break;
+      }
+    }
+  }
+}
+
+void UdpChannel::send(const void* data, size_t len, const InetAddress& peerAddr)
+{
+  send(StringPiece(static_cast<const char*>(data), static_cast<int>(len)), peerAddr);
+}
+
+void UdpChannel::send(const StringPiece& message, const InetAddress& peerAddr)
+{
+  if (loop_->isInLoopThread())
+  {
+    sendInLoop(message, peerAddr);
+  }
+  else
+  {
+    void (UdpChannel::*fp)(const StringPiece& message, const InetAddress& peerAddr) = &UdpChannel::sendInLoop;
+    loop_->runInLoop(
+        std::bind(makeWeakCallback(guard_, fp),
+                  message.as_string(),
+                  peerAddr));
+  }
+}
+
+void UdpChannel::sendInLoop(const StringPiece& message, const InetAddress& peerAddr)
+{
+  sendInLoop(message.data(), message.size(), peerAddr);
+}
+
+void UdpChannel::sendInLoop(const void* data, size_t len, const InetAddress& peerAddr)
+{
+  loop_->assertInLoopThread();
+  if (sendBuffer_.readableBytes() + len > kMaxQueuedBytes)
+  {
+    // it's UDP, drop rather than queue without bound
+    ++datagramsDropped_;
+    return;
+  }
+  sendBuffer_.append(data, len);
+  Pending pending = { peerAddr, len };
+  sendQueue_.push_back(pending);
+  if (!flushPending_ && !channel_->isWriting())
+  {
+    flushPending_ = true;
+    loop_->runBeforePoll(makeWeakCallback(guard_, &UdpChannel::flushInLoop));
+  }
+}
+
+/// sendmmsg(2)一次发出本轮循环积攒的数据报
+void UdpChannel::flushInLoop()
+{
+  loop_->assertInLoopThread();
+  flushPending_ = false;
+
+  if (!sendBatch_)
+  {
+    sendBatch_.reset(new SendBatch(batchSize_));
+  }
+  const size_t batchSize = static_cast<size_t>(batchSize_);
+  std::vector<struct mmsghdr>& msgs = sendBatch_->msgs;
+  std::vector<struct iovec>& iovecs = sendBatch_->iovecs;
+  size_t head = 0;
+  while (head < sendQueue_.size())
+  {
+    const size_t n = std::min(batchSize, sendQueue_.size() - head);
+    const char* data = sendBuffer_.peek();
+    memZero(&msgs[0], n * sizeof msgs[0]);
+    for (size_t i = 0; i < n; ++i)
+    {
+      const Pending& pending = sendQueue_[head + i];
+      iovecs[i].iov_base = const_cast<char*>(data);
+      iovecs[i].iov_len = pending.len;
+      data += pending.len;
+      struct msghdr& hdr = msgs[i].msg_hdr;
+      hdr.msg_name = const_cast<struct sockaddr*>(pending.peerAddr.getSockAddr());
+      hdr.msg_namelen = static_cast<socklen_t>(sizeof(struct sockaddr_in6));
+      hdr.msg_iov = &iovecs[i];
+      hdr.msg_iovlen = 1;
+#ifdef UDP_SEGMENT
+      if (gsoSegmentSize_ > 0 && pending.len > static_cast<size_t>(gsoSegmentSize_))
+      {
+        hdr.msg_control = &sendBatch_->control[i * SendBatch::kSegmentControlSize];
+        hdr.msg_controllen = SendBatch::kSegmentControlSize;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t segmentSize = static_cast<uint16_t>(gsoSegmentSize_);
+        ::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof segmentSize);
+      }
+#endif
+    }
+
+    int sent = ::sendmmsg(socket_->fd(), &msgs[0], static_cast<unsigned int>(n), 0);
+    if (sent < 0)
+    {
+      if (errno == EAGAIN || errno == ENOBUFS)
+      {
+        break;
+      }
+      // the first datagram can't be sent, drop it and go on
+      LOG_SYSERR << "UdpChannel::flushInLoop [" << name_ << "] to "
+                 << sendQueue_[head].peerAddr.toIpPort();
+      ++datagramsDropped_;
+      sent = 1;
+    }
+    else
+    {
+      datagramsSent_ += sent;
+    }
+    for (int i = 0; i < sent; ++i)
+    {
+      sendBuffer_.retrieve(sendQueue_[head + i].len);
+    }
+    head += sent;
+  }
+  sendQueue_.erase(sendQueue_.begin(), sendQueue_.begin() + head);
+
+  if (sendQueue_.empty())
+  {
+    if (channel_->isWriting())
+    {
+      channel_->disableWriting();
+    }
+  }
+  else if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+  }
+}
+
+void UdpChannel::handleWrite()
+{
+  loop_->assertInLoopThread();
+  flushInLoop();
+}
@@ -0,0 +1,124 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPCHANNEL_H
+#define MUDUO_NET_UDPCHANNEL_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/Callbacks.h"
+#include "muduo/net/InetAddress.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+class Socket;
+
+///
+/// A bound UDP socket on one EventLoop.
+///
+/// Datagrams are received with recvmmsg(2) into a preallocated batch of
+/// buffers. Sends are queued and flushed with sendmmsg(2) right before
+/// the loop goes back to polling.
+///
+/// Must be destroyed in the loop thread.
+class UdpChannel : noncopyable
+{
+ public:
+  UdpChannel(EventLoop* loop,
+             const InetAddress& bindAddr,
+             const string& nameArg,
+             bool reuseport = false);
+  ~UdpChannel();
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+  const InetAddress& localAddress() const { return localAddr_; }
+
+  /// Not thread safe, call before start().
+  void setDatagramCallback(const DatagramCallback& cb)
+  { datagramCallback_ = cb; }
+
+  /// Number of datagrams per recvmmsg/sendmmsg call.
+  /// Not thread safe, call before start().
+  void setBatchSize(int batchSize);
+  /// Not thread safe, call before start().
+  void setMaxDatagramSize(size_t maxDatagramSize);
+  /// Enable UDP_GRO, coalesced datagrams are split before calling back.
+  /// Not thread safe, call before start().
+  void enableGro(bool on);
+  /// Enable UDP_SEGMENT (GSO), a send larger than @c segmentSize carries
+  /// several equal-sized datagrams which the kernel splits. 0 disables.
+  void setGsoSegmentSize(int segmentSize);
+
+  /// Starts receiving. Thread safe.
+  void start();
+
+  /// Queues a datagram. Thread safe.
+  void send(const void* data, size_t len, const InetAddress& peerAddr);
+  void send(const StringPiece& message, const InetAddress& peerAddr);
+
+  // loop thread only
+  int64_t datagramsReceived() const { return datagramsReceived_; }
+  int64_t datagramsSent() const { return datagramsSent_; }
+  int64_t datagramsDropped() const { return datagramsDropped_; }
+
+ private:
+  struct Pending
+  {
+    InetAddress peerAddr;
+    size_t len;
+  };
+  struct RecvBatch;
+  struct SendBatch;
+
+  void startInLoop();
+  void handleRead(Timestamp receiveTime);
+  void handleWrite();
+  void sendInLoop(const StringPiece& message, const InetAddress& peerAddr);
+  void sendInLoop(const void* data, size_t len, const InetAddress& peerAddr);
+  void flushInLoop();
+
+  static const size_t kMaxQueuedBytes = 4*1024*1024;
+
+  EventLoop* loop_;
+  const string name_;
+  std::unique_ptr<Socket> socket_;
+  std::unique_ptr<Channel> channel_;
+  InetAddress localAddr_;
+  DatagramCallback datagramCallback_;
+  int batchSize_;
+  size_t maxDatagramSize_;
+  int gsoSegmentSize_;
+  bool gro_;
+  bool flushPending_;
+  // expires with this object, guards sendInLoop() and flushInLoop()
+  // queued in the loop
+  std::shared_ptr<UdpChannel> guard_;
+
+  std::unique_ptr<RecvBatch> recvBatch_;
+  std::unique_ptr<SendBatch> sendBatch_;
+  // queued datagrams, back to back in sendBuffer_
+  Buffer sendBuffer_;
+  std::vector<Pending> sendQueue_;
+
+  int64_t datagramsReceived_;
+  int64_t datagramsSent_;
+  int64_t datagramsDropped_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_UDPCHANNEL_H
@@ -0,0 +1,91 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/UdpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// UdpChannel must be destroyed in its own loop
+void destroyUdpChannel(const std::shared_ptr<UdpChannel>&)
+{
+}
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+UdpServer::UdpServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    listenAddr_(listenAddr),
+    name_(nameArg),
+    threadPool_(new EventLoopThreadPool(loop, name_)),
+    batchSize_(32),
+    gro_(false),
+    gsoSegmentSize_(0)
+{
+}
+
+UdpServer::~UdpServer()
+{
+  loop_->assertInLoopThread();
+  LOG_TRACE << "UdpServer::~UdpServer [" << name_ << "] destructing";
+
+  for (UdpChannelPtr& channel : channels_)
+  {
+    // hand over the last reference, or it may die here in the wrong thread
+    EventLoop* ioLoop = channel->getLoop();
+    ioLoop->runInLoop(
+        std::bind(&detail::destroyUdpChannel, std::move(channel)));
+  }
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+  if (started_.getAndSet(1) == 0)
+  {
+    loop_->assertInLoopThread();
+    threadPool_->start(threadInitCallback_);
+
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    const bool reuseport = loops.size() > 1;
+    InetAddress bindAddr(listenAddr_);
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+      char buf[32];
+      snprintf(buf, sizeof buf, "#%zu", i);
+      UdpChannelPtr channel(new UdpChannel(loops[i], bindAddr, name_ + buf, reuseport));
+      // an ephemeral port is picked by the first socket, the rest share it
+      bindAddr = channel->localAddress();
+      channel->setDatagramCallback(datagramCallback_);
+      channel->setBatchSize(batchSize_);
+      channel->enableGro(gro_);
+      channel->setGsoSegmentSize(gsoSegmentSize_);
+      channel->start();
+      channels_.push_back(channel);
+    }
+    LOG_INFO << "UdpServer::start [" << name_ << "] - listening on "
+             << bindAddr.toIpPort() << " with " << loops.size() << " sockets";
+  }
+}
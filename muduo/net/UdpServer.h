@@ -0,0 +1,89 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPSERVER_H
+#define MUDUO_NET_UDPSERVER_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/UdpChannel.h"
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class EventLoopThreadPool;
+
+///
+/// UDP server, supports single-threaded and thread-pool models.
+///
+/// With N threads, N sockets are bound to the same address with
+/// SO_REUSEPORT, one per loop, and the kernel shards datagrams among them.
+/// Replies sent through the UdpChannel given to the callback leave from
+/// the loop that received the request.
+class UdpServer : noncopyable
+{
+ public:
+  typedef std::function<void(EventLoop*)> ThreadInitCallback;
+
+  UdpServer(EventLoop* loop,
+            const InetAddress& listenAddr,
+            const string& nameArg);
+  ~UdpServer();  // force out-line dtor, for std::unique_ptr members.
+
+  const string& name() const { return name_; }
+  EventLoop* getLoop() const { return loop_; }
+
+  /// Set the number of threads for handling input.
+  ///
+  /// Must be called before @c start
+  /// @param numThreads
+  /// - 0 means all I/O in loop's thread, no thread will created.
+  ///   this is the default value.
+  /// - N means N threads, each owns a SO_REUSEPORT socket.
+  void setThreadNum(int numThreads);
+  void setThreadInitCallback(const ThreadInitCallback& cb)
+  { threadInitCallback_ = cb; }
+
+  /// Set datagram callback.
+  /// Not thread safe, must be called before @c start
+  void setDatagramCallback(const DatagramCallback& cb)
+  { datagramCallback_ = cb; }
+
+  /// See UdpChannel, must be called before @c start
+  void setBatchSize(int batchSize) { batchSize_ = batchSize; }
+  void enableGro(bool on) { gro_ = on; }
+  void setGsoSegmentSize(int segmentSize) { gsoSegmentSize_ = segmentSize; }
+
+  /// Starts the server if it's not listening.
+  ///
+  /// It's harmless to call it multiple times.
+  /// Must be called in loop's thread.
+  void start();
+
+ private:
+  typedef std::shared_ptr<UdpChannel> UdpChannelPtr;
+
+  EventLoop* loop_;
+  const InetAddress listenAddr_;
+  const string name_;
+  std::shared_ptr<EventLoopThreadPool> threadPool_;
+
+  DatagramCallback datagramCallback_;
+  ThreadInitCallback threadInitCallback_;
+  int batchSize_;
+  bool gro_;
+  int gsoSegmentSize_;
+  AtomicInt32 started_;
+  // one per loop
+  std::vector<UdpChannelPtr> channels_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_UDPSERVER_H
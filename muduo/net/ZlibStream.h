@@ -11,13 +11,13 @@ namespace net
 {
 
 // input is zlib compressed data, output uncompressed data
-// FIXME: finish this
 class ZlibInputStream : noncopyable
 {
  public:
   explicit ZlibInputStream(Buffer* output)
     : output_(output),
-      zerror_(Z_OK)
+      zerror_(Z_OK),
+      bufferSize_(1024)
   {
     memZero(&zstream_, sizeof zstream_);
     zerror_ = inflateInit(&zstream_);
@@ -28,30 +28,120 @@ class ZlibInputStream : noncopyable
     finish();
   }
 
-  bool write(StringPiece buf);
-  bool write(Buffer* input);
-  bool finish();
-    // inflateEnd(&zstream_);
+  const char* zlibErrorMessage() const { return zstream_.msg; }
+
+  int zlibErrorCode() const { return zerror_; }
+  int64_t inputBytes() const { return zstream_.total_in; }
+  int64_t outputBytes() const { return zstream_.total_out; }
+
+  // decompress all of input, as far as it goes.
+  bool write(StringPiece buf)
+  {
+    if (zerror_ != Z_OK)
+      return false;
+
+    void* in = const_cast<char*>(buf.data());
+    zstream_.next_in = static_cast<Bytef*>(in);
+    zstream_.avail_in = static_cast<uInt>(buf.size());
+    // a full output buffer may leave more output pending
+    do
+    {
+      zerror_ = decompress(Z_NO_FLUSH);
+    } while (zerror_ == Z_OK && (zstream_.avail_in > 0 || zstream_.avail_out == 0));
+    if (zerror_ == Z_BUF_ERROR)
+    {
+      // needs more input
+      zerror_ = Z_OK;
+    }
+    zstream_.next_in = NULL;
+    zstream_.avail_in = 0;
+    return zerror_ == Z_OK || zerror_ == Z_STREAM_END;
+  }
+
+  bool write(Buffer* input)
+  {
+    bool ok = write(StringPiece(input->peek(), static_cast<int>(input->readableBytes())));
+    input->retrieveAll();
+    return ok;
+  }
+
+  // decompress until about maxOutput bytes come out, retrieves the input
+  // consumed, inflate may keep some output for the next call.
+  bool write(Buffer* input, size_t maxOutput)
+  {
+    if (zerror_ != Z_OK)
+      return false;
+
+    zstream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input->peek()));
+    zstream_.avail_in = static_cast<uInt>(input->readableBytes());
+    const int64_t before = outputBytes();
+    do
+    {
+      zerror_ = decompress(Z_NO_FLUSH);
+    } while (zerror_ == Z_OK && (zstream_.avail_in > 0 || zstream_.avail_out == 0)
+             && static_cast<size_t>(outputBytes() - before) < maxOutput);
+    if (zerror_ == Z_BUF_ERROR)
+    {
+      // needs more input
+      zerror_ = Z_OK;
+    }
+    if (zerror_ == Z_STREAM_END)
+    {
+      input->retrieveAll();
+    }
+    else
+    {
+      input->retrieve(input->readableBytes() - zstream_.avail_in);
+    }
+    zstream_.next_in = NULL;
+    zstream_.avail_in = 0;
+    return zerror_ == Z_OK || zerror_ == Z_STREAM_END;
+  }
+
+  bool finish()
+  {
+    if (zstream_.state == Z_NULL)
+      return zerror_ == Z_STREAM_END;
+
+    bool ok = zerror_ == Z_OK || zerror_ == Z_STREAM_END;
+    if (inflateEnd(&zstream_) != Z_OK)
+      ok = false;
+    zerror_ = Z_STREAM_END;
+    return ok;
+  }
 
  private:
-  int decompress(int flush);
+  int decompress(int flush)
+  {
+    output_->ensureWritableBytes(bufferSize_);
+    zstream_.next_out = reinterpret_cast<Bytef*>(output_->beginWrite());
+    zstream_.avail_out = static_cast<uInt>(output_->writableBytes());
+    int error = ::inflate(&zstream_, flush);
+    output_->hasWritten(output_->writableBytes() - zstream_.avail_out);
+    if (output_->writableBytes() == 0 && bufferSize_ < 65536)
+    {
+      bufferSize_ *= 2;
+    }
+    return error;
+  }
 
   Buffer* output_;
   z_stream zstream_;
   int zerror_;
+  int bufferSize_;
 };
 
 // input is uncompressed data, output zlib compressed data
 class ZlibOutputStream : noncopyable
 {
  public:
-  explicit ZlibOutputStream(Buffer* output)
+  explicit ZlibOutputStream(Buffer* output, int level = Z_DEFAULT_COMPRESSION)
     : output_(output),
       zerror_(Z_OK),
       bufferSize_(1024)
   {
     memZero(&zstream_, sizeof zstream_);
-    zerror_ = deflateInit(&zstream_, Z_DEFAULT_COMPRESSION);
+    zerror_ = deflateInit(&zstream_, level);
   }
 
   ~ZlibOutputStream()
@@ -75,7 +165,7 @@ class ZlibOutputStream : noncopyable
     assert(zstream_.next_in == NULL && zstream_.avail_in == 0);
     void* in = const_cast<char*>(buf.data());
     zstream_.next_in = static_cast<Bytef*>(in);
-    zstream_.avail_in = buf.size();
+    zstream_.avail_in = static_cast<uInt>(buf.size());
     while (zstream_.avail_in > 0 && zerror_ == Z_OK)
     {
       zerror_ = compress(Z_NO_FLUSH);
@@ -105,6 +195,24 @@ class ZlibOutputStream : noncopyable
     return zerror_ == Z_OK;
   }
 
+  // output everything written so far, the stream goes on.
+  bool flush()
+  {
+    if (zerror_ != Z_OK)
+      return false;
+
+    do
+    {
+      zerror_ = compress(Z_SYNC_FLUSH);
+    } while (zerror_ == Z_OK && zstream_.avail_out == 0);
+    if (zerror_ == Z_BUF_ERROR)
+    {
+      // nothing more to flush
+      zerror_ = Z_OK;
+    }
+    return zerror_ == Z_OK;
+  }
+
   bool finish()
   {
     if (zerror_ != Z_OK)
@@ -125,7 +233,7 @@ class ZlibOutputStream : noncopyable
   {
     output_->ensureWritableBytes(bufferSize_);
     zstream_.next_out = reinterpret_cast<Bytef*>(output_->beginWrite());
-    zstream_.avail_out = static_cast<int>(output_->writableBytes());
+    zstream_.avail_out = static_cast<uInt>(output_->writableBytes());
     int error = ::deflate(&zstream_, flush);
     output_->hasWritten(output_->writableBytes() - zstream_.avail_out);
     if (output_->writableBytes() == 0 && bufferSize_ < 65536)
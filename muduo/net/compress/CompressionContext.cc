@@ -0,0 +1,128 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/compress/CompressionContext.h"
+
+#include "muduo/net/ZlibStream.h"
+#include "muduo/net/compress/CompressionTransport.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+class ZlibCompressor : public StreamCompressor
+{
+ public:
+  ZlibCompressor(Buffer* output, int level)
+    : stream_(output, level)
+  {
+  }
+
+  bool compress(const void* data, size_t len) override
+  {
+    return stream_.write(StringPiece(static_cast<const char*>(data), static_cast<int>(len)))
+        && stream_.flush();
+  }
+
+ private:
+  ZlibOutputStream stream_;
+};
+
+class ZlibDecompressor : public StreamDecompressor
+{
+ public:
+  explicit ZlibDecompressor(Buffer* output)
+    : stream_(output)
+  {
+  }
+
+  bool decompress(Buffer* input, size_t maxOutput) override
+  {
+    return stream_.write(input, maxOutput);
+  }
+
+ private:
+  ZlibInputStream stream_;
+};
+
+}  // namespace
+
+const char CompressionContext::kZlib[] = "zlib";
+
+CompressionContext::CompressionContext(int zlibLevel)
+{
+  addCodec(kZlib,
+           [zlibLevel](Buffer* output)
+           { return std::unique_ptr<StreamCompressor>(new ZlibCompressor(output, zlibLevel)); },
+           [](Buffer* output)
+           { return std::unique_ptr<StreamDecompressor>(new ZlibDecompressor(output)); });
+}
+
+CompressionContext::~CompressionContext() = default;
+
+void CompressionContext::addCodec(const string& name,
+                                  const CompressorFactory& compressor,
+                                  const DecompressorFactory& decompressor)
+{
+  // names go in a comma separated line
+  assert(!name.empty() && name.find_first_of(", \r\n") == string::npos);
+  assert(findCodec(name) == NULL);
+  Codec codec = { name, compressor, decompressor };
+  codecs_.push_back(codec);
+}
+
+std::vector<string> CompressionContext::codecs() const
+{
+  std::vector<string> names;
+  for (const Codec& codec : codecs_)
+  {
+    names.push_back(codec.name);
+  }
+  return names;
+}
+
+TransportFactory CompressionContext::serverTransportFactory()
+{
+  return std::bind(&CompressionContext::newTransport, this, false);
+}
+
+TransportFactory CompressionContext::clientTransportFactory()
+{
+  return std::bind(&CompressionContext::newTransport, this, true);
+}
+
+std::unique_ptr<Transport> CompressionContext::newTransport(bool client)
+{
+  return std::unique_ptr<Transport>(new CompressionTransport(this, client));
+}
+
+const CompressionContext::Codec* CompressionContext::findCodec(const string& name) const
+{
+  for (const Codec& codec : codecs_)
+  {
+    if (codec.name == name)
+    {
+      return &codec;
+    }
+  }
+  return NULL;
+}
+
+string CompressionContext::negotiate(const std::vector<string>& offered) const
+{
+  if (negotiateCallback_)
+  {
+    string name = negotiateCallback_(offered);
+    return findCodec(name) ? name : string();
+  }
+  for (const string& name : offered)
+  {
+    if (findCodec(name))
+    {
+      return name;
+    }
+  }
+  return string();
+}
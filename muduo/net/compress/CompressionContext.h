@@ -0,0 +1,125 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_COMPRESS_COMPRESSIONCONTEXT_H
+#define MUDUO_NET_COMPRESS_COMPRESSIONCONTEXT_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Callbacks.h"
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+
+/// Compressing side of one connection's stream.
+class StreamCompressor : noncopyable
+{
+ public:
+  virtual ~StreamCompressor() = default;
+
+  /// Compresses @c len bytes to the output given to the factory, and
+  /// flushes, so the peer can decompress everything written so far.
+  /// Returns false on error.
+  virtual bool compress(const void* data, size_t len) = 0;
+};
+
+/// Decompressing side of one connection's stream.
+class StreamDecompressor : noncopyable
+{
+ public:
+  virtual ~StreamDecompressor() = default;
+
+  /// Decompresses @c input to the output given to the factory, stopping
+  /// once about @c maxOutput bytes came out, and retrieves what it used.
+  /// Input left, or output kept inside, comes out on the next call.
+  /// Returns false on corrupt input.
+  virtual bool decompress(Buffer* input, size_t maxOutput) = 0;
+};
+
+///
+/// Transparent stream compression, shared by all connections of a
+/// TcpServer or of many TcpClients, across loops.
+///
+/// Right after connecting, the client offers its codecs in one line and the
+/// server answers with the one it picked, or "none". From then on, send()
+/// is compressed and flushed once per write, that is per message, or per
+/// corked batch with TcpConnection::setAutoCork(), and the message callback
+/// sees decompressed bytes. Both ends must use it.
+///
+/// zlib is built in. Other codecs, eg. zstd or lz4, are added with
+/// addCodec(), on both ends under the same name.
+///
+/// It takes the Transport of the connection, so it doesn't go with TLS.
+/// Configure before use, the rest is thread safe.
+class CompressionContext : noncopyable
+{
+ public:
+  /// Make the codec of one connection, writing to @c output.
+  typedef std::function<std::unique_ptr<StreamCompressor> (Buffer* output)> CompressorFactory;
+  typedef std::function<std::unique_ptr<StreamDecompressor> (Buffer* output)> DecompressorFactory;
+  /// Server side, picks one of the client's codecs, in its order of
+  /// preference, or returns "" to not compress.
+  typedef std::function<string (const std::vector<string>& offered)> NegotiateCallback;
+
+  static const char kZlib[];
+
+  /// @c zlibLevel is 1 (fast) to 9 (small), -1 for zlib's default.
+  explicit CompressionContext(int zlibLevel = -1);
+  ~CompressionContext();
+
+  /// Offered, or accepted by default, after those added before.
+  void addCodec(const string& name,
+                const CompressorFactory& compressor,
+                const DecompressorFactory& decompressor);
+  /// Default picks the first offer this context knows.
+  void setNegotiateCallback(const NegotiateCallback& cb)
+  { negotiateCallback_ = cb; }
+  std::vector<string> codecs() const;
+
+  /// For TcpServer::setTransportFactory().
+  TransportFactory serverTransportFactory();
+  /// For TcpClient::setTransportFactory().
+  TransportFactory clientTransportFactory();
+
+  /// negotiated, compressed or not
+  int64_t connections() { return connections_.get(); }
+  int64_t compressedConnections() { return compressedConnections_.get(); }
+  /// sent by all connections, before and after compression
+  int64_t bytesBeforeCompression() { return bytesBeforeCompression_.get(); }
+  int64_t bytesAfterCompression() { return bytesAfterCompression_.get(); }
+
+ private:
+  friend class CompressionTransport;
+
+  struct Codec
+  {
+    string name;
+    CompressorFactory compressor;
+    DecompressorFactory decompressor;
+  };
+
+  std::unique_ptr<Transport> newTransport(bool client);
+  const Codec* findCodec(const string& name) const;
+  string negotiate(const std::vector<string>& offered) const;
+
+  std::vector<Codec> codecs_;
+  NegotiateCallback negotiateCallback_;
+  AtomicInt64 connections_;
+  AtomicInt64 compressedConnections_;
+  AtomicInt64 bytesBeforeCompression_;
+  AtomicInt64 bytesAfterCompression_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_COMPRESS_COMPRESSIONCONTEXT_H
@@ -0,0 +1,242 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/compress/CompressionTransport.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/compress/CompressionContext.h"
+
+#include <algorithm>
+
+#include <errno.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char kHello[] = "COMPRESS ";
+const char kNone[] = "none";
+const size_t kMaxHelloLine = 1024;
+// compressed per write, bounds output_
+const size_t kMaxChunk = 64 * 1024;
+// decompressed per read, a few compressed bytes can make a lot
+const size_t kMaxReadOutput = 64 * 1024;
+
+}  // namespace
+
+CompressionTransport::CompressionTransport(CompressionContext* context, bool client)
+  : context_(context),
+    client_(client),
+    helloQueued_(false),
+    negotiated_(false),
+    codec_(kNone),
+    unacked_(0),
+    pending_(false)
+{
+}
+
+CompressionTransport::~CompressionTransport() = default;
+
+/// 客户端发 "COMPRESS zlib,lz4\r\n", 服务端回 "COMPRESS zlib\r\n" 或 "COMPRESS none\r\n"
+Transport::HandshakeState CompressionTransport::handshake(int sockfd)
+{
+  if (client_ && !helloQueued_)
+  {
+    string hello(kHello);
+    std::vector<string> names = context_->codecs();
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      hello += (i > 0 ? "," : "") + names[i];
+    }
+    hello += "\r\n";
+    output_.append(hello);
+    helloQueued_ = true;
+  }
+  if (!flushOutput(sockfd))
+  {
+    return errno == EWOULDBLOCK ? kHandshakeWantWrite : kHandshakeFailed;
+  }
+  if (negotiated_)
+  {
+    // the server's answer is out
+    return kHandshakeDone;
+  }
+
+  const char* crlf = input_.findCRLF();
+  while (crlf == NULL)
+  {
+    int savedErrno = 0;
+    ssize_t n = input_.readFd(sockfd, &savedErrno);
+    if (n < 0 && savedErrno == EAGAIN)
+    {
+      return kHandshakeWantRead;
+    }
+    crlf = input_.findCRLF();
+    if (n <= 0 || (crlf == NULL && input_.readableBytes() > kMaxHelloLine))
+    {
+      return kHandshakeFailed;
+    }
+  }
+  string line(input_.peek(), crlf);
+  // what follows the line is already compressed, it stays in input_
+  input_.retrieveUntil(crlf + 2);
+  if (line.compare(0, sizeof kHello - 1, kHello) != 0)
+  {
+    LOG_ERROR << "CompressionTransport::handshake - bad line " << line;
+    return kHandshakeFailed;
+  }
+  string names(line, sizeof kHello - 1);
+
+  if (client_)
+  {
+    if (!selectCodec(names))
+    {
+      LOG_ERROR << "CompressionTransport::handshake - server picked " << names;
+      return kHandshakeFailed;
+    }
+    return kHandshakeDone;
+  }
+
+  std::vector<string> offered;
+  size_t start = 0;
+  while (start <= names.size())
+  {
+    size_t comma = std::min(names.find(',', start), names.size());
+    if (comma > start)
+    {
+      offered.push_back(names.substr(start, comma - start));
+    }
+    start = comma + 1;
+  }
+  string name = context_->negotiate(offered);
+  selectCodec(name.empty() ? kNone : name);
+  output_.append(kHello + codec_ + "\r\n");
+  if (!flushOutput(sockfd))
+  {
+    return errno == EWOULDBLOCK ? kHandshakeWantWrite : kHandshakeFailed;
+  }
+  return kHandshakeDone;
+}
+
+bool CompressionTransport::selectCodec(const string& name)
+{
+  negotiated_ = true;
+  context_->connections_.increment();
+  if (name == kNone)
+  {
+    return true;
+  }
+  const CompressionContext::Codec* codec = context_->findCodec(name);
+  if (codec == NULL)
+  {
+    return false;
+  }
+  codec_ = name;
+  compressor_ = codec->compressor(&output_);
+  context_->compressedConnections_.increment();
+  return true;
+}
+
+/// 读到input_, 解压到buf, 每次最多解压出kMaxReadOutput字节; 只读到协议字节时返回EAGAIN
+ssize_t CompressionTransport::read(int sockfd, Buffer* buf, int* savedErrno)
+{
+  // with output left over, the socket waits, TCP flow control holds the peer back
+  ssize_t n = -1;
+  *savedErrno = EAGAIN;
+  if (!pending_)
+  {
+    n = input_.readFd(sockfd, savedErrno);
+    if (n < 0 && *savedErrno != EAGAIN)
+    {
+      return -1;
+    }
+  }
+  size_t before = buf->readableBytes();
+  if (compressor_)
+  {
+    if (!decompressor_)
+    {
+      // TcpConnection always reads into its inputBuffer()
+      decompressor_ = context_->findCodec(codec_)->decompressor(buf);
+    }
+    if (!decompressor_->decompress(&input_, kMaxReadOutput))
+    {
+      LOG_ERROR << "CompressionTransport::read - corrupt " << codec_ << " stream";
+      *savedErrno = EPROTO;
+      return -1;
+    }
+    pending_ = buf->readableBytes() - before >= kMaxReadOutput;
+  }
+  else
+  {
+    buf->append(input_.peek(), input_.readableBytes());
+    input_.retrieveAll();
+  }
+
+  size_t produced = buf->readableBytes() - before;
+  if (produced > 0)
+  {
+    return static_cast<ssize_t>(produced);
+  }
+  if (n == 0)
+  {
+    return 0;
+  }
+  *savedErrno = EAGAIN;
+  return -1;
+}
+
+/// 压缩后的字节全部写出去之后, 才把对应的原始字节报告为已写
+ssize_t CompressionTransport::write(int sockfd, const void* data, size_t len)
+{
+  if (!compressor_)
+  {
+    return sockets::write(sockfd, data, len);
+  }
+  if (unacked_ == 0)
+  {
+    size_t chunk = std::min(len, kMaxChunk);
+    size_t before = output_.readableBytes();
+    if (!compressor_->compress(data, chunk))
+    {
+      LOG_ERROR << "CompressionTransport::write - " << codec_ << " failed";
+      errno = EPROTO;
+      return -1;
+    }
+    unacked_ = chunk;
+    context_->bytesBeforeCompression_.add(static_cast<int64_t>(chunk));
+    context_->bytesAfterCompression_.add(static_cast<int64_t>(output_.readableBytes() - before));
+  }
+  if (!flushOutput(sockfd))
+  {
+    return -1;
+  }
+  // a rate limit may pass less this time
+  size_t n = std::min(unacked_, len);
+  unacked_ -= n;
+  return static_cast<ssize_t>(n);
+}
+
+void CompressionTransport::shutdown(int sockfd)
+{
+  // TcpConnection shuts down once all is reported written, output_ is empty
+  assert(output_.readableBytes() == 0);
+  (void)sockfd;
+}
+
+bool CompressionTransport::flushOutput(int sockfd)
+{
+  while (output_.readableBytes() > 0)
+  {
+    ssize_t n = sockets::write(sockfd, output_.peek(), output_.readableBytes());
+    if (n < 0)
+    {
+      return false;
+    }
+    output_.retrieve(static_cast<size_t>(n));
+  }
+  return true;
+}
@@ -0,0 +1,66 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_COMPRESS_COMPRESSIONTRANSPORT_H
+#define MUDUO_NET_COMPRESS_COMPRESSIONTRANSPORT_H
+
+#include "muduo/base/Types.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/Transport.h"
+
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+class CompressionContext;
+class StreamCompressor;
+class StreamDecompressor;
+
+///
+/// One compressed stream, see CompressionContext.
+///
+class CompressionTransport : public Transport
+{
+ public:
+  CompressionTransport(CompressionContext* context, bool client);
+  ~CompressionTransport() override;
+
+  HandshakeState handshake(int sockfd) override;
+  ssize_t read(int sockfd, Buffer* buf, int* savedErrno) override;
+  bool pending() const override { return pending_; }
+  ssize_t write(int sockfd, const void* data, size_t len) override;
+  void shutdown(int sockfd) override;
+
+  /// "none" until negotiated, or if the peers have no codec in common
+  const string& codec() const { return codec_; }
+
+ private:
+  bool flushOutput(int sockfd);
+  bool selectCodec(const string& name);
+
+  CompressionContext* context_;
+  const bool client_;
+  bool helloQueued_;
+  bool negotiated_;
+  string codec_;
+  Buffer input_;   // read from the socket, not decompressed yet
+  Buffer output_;  // compressed, not written to the socket yet
+  // declared after output_, may write to it when destroyed
+  std::unique_ptr<StreamCompressor> compressor_;
+  std::unique_ptr<StreamDecompressor> decompressor_;
+  // bytes of the caller's data compressed into output_, reported written
+  // once output_ is flushed, TcpConnection passes the same data again
+  size_t unacked_;
+  // the last read() stopped at kMaxReadOutput, there may be more
+  bool pending_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_COMPRESS_COMPRESSIONTRANSPORT_H
@@ -0,0 +1,223 @@
+// Stream compression: zlib, a codec added by the application, and no
+// compression, as picked by the server. A highly compressible stream is
+// decompressed a bounded amount at a time.
+
+#include "muduo/net/compress/CompressionContext.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kBanner[] = "welcome\n";
+const int kMessages = 64;
+
+EventLoop* g_loop;
+CompressionContext* g_serverContext;
+CompressionContext* g_clientContext;
+InetAddress g_serverAddr(2030, true);
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+std::vector<string> g_picks = { CompressionContext::kZlib, "xor", "" };
+size_t g_round = 0;
+string g_expected;
+string g_received;
+// compresses about a thousand to one
+const size_t kZeros = 32 * 1024 * 1024;
+bool g_zeros = false;
+size_t g_zerosReceived = 0;
+size_t g_maxPerMessage = 0;
+
+// a toy codec, to show how zstd or lz4 would plug in
+class XorCompressor : public StreamCompressor
+{
+ public:
+  explicit XorCompressor(Buffer* output) : output_(output) { }
+
+  bool compress(const void* data, size_t len) override
+  {
+    const char* p = static_cast<const char*>(data);
+    for (size_t i = 0; i < len; ++i)
+    {
+      output_->appendInt8(static_cast<int8_t>(p[i] ^ 0x5a));
+    }
+    return true;
+  }
+
+ private:
+  Buffer* output_;
+};
+
+class XorDecompressor : public StreamDecompressor
+{
+ public:
+  explicit XorDecompressor(Buffer* output) : output_(output) { }
+
+  bool decompress(Buffer* input, size_t maxOutput) override
+  {
+    for (size_t n = 0; n < maxOutput && input->readableBytes() > 0; ++n)
+    {
+      output_->appendInt8(static_cast<int8_t>(input->readInt8() ^ 0x5a));
+    }
+    return true;
+  }
+
+ private:
+  Buffer* output_;
+};
+
+void addXor(CompressionContext* context)
+{
+  context->addCodec("xor",
+                    [](Buffer* output)
+                    { return std::unique_ptr<StreamCompressor>(new XorCompressor(output)); },
+                    [](Buffer* output)
+                    { return std::unique_ptr<StreamDecompressor>(new XorDecompressor(output)); });
+}
+
+string pick(const std::vector<string>& offered)
+{
+  assert(offered.size() == 2 && offered[0] == CompressionContext::kZlib && offered[1] == "xor");
+  return g_picks[g_round];
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // may arrive along with the server's answer
+    conn->send(kBanner);
+  }
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (!g_zeros)
+  {
+    conn->send(buf);
+    return;
+  }
+  g_maxPerMessage = std::max(g_maxPerMessage, buf->readableBytes());
+  g_zerosReceived += buf->readableBytes();
+  buf->retrieveAll();
+  if (g_zerosReceived == kZeros)
+  {
+    conn->shutdown();
+  }
+}
+
+void newClient();
+
+void onZerosConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send(string(kZeros, '\0'));
+  }
+  else
+  {
+    printf("zeros: %zd bytes, at most %zd per message\n", g_zerosReceived, g_maxPerMessage);
+    assert(g_zerosReceived == kZeros);
+    // a compressed read of 64KiB would be about 64MiB, bounded to 64KiB, or a bit over
+    assert(g_maxPerMessage <= 256 * 1024);
+    // let the server side see the close too
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_expected = kBanner;
+    g_received.clear();
+    for (int i = 0; i < kMessages; ++i)
+    {
+      char line[64];
+      snprintf(line, sizeof line, "GET /index.html HTTP/1.1 request %d of a chatty client\r\n", i);
+      g_expected += line;
+      conn->send(line);
+    }
+    // more than the socket buffers, compressed in chunks and written partially
+    string big(2 * 1024 * 1024, ' ');
+    for (size_t i = 0; i < big.size(); ++i)
+    {
+      big[i] = static_cast<char>('a' + rand() % 16);
+    }
+    g_expected += big;
+    conn->send(big);
+  }
+  else
+  {
+    g_loop->queueInLoop(newClient);
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  g_received += buf->retrieveAllAsString();
+  assert(g_expected.compare(0, g_received.size(), g_received) == 0);
+  if (g_received.size() == g_expected.size())
+  {
+    int64_t before = g_clientContext->bytesBeforeCompression();
+    int64_t after = g_clientContext->bytesAfterCompression();
+    LOG_INFO << "picked '" << g_picks[g_round] << "' sent " << before << " compressed to " << after;
+    ++g_round;
+    conn->shutdown();
+  }
+}
+
+void newClient()
+{
+  if (g_round == g_picks.size())
+  {
+    assert(g_serverContext->connections() == 3);
+    assert(g_serverContext->compressedConnections() == 2);
+    assert(g_clientContext->compressedConnections() == 2);
+    assert(g_clientContext->bytesAfterCompression() < g_clientContext->bytesBeforeCompression());
+    g_round = 0;
+    g_zeros = true;
+    g_clients.emplace_back(new TcpClient(g_loop, g_serverAddr, "ZerosClient"));
+    g_clients.back()->setTransportFactory(g_clientContext->clientTransportFactory());
+    g_clients.back()->setConnectionCallback(onZerosConnection);
+    g_clients.back()->connect();
+    return;
+  }
+  g_clients.emplace_back(new TcpClient(g_loop, g_serverAddr, "CompressionClient"));
+  TcpClient* client = g_clients.back().get();
+  client->setTransportFactory(g_clientContext->clientTransportFactory());
+  client->setConnectionCallback(onClientConnection);
+  client->setMessageCallback(onClientMessage);
+  client->connect();
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  CompressionContext serverContext;
+  CompressionContext clientContext(9);
+  g_serverContext = &serverContext;
+  g_clientContext = &clientContext;
+  addXor(&serverContext);
+  addXor(&clientContext);
+  serverContext.setNegotiateCallback(pick);
+
+  TcpServer server(&loop, g_serverAddr, "Compression");
+  server.setTransportFactory(serverContext.serverTransportFactory());
+  server.setConnectionCallback(onServerConnection);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+  loop.runInLoop(newClient);
+  loop.runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+  g_clients.clear();
+}
@@ -0,0 +1,239 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/coro/Stream.h"
+
+#include "muduo/net/Buffer.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::coro;
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+namespace detail
+{
+
+struct StreamState
+{
+  explicit StreamState(TcpConnection* c)
+    : conn(c),
+      readNeed(0),
+      closed(false),
+      detached(false),
+      writeHighWaterMark(64 * 1024)
+  {
+  }
+
+  // raw pointer, the Stream holds the TcpConnectionPtr and the callbacks
+  // hold this, no cycle
+  TcpConnection* conn;
+  std::coroutine_handle<> reader;
+  std::coroutine_handle<> writer;
+  size_t readNeed;         // read(n)
+  StringPiece delimiter;   // readUntil()
+  bool closed;
+  bool detached;           // the Stream is gone
+  size_t writeHighWaterMark;
+
+  Buffer* input() const { return conn->inputBuffer(); }
+
+  const char* findDelimiter() const
+  {
+    const char* begin = input()->peek();
+    const char* end = input()->beginWrite();
+    const char* found = std::search(begin, end, delimiter.begin(), delimiter.end());
+    return found == end ? NULL : found;
+  }
+
+  bool readerReady() const
+  {
+    return closed || (delimiter.empty() ? input()->readableBytes() >= readNeed
+                                        : findDelimiter() != NULL);
+  }
+
+  bool writerReady() const
+  {
+    return closed || conn->outputBuffer()->readableBytes() <= writeHighWaterMark;
+  }
+
+  /// 在Channel事件回调里直接恢复协程, 不经过任何队列
+  void wakeReader()
+  {
+    if (reader && readerReady())
+    {
+      std::exchange(reader, nullptr).resume();
+    }
+  }
+
+  void wakeWriter()
+  {
+    if (writer && writerReady())
+    {
+      std::exchange(writer, nullptr).resume();
+    }
+  }
+};
+
+}  // namespace detail
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+namespace
+{
+
+typedef coro::detail::StreamState StreamState;
+
+void onMessage(const std::shared_ptr<StreamState>& state,
+               const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+  if (state->detached)
+  {
+    // nobody reads any more, don't let the input pile up
+    defaultMessageCallback(conn, buf, receiveTime);
+    return;
+  }
+  state->wakeReader();
+}
+
+void onWritable(const std::shared_ptr<StreamState>& state,
+                const TcpConnectionPtr&)
+{
+  state->wakeWriter();
+}
+
+void onConnection(const std::shared_ptr<StreamState>& state,
+                  const TcpConnectionPtr& conn)
+{
+  if (!conn->connected())
+  {
+    state->closed = true;
+    // keep state alive, the woken coroutine may destroy its Stream
+    std::shared_ptr<StreamState> guard(state);
+    guard->wakeReader();
+    guard->wakeWriter();
+  }
+}
+
+}  // namespace
+
+Stream::Stream(const TcpConnectionPtr& conn)
+  : conn_(conn),
+    state_(std::make_shared<StreamState>(conn.get()))
+{
+  conn_->getLoop()->assertInLoopThread();
+  state_->closed = !conn_->connected();
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  using std::placeholders::_3;
+  conn_->setMessageCallback(std::bind(onMessage, state_, _1, _2, _3));
+  conn_->setWriteCompleteCallback(std::bind(onWritable, state_, _1));
+  conn_->setLowWaterMarkCallback(std::bind(onWritable, state_, _1),
+                                 state_->writeHighWaterMark);
+  conn_->setConnectionCallback(std::bind(onConnection, state_, _1));
+}
+
+Stream::~Stream()
+{
+  // the callbacks stay, they may be running right now
+  state_->detached = true;
+  state_->reader = nullptr;
+  state_->writer = nullptr;
+}
+
+bool Stream::eof() const
+{
+  return state_->closed && state_->input()->readableBytes() == 0;
+}
+
+void Stream::setWriteHighWaterMark(size_t bytes)
+{
+  state_->writeHighWaterMark = bytes;
+  conn_->setLowWaterMarkCallback(std::bind(onWritable, state_, std::placeholders::_1), bytes);
+}
+
+Stream::WriteAwaiter Stream::write(StringPiece data)
+{
+  if (!state_->closed)
+  {
+    conn_->send(data);
+  }
+  return WriteAwaiter(state_.get());
+}
+
+Stream::WriteAwaiter Stream::write(Buffer* data)
+{
+  if (!state_->closed)
+  {
+    conn_->send(data);
+  }
+  return WriteAwaiter(state_.get());
+}
+
+bool Stream::ReadAwaiter::await_ready() const
+{
+  state_->readNeed = n_;
+  state_->delimiter = StringPiece();
+  return state_->readerReady();
+}
+
+void Stream::ReadAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+  assert(!state_->reader);
+  state_->reader = h;
+}
+
+string Stream::ReadAwaiter::await_resume()
+{
+  Buffer* input = state_->input();
+  return input->retrieveAsString(std::min(n_, input->readableBytes()));
+}
+
+bool Stream::ReadUntilAwaiter::await_ready() const
+{
+  state_->delimiter = delimiter_;
+  return state_->readerReady();
+}
+
+void Stream::ReadUntilAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+  assert(!state_->reader);
+  state_->reader = h;
+}
+
+string Stream::ReadUntilAwaiter::await_resume()
+{
+  Buffer* input = state_->input();
+  const char* found = state_->findDelimiter();
+  state_->delimiter = StringPiece();
+  if (found == NULL)
+  {
+    return input->retrieveAllAsString();
+  }
+  string result(input->peek(), found);
+  input->retrieveUntil(found + delimiter_.size());
+  return result;
+}
+
+bool Stream::WriteAwaiter::await_ready() const
+{
+  return state_->writerReady();
+}
+
+void Stream::WriteAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+  assert(!state_->writer);
+  state_->writer = h;
+}
+
+bool Stream::WriteAwaiter::await_resume() const
+{
+  return !state_->closed;
+}
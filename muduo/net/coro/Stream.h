@@ -0,0 +1,125 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CORO_STREAM_H
+#define MUDUO_NET_CORO_STREAM_H
+
+#include "muduo/base/StringPiece.h"
+#include "muduo/net/TcpConnection.h"
+#include "muduo/net/coro/Task.h"
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+
+namespace detail
+{
+struct StreamState;
+}  // namespace detail
+
+///
+/// Awaitable reads and writes on a TcpConnection.
+///
+/// A Stream takes over the connection's message, write complete and
+/// connection callbacks. The coroutine waiting on it is resumed right from
+/// those callbacks, ie. from Channel::handleEvent() in the connection's
+/// loop, no thread switch and no functor per read. Create and use it in
+/// the connection's loop thread, one reader and one writer at a time.
+///
+/// Usage:
+/// @code
+/// Task<> session(TcpConnectionPtr conn)
+/// {
+///   Stream stream(conn);
+///   for (;;)
+///   {
+///     string line = co_await stream.readUntil("\r\n");
+///     if (stream.eof()) break;
+///     co_await stream.write(line + "\r\n");
+///   }
+/// }
+/// @endcode
+class Stream : noncopyable
+{
+ public:
+  explicit Stream(const TcpConnectionPtr& conn);
+  /// The callbacks stay installed, input arriving afterwards is discarded.
+  ~Stream();
+
+  const TcpConnectionPtr& connection() const { return conn_; }
+
+  /// The peer has closed and everything received has been read.
+  bool eof() const;
+
+  /// Pending write()s wait until the output buffer drains below this.
+  /// Default 64 KiB.
+  void setWriteHighWaterMark(size_t bytes);
+
+  class ReadAwaiter
+  {
+   public:
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> h);
+    /// @c n bytes, fewer only at eof.
+    string await_resume();
+
+   private:
+    friend class Stream;
+    ReadAwaiter(detail::StreamState* state, size_t n) : state_(state), n_(n) { }
+    detail::StreamState* state_;
+    size_t n_;
+  };
+
+  class ReadUntilAwaiter
+  {
+   public:
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> h);
+    /// Up to, not including, the delimiter. The rest of the input at eof.
+    string await_resume();
+
+   private:
+    friend class Stream;
+    ReadUntilAwaiter(detail::StreamState* state, StringPiece delimiter)
+      : state_(state), delimiter_(delimiter) { }
+    detail::StreamState* state_;
+    StringPiece delimiter_;
+  };
+
+  class WriteAwaiter
+  {
+   public:
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> h);
+    /// false if the connection is gone, data may have been lost.
+    bool await_resume() const;
+
+   private:
+    friend class Stream;
+    explicit WriteAwaiter(detail::StreamState* state) : state_(state) { }
+    detail::StreamState* state_;
+  };
+
+  ReadAwaiter read(size_t n) { return ReadAwaiter(state_.get(), n); }
+  /// @c delimiter must outlive the co_await.
+  ReadUntilAwaiter readUntil(StringPiece delimiter) { return ReadUntilAwaiter(state_.get(), delimiter); }
+  /// Data is queued at once, the coroutine only suspends on backpressure.
+  WriteAwaiter write(StringPiece data);
+  WriteAwaiter write(Buffer* data);
+
+ private:
+  TcpConnectionPtr conn_;
+  // shared with the connection's callbacks, which may outlive the Stream
+  std::shared_ptr<detail::StreamState> state_;
+};
+
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CORO_STREAM_H
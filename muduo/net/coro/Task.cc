@@ -0,0 +1,111 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/coro/Task.h"
+
+#include <new>
+
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::coro;
+
+namespace
+{
+
+const size_t kAlignment = 64;
+const size_t kNumClasses = 32;  // frames up to 2 KiB are pooled
+
+struct FreeFrame
+{
+  FreeFrame* next;
+};
+
+/// 每个线程(即每个EventLoop)一份, 无需加锁
+struct ThreadFramePool
+{
+  FreeFrame* freeLists[kNumClasses] = {};
+  size_t cached = 0;
+  size_t maxCached = 1024;
+  size_t allocations = 0;
+  size_t reuses = 0;
+
+  ~ThreadFramePool()
+  {
+    for (FreeFrame* head : freeLists)
+    {
+      while (head)
+      {
+        FreeFrame* next = head->next;
+        ::free(head);
+        head = next;
+      }
+    }
+  }
+};
+
+thread_local ThreadFramePool t_framePool;
+
+size_t sizeClass(size_t size)
+{
+  return (size + kAlignment - 1) / kAlignment - 1;
+}
+
+}  // namespace
+
+void* FramePool::allocate(size_t size)
+{
+  size_t index = sizeClass(size);
+  if (index < kNumClasses)
+  {
+    FreeFrame*& head = t_framePool.freeLists[index];
+    if (head)
+    {
+      FreeFrame* frame = head;
+      head = frame->next;
+      --t_framePool.cached;
+      ++t_framePool.reuses;
+      return frame;
+    }
+    size = (index + 1) * kAlignment;
+  }
+  ++t_framePool.allocations;
+  void* frame = ::malloc(size);
+  if (frame == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return frame;
+}
+
+void FramePool::deallocate(void* frame, size_t size)
+{
+  size_t index = sizeClass(size);
+  if (index < kNumClasses && t_framePool.cached < t_framePool.maxCached)
+  {
+    FreeFrame* node = static_cast<FreeFrame*>(frame);
+    node->next = t_framePool.freeLists[index];
+    t_framePool.freeLists[index] = node;
+    ++t_framePool.cached;
+  }
+  else
+  {
+    ::free(frame);
+  }
+}
+
+void FramePool::setMaxCachedFrames(size_t maxFrames)
+{
+  t_framePool.maxCached = maxFrames;
+}
+
+size_t FramePool::allocations()
+{
+  return t_framePool.allocations;
+}
+
+size_t FramePool::reuses()
+{
+  return t_framePool.reuses;
+}
@@ -0,0 +1,264 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CORO_TASK_H
+#define MUDUO_NET_CORO_TASK_H
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "muduo/net/coro requires C++20 coroutines, compile with -std=c++20"
+#endif
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/EventLoop.h"
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include <assert.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace coro
+{
+
+///
+/// Allocator of coroutine frames, one per thread, hence one per EventLoop.
+///
+/// Frames are recycled in 64-byte size classes, a session that suspends
+/// and resumes many times allocates its frames once. Frames must be freed
+/// in the thread that allocated them, which holds as long as coroutines
+/// stay in their loop, see post().
+class FramePool : noncopyable
+{
+ public:
+  static void* allocate(size_t size);
+  static void deallocate(void* frame, size_t size);
+
+  /// Per thread, frames beyond this go back to malloc. Default 1024.
+  static void setMaxCachedFrames(size_t maxFrames);
+
+  static size_t allocations();  // served by malloc
+  static size_t reuses();       // served from the pool
+};
+
+namespace detail
+{
+
+struct PooledFrame
+{
+  static void* operator new(size_t size) { return FramePool::allocate(size); }
+  static void operator delete(void* frame, size_t size) { FramePool::deallocate(frame, size); }
+};
+
+template<typename T>
+class TaskPromise;
+
+}  // namespace detail
+
+///
+/// A lazily started coroutine returning @c T.
+///
+/// Nothing runs until the Task is co_awaited, or handed to spawn(). The
+/// awaiting coroutine is resumed by symmetric transfer when the Task
+/// finishes, so deep chains of co_await don't grow the stack.
+template<typename T = void>
+class Task : noncopyable
+{
+ public:
+  typedef detail::TaskPromise<T> promise_type;
+  typedef std::coroutine_handle<promise_type> Handle;
+
+  explicit Task(Handle h) : handle_(h) { }
+  Task(Task&& rhs) noexcept : handle_(std::exchange(rhs.handle_, nullptr)) { }
+  ~Task()
+  {
+    if (handle_)
+    {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+  {
+    handle_.promise().setContinuation(awaiting);
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().result(); }
+
+ private:
+  Handle handle_;
+};
+
+namespace detail
+{
+
+class TaskPromiseBase : public PooledFrame
+{
+ public:
+  struct FinalAwaiter
+  {
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+    {
+      return h.promise().continuation_;
+    }
+
+    void await_resume() noexcept { }
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+  void setContinuation(std::coroutine_handle<> h) { continuation_ = h; }
+
+ protected:
+  void rethrowIfFailed()
+  {
+    if (exception_)
+    {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+ private:
+  std::coroutine_handle<> continuation_ = std::noop_coroutine();
+  std::exception_ptr exception_;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase
+{
+ public:
+  Task<T> get_return_object()
+  {
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+  }
+
+  template<typename U>
+  void return_value(U&& value) { value_ = std::forward<U>(value); }
+
+  T result()
+  {
+    rethrowIfFailed();
+    return std::move(value_);
+  }
+
+ private:
+  T value_ {};
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+ public:
+  Task<void> get_return_object()
+  {
+    return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+  }
+
+  void return_void() { }
+  void result() { rethrowIfFailed(); }
+};
+
+// owns itself, frees its frame when the task finishes
+struct Detached
+{
+  struct promise_type : PooledFrame
+  {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() { }
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+inline Detached runDetached(Task<void> task)
+{
+  co_await task;
+}
+
+}  // namespace detail
+
+/// Starts @c task in the loop thread, it runs until its first suspension
+/// before spawn() returns. An exception escaping the task terminates.
+inline void spawn(EventLoop* loop, Task<void> task)
+{
+  if (loop->isInLoopThread())
+  {
+    detail::runDetached(std::move(task));
+  }
+  else
+  {
+    // EventLoop::Functor is move-only, it owns the task until it runs
+    loop->queueInLoop([task = std::move(task)]() mutable
+                      { detail::runDetached(std::move(task)); });
+  }
+}
+
+///
+/// co_await sleep(loop, seconds), resumes in the loop thread from the
+/// TimerQueue, without blocking it.
+class SleepAwaiter
+{
+ public:
+  SleepAwaiter(EventLoop* loop, double seconds) : loop_(loop), seconds_(seconds) { }
+
+  bool await_ready() const noexcept { return seconds_ <= 0; }
+  void await_suspend(std::coroutine_handle<> h)
+  {
+    loop_->runAfter(seconds_, [h]() { h.resume(); });
+  }
+  void await_resume() noexcept { }
+
+ private:
+  EventLoop* loop_;
+  double seconds_;
+};
+
+inline SleepAwaiter sleep(EventLoop* loop, double seconds)
+{
+  return SleepAwaiter(loop, seconds);
+}
+
+///
+/// co_await post(loop) reschedules the coroutine at the end of the loop's
+/// pending functors, letting other events run first. Awaiting another loop
+/// moves the coroutine to that loop's thread.
+class PostAwaiter
+{
+ public:
+  explicit PostAwaiter(EventLoop* loop) : loop_(loop) { }
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h)
+  {
+    loop_->queueInLoop([h]() { h.resume(); });
+  }
+  void await_resume() noexcept { }
+
+ private:
+  EventLoop* loop_;
+};
+
+inline PostAwaiter post(EventLoop* loop)
+{
+  return PostAwaiter(loop);
+}
+
+}  // namespace coro
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CORO_TASK_H
@@ -0,0 +1,193 @@
+#include "muduo/net/coro/Stream.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::coro;
+
+const int kLines = 1000;
+const size_t kBlockSize = 4 * 1024 * 1024;
+
+EventLoop* g_loop;
+int g_clientsDone = 0;
+TcpConnectionPtr g_detached;
+
+void clientDone()
+{
+  if (++g_clientsDone == 2)
+  {
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+// a nested task per request, its frame comes from the FramePool
+Task<string> handleLine(const string& line)
+{
+  co_return "echo " + line;
+}
+
+// line protocol, "BLOCK n" is answered with a length prefixed block
+Task<> serverSession(TcpConnectionPtr conn)
+{
+  Stream stream(conn);
+  for (;;)
+  {
+    string line = co_await stream.readUntil("\r\n");
+    if (stream.eof())
+    {
+      break;
+    }
+    if (line == "DETACH")
+    {
+      // returns with the connection still open
+      g_detached = conn;
+      break;
+    }
+    if (line.compare(0, 6, "BLOCK ") == 0)
+    {
+      size_t n = static_cast<size_t>(atol(line.c_str() + 6));
+      string header = line.substr(6) + "\n";
+      co_await stream.write(header);
+      co_await stream.write(string(n, 'b'));
+    }
+    else
+    {
+      string reply = co_await handleLine(line);
+      co_await stream.write(reply + "\r\n");
+    }
+  }
+  LOG_INFO << "server session done " << conn->name();
+}
+
+Task<> clientSession(TcpConnectionPtr conn)
+{
+  Stream stream(conn);
+  co_await sleep(g_loop, 0.01);
+  co_await post(g_loop);
+
+  for (int i = 0; i < kLines; ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "line %d", i);
+    co_await stream.write(string(buf) + "\r\n");
+    string reply = co_await stream.readUntil("\r\n");
+    if (reply != string("echo ") + buf)
+    {
+      LOG_FATAL << "bad reply " << reply;
+    }
+  }
+
+  char request[32];
+  snprintf(request, sizeof request, "BLOCK %zu\r\n", kBlockSize);
+  co_await stream.write(request);
+  string header = co_await stream.readUntil("\n");
+  size_t n = static_cast<size_t>(atol(header.c_str()));
+  string block = co_await stream.read(n);
+  if (n != kBlockSize || block.size() != kBlockSize || block.find_first_not_of('b') != string::npos)
+  {
+    LOG_FATAL << "bad block " << block.size();
+  }
+
+  conn->shutdown();
+  string rest = co_await stream.read(1);
+  if (!rest.empty() || !stream.eof())
+  {
+    LOG_FATAL << "expect eof";
+  }
+  LOG_INFO << "client session done, frame allocations " << FramePool::allocations()
+           << " reuses " << FramePool::reuses();
+  clientDone();
+}
+
+// the server drops its Stream after one line, what follows is discarded
+// instead of piling up in the input buffer
+Task<> detachSession(TcpConnectionPtr conn)
+{
+  Stream stream(conn);
+  co_await stream.write("DETACH\r\n" + string(kBlockSize, 'd'));
+  // the server side runs in this loop too
+  co_await sleep(g_loop, 0.2);
+  if (!g_detached || g_detached->inputBuffer()->readableBytes() > 0)
+  {
+    LOG_FATAL << "input kept after the Stream was destroyed";
+  }
+  g_detached->forceClose();
+  g_detached.reset();
+  clientDone();
+}
+
+// spawned from another thread, the queued functor owns it until it runs
+bool g_spawnedRan = false;
+
+Task<> spawnedTask()
+{
+  g_spawnedRan = g_loop->isInLoopThread();
+  co_return;
+}
+
+void timeout()
+{
+  LOG_ERROR << "timeout";
+  abort();
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress serverAddr(2012, true);
+
+  TcpServer server(&loop, serverAddr, "CoroServer");
+  server.setConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      spawn(conn->getLoop(), serverSession(conn));
+    }
+  });
+  // one thread, so FramePool stats cover both sides
+  server.start();
+
+  TcpClient client(&loop, serverAddr, "CoroClient");
+  client.setConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      spawn(g_loop, clientSession(conn));
+    }
+  });
+  client.connect();
+
+  TcpClient detachClient(&loop, serverAddr, "CoroDetachClient");
+  detachClient.setConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      spawn(g_loop, detachSession(conn));
+    }
+  });
+  detachClient.connect();
+
+  Thread spawner([]() { spawn(g_loop, spawnedTask()); }, "spawner");
+  spawner.start();
+  spawner.join();
+
+  loop.runAfter(10.0, timeout);
+  loop.loop();
+  if (!g_spawnedRan)
+  {
+    LOG_ERROR << "task spawned from another thread did not run in the loop";
+    abort();
+  }
+  // every handleLine() but the first reuses a frame
+  if (FramePool::reuses() < static_cast<size_t>(kLines - 1))
+  {
+    LOG_ERROR << "coroutine frames are not pooled";
+    abort();
+  }
+}
@@ -11,6 +11,8 @@
 #include "muduo/base/Logging.h"
 #include "muduo/net/Channel.h"
 
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
 #include <poll.h>
@@ -62,6 +64,7 @@ EPollPoller::~EPollPoller()
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
   LOG_TRACE << "fd total count " << channels_.size();
+  applyInterestChanges();
   /// 调用epoll_wait从获取活跃的事件存储到events_中
   int numEvents = ::epoll_wait(epollfd_,
                                &*events_.begin(),
@@ -103,69 +106,55 @@ void EPollPoller::fillActiveChannels(int numEvents,
   assert(implicit_cast<size_t>(numEvents) <= events_.size());
   for (int i = 0; i < numEvents; ++i)
   {
-    /// 转型events_[i].data.ptr指针转为channel指针
-    Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
-#ifndef NDEBUG
-    /// fd
-    int fd = channel->fd();
-    /// 在channels_中查找活跃的fd key
-    ChannelMap::const_iterator it = channels_.find(fd);
-    assert(it != channels_.end());
-    assert(it->second == channel);
-#endif
+    /// data.u64 = generation << 32 | fd, 见update()
+    uint64_t data = events_[i].data.u64;
+    int fd = static_cast<int>(data & 0xffffffff);
+    uint32_t generation = static_cast<uint32_t>(data >> 32);
+    Channel* channel = channels_.find(fd);
+    if (channel == NULL || channels_.generation(fd) != generation)
+    {
+      // the fd was closed and reused by a new Channel since it was polled
+      LOG_DEBUG << "stale event on fd " << fd;
+      continue;
+    }
+    assert(channel->fd() == fd);
   /// events是epoll注册的事件
     channel->set_revents(events_[i].events);
     activeChannels->push_back(channel);
   }
 }
 
-/// 更新channel, 也就是调用update更新fd监听的事件
+/// 更新channel, 只记录下来, 由applyInterestChanges()在下一次epoll_wait前同步
 /// fd和events构成了监听对象
 void EPollPoller::updateChannel(Channel* channel)
 {
   Poller::assertInLoopThread();
   const int index = channel->index();
-  LOG_TRACE << "fd = " << channel->fd()
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd
     << " events = " << channel->events() << " index = " << index;
-  if (index == kNew || index == kDeleted)
+  if (index == kNew)
   {
-    // a new one, add with EPOLL_CTL_ADD
-    int fd = channel->fd();
-    if (index == kNew)
-    {
-      /// 对fd设置新的channel
-      assert(channels_.find(fd) == channels_.end());
-      channels_[fd] = channel;
-    }
-    else // index == kDeleted
-    {
-      assert(channels_.find(fd) != channels_.end());
-      assert(channels_[fd] == channel);
-    }
-    // 添加操作
-    channel->set_index(kAdded);
-
-    /// 在epoll中添加注册channel的fd
-    update(EPOLL_CTL_ADD, channel);
+    /// 对fd设置新的channel
+    channels_.add(fd, channel);
   }
   else
   {
-    // update existing one with EPOLL_CTL_MOD/DEL
-    int fd = channel->fd();
-    (void)fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
-    assert(index == kAdded);
-    if (channel->isNoneEvent())
-    {
-      update(EPOLL_CTL_DEL, channel);
-      /// delete操作
-      channel->set_index(kDeleted);
-    }
-    else
-    {
-      update(EPOLL_CTL_MOD, channel);
-    }
+    assert(channels_.find(fd) == channel);
+    assert(index == kAdded || index == kDeleted);
+  }
+  channel->set_index(channel->isNoneEvent() ? kDeleted : kAdded);
+
+  ++interestChanges_;
+  if (static_cast<size_t>(fd) >= interests_.size())
+  {
+    interests_.resize(std::max(static_cast<size_t>(fd) + 1, interests_.size() * 2));
+  }
+  Interest& interest = interests_[fd];
+  if (!interest.dirty)
+  {
+    interest.dirty = true;
+    dirtyFds_.push_back(fd);
   }
 }
 
@@ -176,23 +165,61 @@ void EPollPoller::removeChannel(Channel* channel)
   // channel的fd
   int fd = channel->fd();
   LOG_TRACE << "fd = " << fd;
-  assert(channels_.find(fd) != channels_.end());
-  assert(channels_[fd] == channel);
+  assert(channels_.find(fd) == channel);
   assert(channel->isNoneEvent());
   int index = channel->index();
   assert(index == kAdded || index == kDeleted);
+  (void)index;
 
-  size_t n = channels_.erase(fd);
-  (void)n;
-  assert(n == 1);
-  /// 在epoll中删除channel的fd
-  if (index == kAdded)
+  channels_.remove(fd);
+  /// 立即从epoll中删除, fd随后可能被关闭并复用
+  ++interestChanges_;
+  Interest& interest = interests_[fd];
+  if (interest.inKernel)
   {
     update(EPOLL_CTL_DEL, channel);
   }
+  // a pending entry in dirtyFds_ sees no channel, or a new one for a reused fd
+  interest.events = 0;
+  interest.inKernel = false;
   channel->set_index(kNew);
 }
 
+void EPollPoller::applyInterestChanges()
+{
+  for (int fd : dirtyFds_)
+  {
+    Interest& interest = interests_[fd];
+    interest.dirty = false;
+    Channel* channel = channels_.find(fd);
+    if (channel == NULL)
+    {
+      continue;
+    }
+    /// 与内核中登记的兴趣比较, 相互抵消的变化不发系统调用
+    int wanted = channel->isNoneEvent() ? 0 : channel->events();
+    if (!interest.inKernel)
+    {
+      if (wanted != 0)
+      {
+        update(EPOLL_CTL_ADD, channel);
+        interest.inKernel = true;
+      }
+    }
+    else if (wanted == 0)
+    {
+      update(EPOLL_CTL_DEL, channel);
+      interest.inKernel = false;
+    }
+    else if (wanted != interest.events)
+    {
+      update(EPOLL_CTL_MOD, channel);
+    }
+    interest.events = wanted;
+  }
+  dirtyFds_.clear();
+}
+
 /// 更新poll的fd, ::epoll_ctl更新fd_的事件
 void EPollPoller::update(int operation, Channel* channel)
 {
@@ -201,11 +228,14 @@ void EPollPoller::update(int operation, Channel* channel)
   memZero(&event, sizeof event);
 
   /// 事件元素, 设置event.events, event.data.ptr
-  event.events = channel->events();
-  event.data.ptr = channel;
   int fd = channel->fd();
+  event.events = channel->events();
+  /// 带上generation, fd被复用时能认出旧fd的事件
+  event.data.u64 = static_cast<uint64_t>(channels_.generation(fd)) << 32
+                   | static_cast<uint32_t>(fd);
   LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
     << " fd = " << fd << " event = { " << channel->eventsToString() << " }";
+  ++interestSyscalls_;
   if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
   {
     if (operation == EPOLL_CTL_DEL)
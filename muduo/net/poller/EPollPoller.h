@@ -25,6 +25,10 @@ namespace net
 ///
 /// IO Multiplexing with epoll(4).
 ///
+/// Interest changes are recorded and reconciled with the kernel once per
+/// poll(), right before epoll_wait(). A channel that enables and disables
+/// writing within one iteration costs no epoll_ctl() at all.
+/// removeChannel() still takes effect at once, the fd may be closed next.
 class EPollPoller : public Poller
 {
  public:
@@ -44,6 +48,8 @@ class EPollPoller : public Poller
                           ChannelList* activeChannels) const;
   // update channel
   void update(int operation, Channel* channel);
+  /// 在epoll_wait之前, 把记录的兴趣变化一次性同步给内核
+  void applyInterestChanges();
   /// event 列表, event是一个epoll_event 结构体
   /// epoll_event储存events和data, 存储一个监听的时间
   /// events 是 epoll 注册的事件，比如EPOLLIN、EPOLLOUT等等
@@ -53,6 +59,17 @@ class EPollPoller : public Poller
   int epollfd_;
   /// events_是一个epoll_event结构体的vector
   EventList events_;
+
+  /// 内核中登记的状态, 以fd为下标
+  struct Interest
+  {
+    Interest() : events(0), inKernel(false), dirty(false) { }
+    int events;
+    bool inKernel;
+    bool dirty;
+  };
+  std::vector<Interest> interests_;
+  std::vector<int> dirtyFds_;
 };
 
 }  // namespace net
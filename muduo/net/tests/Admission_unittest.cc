@@ -0,0 +1,139 @@
+// TcpServer stops accepting when overloaded, and resumes with hysteresis.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+EventLoop* g_loop;
+TcpServer* g_capped;
+TcpServer* g_lagged;
+int g_accepted = 0;
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+string g_rejectedReply;
+bool g_admittedAgain = false;
+
+TcpClient* connect(const InetAddress& addr)
+{
+  char name[32];
+  snprintf(name, sizeof name, "client%zu", g_clients.size());
+  g_clients.emplace_back(new TcpClient(g_loop, addr, name));
+  g_clients.back()->connect();
+  return g_clients.back().get();
+}
+
+void onCappedConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    ++g_accepted;
+  }
+}
+
+// connection cap
+
+void checkResumed()
+{
+  LOG_INFO << "accepted " << g_accepted;
+  assert(g_accepted == 5);
+  assert(!g_capped->overloaded());
+  g_loop->quit();
+}
+
+void checkPaused()
+{
+  LOG_INFO << "accepted " << g_accepted;
+  assert(g_accepted == 3);
+  assert(g_capped->overloaded());
+  for (auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+  g_loop->runAfter(0.3, checkResumed);
+}
+
+// loop lag, fast reject
+
+void onRejectedMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_rejectedReply += buf->retrieveAllAsString();
+}
+
+void onLaggedConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_admittedAgain = true;
+  }
+}
+
+void finish()
+{
+  assert(g_rejectedReply == "busy\r\n");
+  assert(g_lagged->rejectedConnections() == 1);
+  assert(g_admittedAgain);
+  for (auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+}
+
+void connectAfterLag(const InetAddress& addr)
+{
+  assert(!g_lagged->overloaded());
+  connect(addr);
+  g_loop->runAfter(0.2, finish);
+}
+
+void connectDuringLag(const InetAddress& addr)
+{
+  LOG_INFO << "loop lag " << g_lagged->loopLag();
+  assert(g_lagged->overloaded());
+  TcpClient* client = connect(addr);
+  client->setMessageCallback(onRejectedMessage);
+  g_loop->runAfter(0.5, std::bind(connectAfterLag, addr));
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+
+  InetAddress cappedAddr(2017);
+  TcpServer capped(&loop, cappedAddr, "Capped");
+  g_capped = &capped;
+  capped.setMaxConnections(3, 1);
+  capped.setConnectionCallback(onCappedConnection);
+  capped.start();
+  for (int i = 0; i < 5; ++i)
+  {
+    connect(cappedAddr);
+  }
+  loop.runAfter(0.2, checkPaused);
+  loop.loop();
+  g_clients.clear();
+
+  InetAddress laggedAddr(2018);
+  TcpServer lagged(&loop, laggedAddr, "Lagged");
+  g_lagged = &lagged;
+  lagged.setThreadNum(1);
+  lagged.setMaxLoopLag(0.05, 0.01, 0.01);
+  lagged.setOverloadResponse("busy\r\n");
+  lagged.setConnectionCallback(onLaggedConnection);
+  lagged.start();
+  // the IO loop is stuck for 300ms
+  lagged.threadPool()->getAllLoops()[0]->runInLoop([]() { ::usleep(300 * 1000); });
+  loop.runAfter(0.15, std::bind(connectDuringLag, laggedAddr));
+  loop.loop();
+  g_clients.clear();
+}
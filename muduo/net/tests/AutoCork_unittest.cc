@@ -0,0 +1,116 @@
+// TcpConnection::setAutoCork(): many send()s in one iteration leave in one
+// write, in order, and a shutdown() right after them waits for that write.
+// A plain blocking client counts the data segments it got.
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/TcpServer.h"
+
+// struct tcp_info of glibc stops before tcpi_data_segs_in
+#include <linux/tcp.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kSends = 100;
+const size_t kSendSize = 100;
+
+EventLoop* g_loop;
+InetAddress g_serverAddr(2038, true);
+
+char pattern(size_t i)
+{
+  return static_cast<char>('a' + i % 23);
+}
+
+void onServerConnection(bool cork, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // every write a segment of its own, unless corked
+    conn->setTcpNoDelay(true);
+    conn->setAutoCork(cork);
+    for (int i = 0; i < kSends; ++i)
+    {
+      string message(kSendSize, ' ');
+      for (size_t j = 0; j < kSendSize; ++j)
+      {
+        message[j] = pattern(i * kSendSize + j);
+      }
+      conn->send(message);
+    }
+    conn->shutdown();
+  }
+  else
+  {
+    g_loop->quit();
+  }
+}
+
+// reads until the server shuts down, returns the data segments it took
+int runClient()
+{
+  int sockfd = sockets::createNonblockingOrDie(AF_INET);
+  int ret = sockets::connect(sockfd, g_serverAddr.getSockAddr());
+  assert(ret == 0 || errno == EINPROGRESS);
+  (void) ret;
+  // blocking from here on
+  ::fcntl(sockfd, F_SETFL, 0);
+
+  size_t received = 0;
+  char buf[4096];
+  ssize_t n = 0;
+  while ((n = ::read(sockfd, buf, sizeof buf)) > 0)
+  {
+    for (ssize_t i = 0; i < n; ++i)
+    {
+      assert(buf[i] == pattern(received + i));
+    }
+    received += n;
+  }
+  assert(n == 0);
+  // all of it came before the FIN
+  assert(received == kSends * kSendSize);
+
+  struct tcp_info tcpi;
+  socklen_t len = sizeof tcpi;
+  memZero(&tcpi, len);
+  ::getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &tcpi, &len);
+  ::close(sockfd);
+  return static_cast<int>(tcpi.tcpi_data_segs_in);
+}
+
+int dataSegments(bool cork)
+{
+  TcpServer server(g_loop, g_serverAddr, cork ? "Corked" : "Uncorked");
+  server.setConnectionCallback(std::bind(onServerConnection, cork, _1));
+  server.start();
+  int segments = 0;
+  Thread client([&segments]() { segments = runClient(); }, "AutoCorkClient");
+  client.start();
+  TimerId timeout = g_loop->runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  g_loop->loop();
+  g_loop->cancel(timeout);
+  client.join();
+  return segments;
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  int uncorked = dataSegments(false);
+  int corked = dataSegments(true);
+  printf("%d sends of %zd bytes: %d data segments, %d with auto cork\n",
+         kSends, kSendSize, uncorked, corked);
+  // one write, within one loopback MSS
+  assert(corked == 1);
+  assert(uncorked > corked);
+}
@@ -0,0 +1,245 @@
+// Slow consumer policy: a client that stops reading gets its oldest
+// messages dropped, or gets disconnected. Dropping must leave alone what
+// a Transport has taken already.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/Transport.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kMessageSize = 4096;
+const int kMessages = 16384;  // 64MiB, more than the socket buffers hold
+const size_t kMaxBacklog = 1024 * 1024;
+
+EventLoop* g_loop;
+TcpServer* g_server;
+size_t g_maxBacklog = 0;
+int g_received = 0;
+int g_lastSeq = -1;
+bool g_disconnected = false;
+
+// sizes vary, so a stream that lost or repeated bytes doesn't line up
+size_t messageSize(int seq)
+{
+  return kMessageSize + static_cast<size_t>(seq % 13);
+}
+
+string makeMessage(int seq)
+{
+  string message(messageSize(seq), static_cast<char>('a' + seq % 26));
+  char header[16];
+  snprintf(header, sizeof header, "%08d", seq);
+  message.replace(0, 8, header);
+  return message;
+}
+
+void sendAll(const TcpConnectionPtr& conn)
+{
+  for (int seq = 0; seq < kMessages && conn->connected(); ++seq)
+  {
+    conn->send(makeMessage(seq));
+    g_maxBacklog = std::max(g_maxBacklog, conn->outputBuffer()->readableBytes());
+  }
+}
+
+// the client
+
+void onClientMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  while (buf->readableBytes() >= 8)
+  {
+    int seq = atoi(string(buf->peek(), 8).c_str());
+    assert(seq > g_lastSeq && seq <= kMessages);
+    if (buf->readableBytes() < messageSize(seq))
+    {
+      break;
+    }
+    string message = buf->retrieveAsString(messageSize(seq));
+    assert(message == makeMessage(seq));
+    g_lastSeq = seq;
+    ++g_received;
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->stopRead();
+    g_loop->runAfter(0.5, [conn]() { conn->startRead(); });
+  }
+  else
+  {
+    g_disconnected = true;
+  }
+}
+
+// holds what it was given until the socket takes it all, and only then
+// reports it written, like TlsTransport or CompressionTransport
+class HoldingTransport : public Transport
+{
+ public:
+  HoldingTransport() : unacked_(0) { }
+
+  HandshakeState handshake(int) override { return kHandshakeDone; }
+
+  ssize_t read(int sockfd, Buffer* buf, int* savedErrno) override
+  {
+    return buf->readFd(sockfd, savedErrno);
+  }
+
+  ssize_t write(int sockfd, const void* data, size_t len) override
+  {
+    if (unacked_ == 0)
+    {
+      unacked_ = std::min(len, static_cast<size_t>(64 * 1024));
+      held_.append(static_cast<const char*>(data), unacked_);
+    }
+    while (held_.readableBytes() > 0)
+    {
+      ssize_t n = ::write(sockfd, held_.peek(), held_.readableBytes());
+      if (n < 0)
+      {
+        return -1;
+      }
+      held_.retrieve(static_cast<size_t>(n));
+    }
+    size_t n = std::min(unacked_, len);
+    unacked_ -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+  void shutdown(int) override { }
+
+ private:
+  Buffer held_;
+  size_t unacked_;
+};
+
+// drop oldest
+
+void onDropConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    sendAll(conn);
+    conn->shutdown();
+  }
+}
+
+void checkDropped()
+{
+  BacklogStats& stats = *g_server->backlogStats();
+  LOG_INFO << "received " << g_received << " dropped " << stats.droppedMessages.get()
+           << " max backlog " << g_maxBacklog;
+  assert(g_disconnected);
+  assert(stats.droppedMessages.get() > 0);
+  assert(stats.droppedBytes.get() >=
+         stats.droppedMessages.get() * static_cast<int64_t>(kMessageSize));
+  assert(g_received + stats.droppedMessages.get() == kMessages);
+  assert(g_lastSeq == kMessages - 1);
+  assert(g_maxBacklog <= kMaxBacklog);
+  assert(stats.disconnects.get() == 0);
+  g_loop->quit();
+}
+
+// disconnect on age
+
+void onAgedConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    sendAll(conn);
+    g_loop->runAfter(0.3, [conn]() { conn->send(makeMessage(kMessages)); });
+  }
+}
+
+void checkDisconnected()
+{
+  BacklogStats& stats = *g_server->backlogStats();
+  LOG_INFO << "received " << g_received << " disconnects " << stats.disconnects.get();
+  assert(stats.disconnects.get() == 1);
+  assert(stats.droppedMessages.get() == 0);
+  assert(g_disconnected);
+  assert(g_server->numConnections() == 0);
+  g_loop->quit();
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+
+  {
+    InetAddress addr(2026, true);
+    TcpServer server(&loop, addr, "Drop");
+    g_server = &server;
+    BacklogPolicy policy;
+    policy.maxBytes = kMaxBacklog;
+    policy.action = BacklogPolicy::kDropOldest;
+    server.setBacklogPolicy(policy);
+    server.setConnectionCallback(onDropConnection);
+    server.start();
+    TcpClient client(&loop, addr, "DropClient");
+    client.setConnectionCallback(onClientConnection);
+    client.setMessageCallback(onClientMessage);
+    client.connect();
+    loop.runAfter(3.0, checkDropped);
+    loop.loop();
+  }
+
+  g_received = 0;
+  g_lastSeq = -1;
+  g_maxBacklog = 0;
+  g_disconnected = false;
+  {
+    InetAddress addr(2033, true);
+    TcpServer server(&loop, addr, "DropTransport");
+    g_server = &server;
+    BacklogPolicy policy;
+    policy.maxBytes = kMaxBacklog;
+    policy.action = BacklogPolicy::kDropOldest;
+    server.setBacklogPolicy(policy);
+    server.setTransportFactory(
+        []() { return std::unique_ptr<Transport>(new HoldingTransport); });
+    server.setConnectionCallback(onDropConnection);
+    server.start();
+    TcpClient client(&loop, addr, "DropTransportClient");
+    client.setConnectionCallback(onClientConnection);
+    client.setMessageCallback(onClientMessage);
+    client.connect();
+    loop.runAfter(3.0, checkDropped);
+    loop.loop();
+  }
+
+  g_received = 0;
+  g_lastSeq = -1;
+  g_disconnected = false;
+  {
+    InetAddress addr(2027, true);
+    TcpServer server(&loop, addr, "Aged");
+    g_server = &server;
+    BacklogPolicy policy;
+    policy.maxAge = 0.2;
+    server.setBacklogPolicy(policy);
+    server.setConnectionCallback(onAgedConnection);
+    server.start();
+    TcpClient client(&loop, addr, "AgedClient");
+    client.setConnectionCallback(onClientConnection);
+    client.setMessageCallback(onClientMessage);
+    client.connect();
+    loop.runAfter(1.5, checkDisconnected);
+    loop.loop();
+  }
+}
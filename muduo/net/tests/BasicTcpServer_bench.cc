@@ -0,0 +1,153 @@
+// Ping pong echo, TcpServer vs. BasicTcpServer with the same handler.
+// The clients are plain TcpClients in the same loop, so the difference
+// is the server side dispatch. Small messages make it show.
+
+#include "muduo/net/BasicTcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const InetAddress g_serverAddr(2032, true);
+EventLoop* g_loop;
+double g_seconds;
+int g_connections;
+string g_message;
+int64_t g_messages;
+bool g_stopping;
+int g_down;
+Timestamp g_start;
+Timestamp g_stop;
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->setTcpNoDelay(true);
+  }
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+struct PingPongHandler : BasicHandler
+{
+  typedef BasicTcpConnection<PingPongHandler> Connection;
+
+  void onConnection(Connection& conn)
+  {
+    if (conn.connected())
+    {
+      conn.setTcpNoDelay(true);
+    }
+  }
+
+  void onMessage(Connection& conn, Buffer* buf, Timestamp)
+  {
+    conn.send(buf);
+  }
+};
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->setTcpNoDelay(true);
+    conn->send(g_message);
+  }
+  else if (++g_down == g_connections)
+  {
+    g_loop->quit();
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  // one message in flight per connection
+  if (buf->readableBytes() >= g_message.size())
+  {
+    buf->retrieve(g_message.size());
+    if (!g_stopping)
+    {
+      ++g_messages;
+      conn->send(g_message);
+    }
+  }
+}
+
+void stop()
+{
+  g_stop = Timestamp::now();
+  g_stopping = true;
+  for (const auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+}
+
+// with the server in place, on g_loop
+void runClients(const char* name)
+{
+  g_messages = 0;
+  g_stopping = false;
+  g_down = 0;
+  for (int i = 0; i < g_connections; ++i)
+  {
+    g_clients.emplace_back(new TcpClient(g_loop, g_serverAddr, "PingPongClient"));
+    g_clients.back()->setConnectionCallback(onClientConnection);
+    g_clients.back()->setMessageCallback(onClientMessage);
+    g_clients.back()->connect();
+  }
+  g_start = Timestamp::now();
+  g_loop->runAfter(g_seconds, stop);
+  g_loop->loop();
+  g_clients.clear();
+
+  double seconds = timeDifference(g_stop, g_start);
+  printf("%-16s %10.0f messages/s %8.1f ns/message %" PRId64 " messages\n", name,
+         static_cast<double>(g_messages) / seconds,
+         seconds * 1e9 / static_cast<double>(g_messages), g_messages);
+}
+
+int main(int argc, char* argv[])
+{
+  g_seconds = argc > 1 ? atof(argv[1]) : 2.0;
+  g_connections = argc > 2 ? atoi(argv[2]) : 10;
+  size_t blockSize = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 16;
+  int threads = argc > 4 ? atoi(argv[4]) : 0;
+  Logger::setLogLevel(Logger::WARN);
+  g_message.assign(blockSize, 'x');
+  printf("%d connections, %zd bytes, %d server threads, %.1f seconds each\n",
+         g_connections, blockSize, threads, g_seconds);
+
+  {
+    EventLoop loop;
+    g_loop = &loop;
+    TcpServer server(&loop, g_serverAddr, "PingPong");
+    server.setConnectionCallback(onServerConnection);
+    server.setMessageCallback(onServerMessage);
+    server.setThreadNum(threads);
+    server.start();
+    runClients("TcpServer");
+  }
+
+  {
+    EventLoop loop;
+    g_loop = &loop;
+    BasicTcpServer<PingPongHandler> server(&loop, g_serverAddr, "BasicPingPong");
+    server.setThreadNum(threads);
+    server.start();
+    runClients("BasicTcpServer");
+  }
+}
@@ -0,0 +1,155 @@
+// BasicTcpServer with a thread pool: handler hooks, per-connection State,
+// and a send() from another thread, against plain TcpClients.
+
+#include "muduo/net/BasicTcpServer.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kBanner[] = "hello\n";
+const int kClients = 4;
+const int kRounds = 10;
+const size_t kMessageSize = 1000;
+
+EventLoop* g_loop;
+InetAddress g_serverAddr(2031, true);
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+int g_clientsDown = 0;
+
+class EchoHandler : public BasicHandler
+{
+ public:
+  typedef BasicTcpConnection<EchoHandler> Connection;
+
+  struct State
+  {
+    State() : messages(0), bytes(0) { }
+    int messages;
+    size_t bytes;
+  };
+
+  static const bool kWriteComplete = true;
+
+  void onConnection(Connection& conn)
+  {
+    if (conn.connected())
+    {
+      assert(conn.context().bytes == 0);
+      up_.increment();
+      // from the base loop, not the IO thread of conn
+      std::shared_ptr<Connection> guard(conn.shared_from_this());
+      g_loop->runInLoop([guard]() { guard->send(kBanner); });
+    }
+    else
+    {
+      assert(conn.context().bytes == kRounds * kMessageSize);
+      assert(conn.context().messages >= kRounds);
+      down_.increment();
+    }
+  }
+
+  void onMessage(Connection& conn, Buffer* buf, Timestamp)
+  {
+    ++conn.context().messages;
+    conn.context().bytes += buf->readableBytes();
+    conn.send(buf);
+  }
+
+  void onWriteComplete(Connection&)
+  {
+    writeCompletes_.increment();
+  }
+
+  int up() { return up_.get(); }
+  int down() { return down_.get(); }
+  int writeCompletes() { return writeCompletes_.get(); }
+
+ private:
+  AtomicInt32 up_;
+  AtomicInt32 down_;
+  AtomicInt32 writeCompletes_;
+};
+
+BasicTcpServer<EchoHandler>* g_server;
+
+void sendRound(const TcpConnectionPtr& conn, int round)
+{
+  conn->setContext(round);
+  conn->send(string(kMessageSize, static_cast<char>('a' + round)));
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->disconnected() && ++g_clientsDown == kClients)
+  {
+    // the server side went down first
+    assert(g_server->handler().up() == kClients);
+    assert(g_server->handler().down() == kClients);
+    assert(g_server->handler().writeCompletes() >= kClients);
+    assert(g_server->numConnections() == 0);
+    g_loop->quit();
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (conn->getContext().empty())
+  {
+    if (buf->readableBytes() < sizeof kBanner - 1)
+    {
+      return;
+    }
+    string banner = buf->retrieveAsString(sizeof kBanner - 1);
+    assert(banner == kBanner);
+    (void) banner;
+    assert(buf->readableBytes() == 0);
+    sendRound(conn, 0);
+    return;
+  }
+
+  if (buf->readableBytes() < kMessageSize)
+  {
+    return;
+  }
+  int round = boost::any_cast<int>(conn->getContext());
+  string message = buf->retrieveAsString(kMessageSize);
+  assert(message == string(kMessageSize, static_cast<char>('a' + round)));
+  (void) message;
+  if (round + 1 < kRounds)
+  {
+    sendRound(conn, round + 1);
+  }
+  else
+  {
+    conn->shutdown();
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+
+  BasicTcpServer<EchoHandler> server(&loop, g_serverAddr, "BasicEcho");
+  g_server = &server;
+  server.setThreadNum(2);
+  server.start();
+
+  for (int i = 0; i < kClients; ++i)
+  {
+    g_clients.emplace_back(new TcpClient(&loop, g_serverAddr, "BasicEchoClient"));
+    g_clients.back()->setConnectionCallback(onClientConnection);
+    g_clients.back()->setMessageCallback(onClientMessage);
+    g_clients.back()->connect();
+  }
+  loop.runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+  g_clients.clear();
+}
@@ -117,6 +117,27 @@ BOOST_AUTO_TEST_CASE(testBufferPrepend)
   BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend - 4);
 }
 
+BOOST_AUTO_TEST_CASE(testBufferErase)
+{
+  Buffer buf;
+  buf.append("0123456789");
+  buf.retrieve(1);
+  // closer to the front
+  buf.erase(1, 2);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 7);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend + 3);
+  BOOST_CHECK_EQUAL(string(buf.peek(), buf.readableBytes()), "1456789");
+
+  // closer to the back
+  buf.erase(4, 2);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 5);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend + 3);
+  BOOST_CHECK_EQUAL(string(buf.peek(), buf.readableBytes()), "14569");
+
+  buf.erase(0, 5);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+}
+
 BOOST_AUTO_TEST_CASE(testBufferReadInt)
 {
   Buffer buf;
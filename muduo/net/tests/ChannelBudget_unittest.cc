@@ -0,0 +1,168 @@
+// Fairness budgets: high priority channels go first, a channel that ran
+// over its time budget goes last, and a connection reads a bounded amount
+// per iteration.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kReadBudget = 4096;
+const size_t kTotal = 64 * 1024;
+
+EventLoop* g_loop;
+std::vector<char> g_order;
+std::vector<int64_t> g_iterations;
+size_t g_maxRead = 0;
+size_t g_received = 0;
+int g_reads = 0;
+
+int makeReadable()
+{
+  int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+  assert(fd >= 0);
+  return fd;
+}
+
+void drain(int fd)
+{
+  uint64_t one = 0;
+  ssize_t n = ::read(fd, &one, sizeof one);
+  (void)n;
+}
+
+// priority and time budget
+
+void onReadable(char name, int fd)
+{
+  bool first = std::find(g_order.begin(), g_order.end(), name) == g_order.end();
+  g_order.push_back(name);
+  g_iterations.push_back(g_loop->iteration());
+  if (name == 'A' && first)
+  {
+    // over budget, and still readable
+    ::usleep(5 * 1000);
+    return;
+  }
+  drain(fd);
+  if (name == 'C' && first)
+  {
+    // readable again in the next iteration
+    uint64_t one = 1;
+    ssize_t n = ::write(fd, &one, sizeof one);
+    (void)n;
+  }
+  if (g_order.size() == 5)
+  {
+    g_loop->quit();
+  }
+}
+
+void testOrder(EventLoop& loop)
+{
+  loop.setChannelBudget(0, 0.001);
+
+  int fds[3] = { makeReadable(), makeReadable(), makeReadable() };
+  Channel a(&loop, fds[0]);
+  Channel b(&loop, fds[1]);
+  Channel c(&loop, fds[2]);
+  a.setReadCallback(std::bind(onReadable, 'A', fds[0]));
+  b.setReadCallback(std::bind(onReadable, 'B', fds[1]));
+  c.setReadCallback(std::bind(onReadable, 'C', fds[2]));
+  b.setHighPriority(true);
+  a.enableReading();
+  b.enableReading();
+  c.enableReading();
+  TimerId timeout = loop.runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+  loop.cancel(timeout);
+
+  string order(g_order.begin(), g_order.end());
+  LOG_INFO << "order " << order << " over budget " << loop.overBudgetCount();
+  assert(order == "BACCA");
+  assert(g_iterations[0] == g_iterations[2]);
+  assert(g_iterations[3] == g_iterations[4] && g_iterations[3] == g_iterations[0] + 1);
+  assert(!a.overBudget());
+  assert(loop.overBudgetCount() == 1);
+
+  for (Channel* channel : { &a, &b, &c })
+  {
+    channel->disableAll();
+    channel->remove();
+  }
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+}
+
+// read budget
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  size_t n = buf->readableBytes();
+  g_maxRead = std::max(g_maxRead, n);
+  g_received += n;
+  ++g_reads;
+  buf->retrieveAll();
+  if (g_received == kTotal)
+  {
+    conn->shutdown();
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send(string(kTotal, 'x'));
+  }
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (!conn->connected())
+  {
+    g_loop->quit();
+  }
+}
+
+void testReadBudget(EventLoop& loop)
+{
+  loop.setChannelBudget(kReadBudget, 0);
+  InetAddress addr(2028, true);
+  TcpServer server(&loop, addr, "Budget");
+  server.setConnectionCallback(onServerConnection);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+  TcpClient client(&loop, addr, "BudgetClient");
+  client.setConnectionCallback(onClientConnection);
+  client.connect();
+  TimerId timeout = loop.runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+  loop.cancel(timeout);
+
+  LOG_INFO << "received " << g_received << " in " << g_reads << " reads, at most " << g_maxRead;
+  assert(g_received == kTotal);
+  assert(g_maxRead <= kReadBudget);
+  assert(g_reads >= static_cast<int>(kTotal / kReadBudget));
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  testOrder(loop);
+  testReadBudget(loop);
+}
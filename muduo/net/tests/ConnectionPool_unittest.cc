@@ -0,0 +1,104 @@
+#include "muduo/net/ConnectionPool.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpServer.h"
+
+#include <set>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kConnections = 4;
+bool g_ignoreProbes = false;
+EventLoop* g_loop;
+std::unique_ptr<ConnectionPool> g_pool;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  string msg(buf->retrieveAllAsString());
+  if (!g_ignoreProbes || msg != "ping\n")
+  {
+    conn->send(msg);
+  }
+}
+
+void sendProbe(const TcpConnectionPtr& conn)
+{
+  conn->send("ping\n");
+}
+
+void checkProbeFailures()
+{
+  const ConnectionPool::Stats& stats = g_pool->stats();
+  LOG_INFO << "probes " << stats.probes << " failures " << stats.probeFailures
+           << " connects " << stats.connects << " disconnects " << stats.disconnects;
+  if (stats.probeFailures < kConnections || stats.connects < 2 * kConnections)
+  {
+    LOG_ERROR << "unhealthy connections were not replaced";
+    abort();
+  }
+  // let the connections close before the loop goes away
+  g_pool.reset();
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+}
+
+void checkLeastBusy()
+{
+  if (g_pool->numConnected() != kConnections)
+  {
+    g_loop->runAfter(0.1, checkLeastBusy);
+    return;
+  }
+
+  std::set<TcpConnection*> seen;
+  std::vector<TcpConnectionPtr> busy;
+  for (int i = 0; i < kConnections; ++i)
+  {
+    TcpConnectionPtr conn = g_pool->checkout();
+    assert(conn);
+    conn->incInFlight();
+    seen.insert(get_pointer(conn));
+    busy.push_back(conn);
+  }
+  if (static_cast<int>(seen.size()) != kConnections)
+  {
+    LOG_ERROR << "checkout() did not pick the least busy connection";
+    abort();
+  }
+  for (const TcpConnectionPtr& conn : busy)
+  {
+    conn->decInFlight();
+  }
+  LOG_INFO << "least busy checkout ok";
+
+  g_ignoreProbes = true;
+  g_loop->runAfter(1.5, checkProbeFailures);
+}
+
+void timeout()
+{
+  LOG_ERROR << "timeout";
+  abort();
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress serverAddr(2010, true);
+  TcpServer server(&loop, serverAddr, "PoolServer");
+  server.setMessageCallback(onServerMessage);
+  server.start();
+
+  g_pool.reset(new ConnectionPool(&loop, serverAddr, "Pool", kConnections));
+  g_pool->setHealthCheck(0.2, sendProbe);
+  g_pool->start();
+
+  loop.runAfter(0.1, checkLeastBusy);
+  loop.runAfter(10.0, timeout);
+  loop.loop();
+}
@@ -0,0 +1,82 @@
+// Interest changes are coalesced into one epoll_ctl() per poll.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_pipe[2];
+EventLoop* g_loop;
+int g_reads = 0;
+
+void onReadable(Channel* channel, Timestamp)
+{
+  char buf[16];
+  ssize_t n = ::read(g_pipe[0], buf, sizeof buf);
+  assert(n == 1);
+  (void) n;
+  ++g_reads;
+  // readable and writable toggled back and forth, nothing reaches the kernel
+  int64_t avoided = g_loop->interestUpdatesAvoided();
+  for (int i = 0; i < 10; ++i)
+  {
+    channel->enableWriting();
+    channel->disableWriting();
+  }
+  channel->disableReading();
+  channel->enableReading();
+  LOG_INFO << "avoided " << g_loop->interestUpdatesAvoided() - avoided << " before the next poll";
+  if (g_reads < 3)
+  {
+    n = ::write(g_pipe[1], "x", 1);
+    assert(n == 1);
+  }
+  else
+  {
+    g_loop->quit();
+  }
+}
+
+int main()
+{
+  if (getenv("MUDUO_USE_POLL"))
+  {
+    printf("EPollPoller only\n");
+    return 0;
+  }
+  int ret = ::pipe(g_pipe);
+  assert(ret == 0);
+  (void) ret;
+  EventLoop loop;
+  g_loop = &loop;
+  Channel channel(&loop, g_pipe[0]);
+  channel.setReadCallback(std::bind(onReadable, &channel, _1));
+
+  int64_t before = loop.interestUpdatesAvoided();
+  channel.enableReading();
+  channel.enableWriting();
+  channel.disableWriting();
+  assert(loop.interestUpdatesAvoided() - before == 3);
+
+  ssize_t n = ::write(g_pipe[1], "x", 1);
+  assert(n == 1);
+  (void) n;
+  loop.loop();
+
+  // 3 + 3 * 22 changes, one EPOLL_CTL_ADD for all of them
+  assert(g_reads == 3);
+  LOG_INFO << "interest updates avoided " << loop.interestUpdatesAvoided();
+  assert(loop.interestUpdatesAvoided() == 3 + 3 * 22 - 1);
+
+  channel.disableAll();
+  channel.remove();
+  ::close(g_pipe[0]);
+  ::close(g_pipe[1]);
+}
@@ -0,0 +1,113 @@
+// TCP Fast Open: the client sends in its connection callback, before the
+// handshake, and the request rides in the SYN once it has a cookie.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 3;
+
+EventLoop* g_loop;
+TcpServer* g_server;
+InetAddress g_serverAddr(2025, true);
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+int g_echoed = 0;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+void finish()
+{
+  int sysctl = 0;
+  FILE* fp = ::fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+  if (fp)
+  {
+    if (::fscanf(fp, "%d", &sysctl) != 1)
+    {
+      sysctl = 0;
+    }
+    ::fclose(fp);
+  }
+  int64_t hits = 0;
+  int64_t misses = 0;
+  for (auto& client : g_clients)
+  {
+    hits += client->fastOpenHits();
+    misses += client->fastOpenMisses();
+  }
+  LOG_INFO << "net.ipv4.tcp_fastopen " << sysctl << " hits " << hits
+           << " misses " << misses << " server " << g_server->fastOpenConnections();
+  assert(g_echoed == kRounds);
+  assert(hits + misses == kRounds);
+  assert(g_server->fastOpenConnections() == hits);
+  if ((sysctl & 3) == 3)
+  {
+    // the first connection got the cookie, unless an earlier run did
+    assert(hits >= kRounds - 1);
+  }
+  g_loop->quit();
+}
+
+void newClient();
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // before the handshake, this goes in the SYN
+    conn->send("hello");
+  }
+  else
+  {
+    // TcpClient counts after this callback
+    g_loop->queueInLoop(static_cast<int>(g_clients.size()) < kRounds ? newClient : finish);
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (buf->readableBytes() >= 5)
+  {
+    string message = buf->retrieveAllAsString();
+    assert(message == "hello");
+    (void) message;
+    ++g_echoed;
+    conn->shutdown();
+  }
+}
+
+void newClient()
+{
+  char name[32];
+  snprintf(name, sizeof name, "client%zu", g_clients.size());
+  g_clients.emplace_back(new TcpClient(g_loop, g_serverAddr, name));
+  TcpClient* client = g_clients.back().get();
+  client->setFastOpen(true);
+  client->setConnectionCallback(onClientConnection);
+  client->setMessageCallback(onClientMessage);
+  client->connect();
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  TcpServer server(&loop, g_serverAddr, "FastOpen");
+  g_server = &server;
+  server.setFastOpen(16);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+  loop.runInLoop(newClient);
+  loop.runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+  g_clients.clear();
+}
@@ -0,0 +1,107 @@
+// Allocations per cross-thread EventLoop::runInLoop(), EventLoop::Functor
+// vs. the same bind boxed in a std::function.
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <atomic>
+#include <functional>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+class Sink
+{
+ public:
+  Sink() : bytes_(0) { }
+  void consume(const string& message) { bytes_ += message.size(); }
+  void consumeRef(int64_t* counter) { ++*counter; }
+  size_t bytes() const { return bytes_; }
+
+ private:
+  size_t bytes_;
+};
+
+const int kBatch = 1000;
+
+// runs in the loop thread, releases the producer once a batch has run
+void done(CountDownLatch* latch)
+{
+  latch->countDown();
+}
+
+template<typename Make>
+void bench(const char* name, EventLoop* loop, int rounds, Make make)
+{
+  int64_t before = g_allocations.load();
+  Timestamp start(Timestamp::now());
+  for (int r = 0; r < rounds; ++r)
+  {
+    CountDownLatch latch(1);
+    for (int i = 0; i < kBatch; ++i)
+    {
+      loop->runInLoop(make());
+    }
+    loop->runInLoop(std::bind(done, &latch));
+    latch.wait();
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  int64_t allocations = g_allocations.load() - before;
+  int64_t ops = static_cast<int64_t>(rounds) * kBatch;
+  printf("%-44s %6.2f allocations/op %8.1f ns/op\n", name,
+         static_cast<double>(allocations) / static_cast<double>(ops),
+         seconds * 1e9 / static_cast<double>(ops));
+}
+
+int main(int argc, char* argv[])
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+  EventLoopThread thread;
+  EventLoop* loop = thread.startLoop();
+  Sink sink;
+  int64_t counter = 0;
+  void (Sink::*consume)(const string&) = &Sink::consume;
+  const string message(15, 'x');  // fits SSO, copying it doesn't allocate
+
+  // warm up pendingFunctors_
+  bench("warm up", loop, rounds / 10 + 1, [&]() { return std::bind(&Sink::consumeRef, &sink, &counter); });
+
+  bench("Functor(bind(member, this, ptr))", loop, rounds,
+        [&]() { return std::bind(&Sink::consumeRef, &sink, &counter); });
+  bench("std::function(bind(member, this, ptr))", loop, rounds,
+        [&]() { return std::function<void()>(std::bind(&Sink::consumeRef, &sink, &counter)); });
+  bench("Functor(bind(member, this, string))", loop, rounds,
+        [&]() { return std::bind(consume, &sink, message); });
+  bench("std::function(bind(member, this, string))", loop, rounds,
+        [&]() { return std::function<void()>(std::bind(consume, &sink, message)); });
+  printf("%zd bytes, %" PRId64 " calls\n", sink.bytes(), counter);
+}
@@ -56,6 +56,27 @@ BOOST_AUTO_TEST_CASE(testInet6Address)
   BOOST_CHECK_EQUAL(addr3.port(), 8888);
 }
 
+BOOST_AUTO_TEST_CASE(testUnixAddress)
+{
+  InetAddress addr0 = InetAddress::unixDomain("/tmp/muduo.sock");
+  BOOST_CHECK(addr0.isUnixDomain());
+  BOOST_CHECK_EQUAL(addr0.toIp(), string("/tmp/muduo.sock"));
+  BOOST_CHECK_EQUAL(addr0.toIpPort(), string("/tmp/muduo.sock"));
+  BOOST_CHECK_EQUAL(addr0.port(), 0);
+  BOOST_CHECK_EQUAL(addr0.getSockAddrLen(),
+                    offsetof(struct sockaddr_un, sun_path) + strlen("/tmp/muduo.sock"));
+
+  InetAddress addr1 = InetAddress::unixDomain("@muduo");
+  BOOST_CHECK(addr1.isUnixDomain());
+  BOOST_CHECK_EQUAL(addr1.toIpPort(), string("@muduo"));
+  BOOST_CHECK_EQUAL(addr1.getSockAddrLen(),
+                    offsetof(struct sockaddr_un, sun_path) + strlen("@muduo"));
+
+  InetAddress addr2(1234);
+  BOOST_CHECK(!addr2.isUnixDomain());
+  BOOST_CHECK_EQUAL(addr2.getSockAddrLen(), sizeof(struct sockaddr_in));
+}
+
 BOOST_AUTO_TEST_CASE(testInetAddressResolve)
 {
   InetAddress addr(80);
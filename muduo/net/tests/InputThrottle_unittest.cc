@@ -0,0 +1,216 @@
+// Input-side backpressure: reading pauses at the byte and in-flight high
+// marks and resumes at the low marks, input retrieved outside the message
+// callback resumes it with resumeReadIfBelowLowMark(), and a message larger
+// than the byte mark gets through once the marks are raised for it.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kHighMark = 4096;
+const size_t kLowMark = 1024;
+const int kHighInFlight = 4;
+const int kLowInFlight = 1;
+
+EventLoop* g_loop;
+InetAddress g_serverAddr(2036, true);
+std::unique_ptr<TcpClient> g_client;
+
+// sends @c data, the server shuts down once it has taken all of it
+void runClient(const string& data)
+{
+  g_client.reset(new TcpClient(g_loop, g_serverAddr, "InputThrottleClient"));
+  g_client->setConnectionCallback([data](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send(data);
+    }
+    else
+    {
+      g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+    }
+  });
+  g_client->connect();
+  TimerId timeout = g_loop->runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  g_loop->loop();
+  g_loop->cancel(timeout);
+  g_client.reset();
+}
+
+// deferred processing, a timer retrieves a little at a time
+
+const size_t kDeferredBytes = 256 * 1024;
+TcpConnectionPtr g_deferred;
+size_t g_processed = 0;
+size_t g_maxUnprocessed = 0;
+
+void processSome()
+{
+  if (!g_deferred)
+  {
+    return;
+  }
+  Buffer* buf = g_deferred->inputBuffer();
+  g_maxUnprocessed = std::max(g_maxUnprocessed, buf->readableBytes());
+  size_t n = std::min(buf->readableBytes(), kLowMark);
+  buf->retrieve(n);
+  g_processed += n;
+  if (g_processed == kDeferredBytes)
+  {
+    g_deferred->shutdown();
+    g_deferred.reset();
+  }
+  else
+  {
+    g_deferred->resumeReadIfBelowLowMark();
+  }
+}
+
+void testDeferred()
+{
+  TcpServer server(g_loop, g_serverAddr, "Deferred");
+  server.setConnectionCallback([](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setInputWaterMark(kHighMark, kLowMark);
+      g_deferred = conn;
+    }
+  });
+  // leaves everything for processSome()
+  server.setMessageCallback([](const TcpConnectionPtr&, Buffer*, Timestamp) { });
+  server.start();
+  TimerId timer = g_loop->runEvery(0.001, processSome);
+  runClient(string(kDeferredBytes, 'd'));
+  g_loop->cancel(timer);
+
+  printf("deferred: %zd bytes, at most %zd unprocessed\n", g_processed, g_maxUnprocessed);
+  assert(g_processed == kDeferredBytes);
+  // paused at the mark, not read all at once
+  assert(g_maxUnprocessed >= kHighMark);
+  assert(g_maxUnprocessed < kDeferredBytes / 2);
+}
+
+// requests handed to another thread, which finishes them later
+
+const size_t kRequestSize = 100;
+const int kRequests = 200;
+int g_requests = 0;
+int g_done = 0;
+int g_maxInFlight = 0;
+
+void finish(const TcpConnectionPtr& conn)
+{
+  if (++g_done == kRequests)
+  {
+    conn->shutdown();
+  }
+}
+
+void testInFlight()
+{
+  EventLoopThread workerThread;
+  EventLoop* worker = workerThread.startLoop();
+  TcpServer server(g_loop, g_serverAddr, "InFlight");
+  server.setConnectionCallback([](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setInFlightWaterMark(kHighInFlight, kLowInFlight);
+    }
+  });
+  server.setMessageCallback([worker](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    // leaves the rest for the resume once paused
+    while (buf->readableBytes() >= kRequestSize && conn->inFlight() < kHighInFlight)
+    {
+      buf->retrieve(kRequestSize);
+      ++g_requests;
+      conn->incInFlight();
+      g_maxInFlight = std::max(g_maxInFlight, conn->inFlight());
+      worker->runAfter(0.001, [conn]()
+      {
+        conn->decInFlight();
+        conn->getLoop()->queueInLoop(std::bind(finish, conn));
+      });
+    }
+  });
+  server.start();
+  runClient(string(kRequests * kRequestSize, 'r'));
+
+  printf("in flight: %d requests, at most %d in flight\n", g_done, g_maxInFlight);
+  assert(g_requests == kRequests);
+  assert(g_done == kRequests);
+  assert(g_maxInFlight <= kHighInFlight);
+}
+
+// length-prefixed frames larger than the byte mark
+
+const size_t kFrameSize = 32 * 1024;
+const int kFrames = 3;
+int g_frames = 0;
+
+void onFrameMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  while (buf->readableBytes() >= sizeof(int32_t))
+  {
+    size_t frame = sizeof(int32_t) + static_cast<size_t>(buf->peekInt32());
+    if (buf->readableBytes() < frame)
+    {
+      // room for the whole frame, or reading pauses halfway for good
+      if (frame >= kHighMark)
+      {
+        conn->setInputWaterMark(2 * frame, frame);
+      }
+      break;
+    }
+    buf->retrieve(frame);
+    if (++g_frames == kFrames)
+    {
+      conn->shutdown();
+    }
+  }
+}
+
+void testOversized()
+{
+  TcpServer server(g_loop, g_serverAddr, "Oversized");
+  server.setConnectionCallback([](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setInputWaterMark(kHighMark, kLowMark);
+    }
+  });
+  server.setMessageCallback(onFrameMessage);
+  server.start();
+
+  Buffer frames;
+  for (int i = 0; i < kFrames; ++i)
+  {
+    frames.appendInt32(static_cast<int32_t>(kFrameSize));
+    frames.append(string(kFrameSize, static_cast<char>('a' + i)));
+  }
+  runClient(frames.retrieveAllAsString());
+
+  printf("oversized: %d frames of %zd bytes\n", g_frames, kFrameSize);
+  assert(g_frames == kFrames);
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  testDeferred();
+  testInFlight();
+  testOversized();
+}
@@ -0,0 +1,77 @@
+// Kernel receive timestamps include the time data waits in the socket.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kStallUs = 100 * 1000;
+
+EventLoop* g_loop;
+TcpClient* g_client;
+Timestamp g_sent;
+int g_messages = 0;
+
+void sendAndStall(const TcpConnectionPtr& conn)
+{
+  g_sent = Timestamp::now();
+  conn->send("hello");
+  // the data waits in the server's socket until the loop polls again
+  ::usleep(kStallUs);
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+  buf->retrieveAll();
+  Timestamp polled = g_loop->pollReturnTime();
+  double queued = timeDifference(polled, receiveTime);
+  LOG_INFO << "message " << g_messages << " queued in socket " << queued * 1e6 << " us";
+  if (g_messages++ == 0)
+  {
+    assert(receiveTime.microSecondsSinceEpoch() >= g_sent.microSecondsSinceEpoch());
+    assert(queued * 1e6 >= kStallUs * 0.9);
+    conn->setKernelReceiveTime(false);
+    sendAndStall(g_client->connection());
+  }
+  else
+  {
+    assert(receiveTime == polled);
+    g_client->disconnect();
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    sendAndStall(conn);
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress listenAddr(2014);
+  TcpServer server(&loop, listenAddr, "KernelReceiveTime");
+  server.setKernelReceiveTime(true);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+
+  TcpClient client(&loop, listenAddr, "client");
+  g_client = &client;
+  client.setConnectionCallback(onClientConnection);
+  // the kernel turns on receive timestamping asynchronously, when the first
+  // socket asks for it, packets before that carry no time
+  loop.runAfter(0.05, std::bind(&TcpClient::connect, &client));
+  loop.loop();
+  assert(g_messages == 2);
+}
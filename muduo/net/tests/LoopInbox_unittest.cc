@@ -0,0 +1,110 @@
+// LoopInbox and runInLoopBatch keep order and coalesce wakeups.
+
+#include "muduo/net/LoopInbox.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kMessages = 1000 * 1000;
+
+// touched in the loop thread only
+int64_t g_expected = 0;
+
+void consume(int64_t seq)
+{
+  assert(seq == g_expected);
+  ++g_expected;
+}
+
+void testInbox(EventLoop* loop, size_t capacity)
+{
+  g_expected = 0;
+  LoopInbox inbox(loop, capacity);
+  Timestamp start(Timestamp::now());
+  for (int64_t i = 0; i < kMessages; ++i)
+  {
+    inbox.post(std::bind(consume, i));
+  }
+  CountDownLatch latch(1);
+  inbox.post(std::bind(&CountDownLatch::countDown, &latch));
+  latch.wait();
+  double seconds = timeDifference(Timestamp::now(), start);
+  assert(g_expected == kMessages);
+  LOG_INFO << "capacity " << capacity << ": " << inbox.posted() << " posted, "
+           << inbox.wakeups() << " wakeups, " << inbox.overflows() << " overflows, "
+           << seconds * 1e9 / kMessages << " ns/message";
+  assert(inbox.wakeups() < inbox.posted() / 2);
+}
+
+void testRunInLoop(EventLoop* loop)
+{
+  g_expected = 0;
+  Timestamp start(Timestamp::now());
+  for (int64_t i = 0; i < kMessages; ++i)
+  {
+    loop->runInLoop(std::bind(consume, i));
+  }
+  CountDownLatch latch(1);
+  loop->runInLoop(std::bind(&CountDownLatch::countDown, &latch));
+  latch.wait();
+  assert(g_expected == kMessages);
+  LOG_INFO << "runInLoop: " << timeDifference(Timestamp::now(), start) * 1e9 / kMessages
+           << " ns/message";
+}
+
+void testBatch(EventLoop* loop)
+{
+  g_expected = 0;
+  const int kBatch = 100;
+  Timestamp start(Timestamp::now());
+  std::vector<EventLoop::Functor> batch;
+  for (int64_t i = 0; i < kMessages; ++i)
+  {
+    batch.push_back(std::bind(consume, i));
+    if (batch.size() == kBatch)
+    {
+      loop->runInLoopBatch(&batch);
+      assert(batch.empty());
+    }
+  }
+  CountDownLatch latch(1);
+  batch.push_back(std::bind(&CountDownLatch::countDown, &latch));
+  loop->runInLoopBatch(&batch);
+  latch.wait();
+  assert(g_expected == kMessages);
+  LOG_INFO << "runInLoopBatch of " << kBatch << ": "
+           << timeDifference(Timestamp::now(), start) * 1e9 / kMessages << " ns/message";
+
+  // in the loop thread a batch runs at once
+  CountDownLatch done(1);
+  loop->runInLoop([loop, &done]() {
+    std::vector<EventLoop::Functor> cbs;
+    int64_t before = g_expected;
+    cbs.push_back(std::bind(consume, before));
+    cbs.push_back(std::bind(consume, before + 1));
+    loop->runInLoopBatch(&cbs);
+    assert(g_expected == before + 2);
+    done.countDown();
+  });
+  done.wait();
+}
+
+int main()
+{
+  EventLoopThread thread;
+  EventLoop* loop = thread.startLoop();
+
+  testRunInLoop(loop);
+  testBatch(loop);
+  testInbox(loop, 4096);
+  // tiny ring, mostly overflowing, order must still hold
+  testInbox(loop, 4);
+}
@@ -0,0 +1,215 @@
+// Output-side low water mark: the callback fires once each time a write
+// drains the output buffer from above the mark to at or below it, never
+// when it drains to empty, so a producer refilling from it keeps the pipe
+// primed. TCP_NOTSENT_LOWAT keeps unsent bytes in the kernel down while
+// the peer does not read.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kNotSentLowat = 16 * 1024;
+const size_t kLowMark = 256 * 1024;
+
+EventLoop* g_loop;
+InetAddress g_serverAddr(2037, true);
+std::unique_ptr<TcpClient> g_client;
+size_t g_received = 0;
+bool g_paced = false;
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  g_received += buf->readableBytes();
+  buf->retrieveAll();
+  if (g_paced)
+  {
+    // one read per millisecond, the window opens a little at a time
+    conn->stopRead();
+    g_loop->runAfter(0.001, std::bind(&TcpConnection::startRead, conn));
+  }
+}
+
+// runs until the server shuts down, the client stops reading for
+// @c pause seconds first and calls @c paused before it reads again
+void runClient(double pause, const std::function<void ()>& paused)
+{
+  g_received = 0;
+  g_client.reset(new TcpClient(g_loop, g_serverAddr, "LowWaterMarkClient"));
+  g_client->setConnectionCallback([pause, paused](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->stopRead();
+      g_loop->runAfter(pause, [conn, paused]()
+      {
+        paused();
+        conn->startRead();
+      });
+    }
+    else
+    {
+      // let the server side see the close too
+      g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+    }
+  });
+  g_client->setMessageCallback(onClientMessage);
+  g_client->connect();
+  TimerId timeout = g_loop->runAfter(5.0, []() { LOG_FATAL << "timeout"; });
+  g_loop->loop();
+  g_loop->cancel(timeout);
+  g_client.reset();
+}
+
+// a producer refilling on the low water mark
+
+const size_t kChunkSize = 1024 * 1024;
+const int kChunks = 8;
+int g_chunks = 0;
+int g_lowWaterMarks = 0;
+int g_writeCompletes = 0;
+
+void onLowWaterMark(const TcpConnectionPtr& conn, size_t remaining)
+{
+  ++g_lowWaterMarks;
+  assert(remaining > 0);
+  assert(remaining <= kLowMark);
+  assert(conn->outputBuffer()->readableBytes() == remaining);
+  if (g_chunks < kChunks)
+  {
+    ++g_chunks;
+    conn->send(string(kChunkSize, static_cast<char>('a' + g_chunks)));
+  }
+}
+
+void onWriteComplete(const TcpConnectionPtr& conn)
+{
+  ++g_writeCompletes;
+  conn->shutdown();
+}
+
+void testProducer()
+{
+  TcpServer server(g_loop, g_serverAddr, "Producer");
+  server.setConnectionCallback([](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setTcpNotSentLowat(kNotSentLowat);
+      conn->setLowWaterMarkCallback(onLowWaterMark, kLowMark);
+      conn->setWriteCompleteCallback(onWriteComplete);
+      ++g_chunks;
+      conn->send(string(kChunkSize, 'a'));
+    }
+  });
+  server.start();
+  // a paced reader keeps each write well below the mark
+  g_paced = true;
+  runClient(0, []() { });
+  g_paced = false;
+
+  printf("producer: %zd bytes, %d low water marks, %d write completes\n",
+         g_received, g_lowWaterMarks, g_writeCompletes);
+  assert(g_received == kChunks * kChunkSize);
+  // once per refill, not again below the mark nor on the last drain
+  assert(g_lowWaterMarks == kChunks);
+  // refilled before it ran dry
+  assert(g_writeCompletes == 1);
+}
+
+// one write from above the mark straight to empty, a little is left over
+// once the kernel is full, and it all goes as soon as the peer reads
+
+const size_t kSmallMark = 4 * 1024;
+const size_t kFillSize = 64 * 1024;
+
+void testDrainToEmpty()
+{
+  g_lowWaterMarks = 0;
+  g_writeCompletes = 0;
+  size_t sent = 0;
+  TcpServer server(g_loop, g_serverAddr, "DrainToEmpty");
+  server.setConnectionCallback([&sent](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setLowWaterMarkCallback([](const TcpConnectionPtr&, size_t) { ++g_lowWaterMarks; },
+                                    kSmallMark);
+      while (conn->outputBuffer()->readableBytes() == 0)
+      {
+        conn->send(string(kFillSize, 'e'));
+        sent += kFillSize;
+      }
+      conn->send(string(2 * kSmallMark, 'e'));
+      sent += 2 * kSmallMark;
+      conn->setWriteCompleteCallback(onWriteComplete);
+    }
+  });
+  server.start();
+  runClient(0.2, []() { });
+
+  printf("drain to empty: %zd bytes, %d low water marks, %d write completes\n",
+         g_received, g_lowWaterMarks, g_writeCompletes);
+  assert(g_received == sent);
+  // left to WriteCompleteCallback
+  assert(g_lowWaterMarks == 0);
+  assert(g_writeCompletes == 1);
+}
+
+// how much the kernel takes while the peer does not read
+
+const size_t kBlockSize = 8 * 1024 * 1024;
+
+size_t kernelTaken(int notSentLowat)
+{
+  TcpConnectionPtr serverConn;
+  size_t taken = 0;
+  TcpServer server(g_loop, g_serverAddr, "NotSentLowat");
+  server.setConnectionCallback([notSentLowat, &serverConn](const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      if (notSentLowat > 0)
+      {
+        conn->setTcpNotSentLowat(notSentLowat);
+      }
+      conn->setWriteCompleteCallback(std::bind(&TcpConnection::shutdown, _1));
+      serverConn = conn;
+      conn->send(string(kBlockSize, 'x'));
+    }
+  });
+  server.start();
+  runClient(0.2, [&serverConn, &taken]()
+  {
+    taken = kBlockSize - serverConn->outputBuffer()->readableBytes();
+    serverConn.reset();
+  });
+  assert(g_received == kBlockSize);
+  return taken;
+}
+
+void testNotSentLowat()
+{
+  size_t byDefault = kernelTaken(0);
+  size_t limited = kernelTaken(kNotSentLowat);
+  printf("kernel took %zd bytes by default, %zd with TCP_NOTSENT_LOWAT %d\n",
+         byDefault, limited, kNotSentLowat);
+  // the peer's receive window, but little unsent on top of it
+  assert(limited < byDefault);
+  assert(byDefault - limited > kLowMark);
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  testProducer();
+  testDrainToEmpty();
+  testNotSentLowat();
+}
@@ -0,0 +1,124 @@
+// TcpConnection::migrateTo(): a connection hops between the IO loops while
+// another thread keeps sending on it, and nothing is lost or reordered.
+// Its TCP_INFO sampling moves along.
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <set>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kTotal = 1024 * 1024;
+const size_t kMigrateEvery = 64 * 1024;
+
+EventLoop* g_loop;
+TcpServer* g_server;
+std::vector<EventLoop*> g_ioLoops;
+size_t g_serverReceived = 0;  // in the connection's loop, which changes
+size_t g_echoed = 0;
+int g_migrations = 0;
+std::set<int> g_threads;
+MutexLock g_mutex;
+
+char pattern(size_t i)
+{
+  return static_cast<char>('a' + i % 23);
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  assert(conn->getLoop()->isInLoopThread());
+  {
+  MutexLockGuard lock(g_mutex);
+  g_threads.insert(CurrentThread::tid());
+  }
+  size_t before = g_serverReceived;
+  g_serverReceived += buf->readableBytes();
+  string data = buf->retrieveAllAsString();
+  // echoed by the main thread, so sends cross threads during migrations
+  g_loop->runInLoop([conn, data]() { conn->send(data); });
+  if (before / kMigrateEvery != g_serverReceived / kMigrateEvery)
+  {
+    EventLoop* target = g_ioLoops[0] == conn->getLoop() ? g_ioLoops[1] : g_ioLoops[0];
+    conn->migrateTo(target);
+    ++g_migrations;
+  }
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (!conn->connected())
+  {
+    assert(conn->getLoop()->isInLoopThread());
+    // let the client side see the close too
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    string data(kTotal, ' ');
+    for (size_t i = 0; i < kTotal; ++i)
+    {
+      data[i] = pattern(i);
+    }
+    conn->send(data);
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  const char* p = buf->peek();
+  for (size_t i = 0; i < buf->readableBytes(); ++i)
+  {
+    assert(p[i] == pattern(g_echoed + i));
+  }
+  g_echoed += buf->readableBytes();
+  buf->retrieveAll();
+  if (g_echoed == kTotal)
+  {
+    // a few sampler ticks after the last migration
+    g_loop->runAfter(0.05, [conn]()
+    {
+      assert(g_server->worstConnections(10).size() == 1);
+      conn->shutdown();
+    });
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress addr(2029, true);
+  TcpServer server(&loop, addr, "Migration");
+  g_server = &server;
+  server.setThreadNum(2);
+  server.enableTcpInfoSampling(0.001);
+  server.setConnectionCallback(onServerConnection);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+  g_ioLoops = server.threadPool()->getAllLoops();
+  TcpClient client(&loop, addr, "MigrationClient");
+  client.setConnectionCallback(onClientConnection);
+  client.setMessageCallback(onClientMessage);
+  client.connect();
+  loop.runAfter(10.0, []() { LOG_FATAL << "timeout"; });
+  loop.loop();
+
+  LOG_INFO << "echoed " << g_echoed << " migrations " << g_migrations
+           << " threads " << g_threads.size();
+  assert(g_echoed == kTotal);
+  assert(g_migrations >= 4);
+  assert(g_threads.size() == 2);
+}
@@ -0,0 +1,166 @@
+// PreforkServer: workers echo on a shared port, report stats, and are
+// restarted when they die.
+
+#include "muduo/net/PreforkServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+EventLoop* g_loop;
+PreforkServer* g_server;
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+int g_echoed = 0;
+pid_t g_killed = 0;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+void initWorker(TcpServer* server, int)
+{
+  server->setMessageCallback(onServerMessage);
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send("hello");
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  if (buf->readableBytes() >= 5)
+  {
+    string message = buf->retrieveAllAsString();
+    assert(message == "hello");
+    (void) message;
+    ++g_echoed;
+  }
+}
+
+void connect(const InetAddress& addr, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    char name[32];
+    snprintf(name, sizeof name, "client%zu", g_clients.size());
+    g_clients.emplace_back(new TcpClient(g_loop, addr, name));
+    g_clients.back()->setConnectionCallback(onClientConnection);
+    g_clients.back()->setMessageCallback(onClientMessage);
+    g_clients.back()->connect();
+  }
+}
+
+void disconnectAll()
+{
+  for (auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+}
+
+// kReusePort
+
+void checkStopped()
+{
+  assert(g_server->workerPids().empty());
+  assert(g_server->restarts() == 1);
+  g_loop->quit();
+}
+
+void checkRestarted(const InetAddress& addr)
+{
+  std::vector<pid_t> pids = g_server->workerPids();
+  LOG_INFO << "restarts " << g_server->restarts();
+  assert(g_server->restarts() == 1);
+  assert(pids.size() == 2);
+  assert(std::find(pids.begin(), pids.end(), g_killed) == pids.end());
+  for (const PreforkServer::WorkerStats& stats : g_server->workerStats())
+  {
+    assert(stats.pid != 0 && stats.pid != g_killed);
+  }
+  connect(addr, 4);
+  g_loop->runAfter(0.3, []()
+  {
+    assert(g_echoed == 8);
+    disconnectAll();
+    g_server->stop();
+    g_loop->runAfter(0.3, checkStopped);
+  });
+}
+
+void checkStats(const InetAddress& addr)
+{
+  LOG_INFO << "echoed " << g_echoed;
+  assert(g_echoed == 4);
+  PreforkServer::WorkerStats total = g_server->totalStats();
+  LOG_INFO << "accepted " << total.accepted << " connections " << total.connections;
+  assert(total.accepted == 4);
+  assert(total.connections == 4);
+  assert(total.when.valid());
+
+  std::vector<pid_t> pids = g_server->workerPids();
+  assert(pids.size() == 2);
+  g_killed = pids[0];
+  ::kill(g_killed, SIGKILL);
+  g_loop->runAfter(0.5, std::bind(checkRestarted, addr));
+}
+
+// kSharedSocket
+
+void checkShared()
+{
+  LOG_INFO << "echoed " << g_echoed;
+  assert(g_echoed == 4);
+  assert(g_server->totalStats().accepted == 4);
+  disconnectAll();
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+
+  {
+    InetAddress addr(2022, true);
+    PreforkServer server(&loop, addr, "Prefork", 2, PreforkServer::kReusePort);
+    g_server = &server;
+    server.setWorkerInitCallback(initWorker);
+    server.setStatsInterval(0.1);
+    server.setRestartDelay(0.1);
+    server.start();
+    connect(addr, 4);
+    loop.runAfter(0.5, std::bind(checkStats, addr));
+    loop.loop();
+    g_clients.clear();
+  }
+
+  g_echoed = 0;
+  {
+    InetAddress addr(2023, true);
+    PreforkServer server(&loop, addr, "Shared", 2, PreforkServer::kSharedSocket);
+    g_server = &server;
+    server.setWorkerInitCallback(initWorker);
+    server.setStatsInterval(0.1);
+    server.start();
+    connect(addr, 4);
+    loop.runAfter(0.5, checkShared);
+    loop.loop();
+    g_clients.clear();
+  }
+}
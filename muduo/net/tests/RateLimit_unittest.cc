@@ -0,0 +1,370 @@
+// Per-connection and aggregate egress limits hold their rates, and a
+// limited Transport that needs its pending write retried whole, like TLS,
+// keeps its stream intact.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/net/Transport.h"
+
+#ifdef HAVE_OPENSSL
+#include "muduo/net/tls/TlsContext.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const double kPerConnection = 2 * 1024 * 1024;
+const double kAggregate = 3 * 1024 * 1024;
+const size_t kBurst = 64 * 1024;
+const double kWarmUp = 0.2;
+const double kMeasure = 1.0;
+
+EventLoop* g_loop;
+string g_chunk(256 * 1024, 'x');
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+std::vector<int64_t> g_received;
+std::vector<int64_t> g_start;
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send(g_chunk);
+  }
+}
+
+void onWriteComplete(const TcpConnectionPtr& conn)
+{
+  conn->send(g_chunk);
+}
+
+void onClientMessage(size_t i, const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_received[i] += static_cast<int64_t>(buf->readableBytes());
+  buf->retrieveAll();
+}
+
+void startMeasure()
+{
+  g_start = g_received;
+}
+
+void checkRate(double rate, int64_t bytes, const char* what)
+{
+  double measured = static_cast<double>(bytes) / kMeasure;
+  printf("%s: %.2f MiB/s, limit %.2f MiB/s\n", what, measured / 1024 / 1024, rate / 1024 / 1024);
+  assert(fabs(measured - rate) < rate * 0.1);
+}
+
+void stopMeasure()
+{
+  std::vector<int64_t> bytes(g_received.size());
+  for (size_t i = 0; i < bytes.size(); ++i)
+  {
+    bytes[i] = g_received[i] - g_start[i];
+  }
+  checkRate(kPerConnection, bytes[0], "per connection");
+  checkRate(kAggregate, bytes[1] + bytes[2], "aggregate");
+  for (auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+}
+
+void setUp(TcpServer* server)
+{
+  server->setConnectionCallback(onServerConnection);
+  server->setWriteCompleteCallback(onWriteComplete);
+  server->start();
+}
+
+void connect(const InetAddress& addr)
+{
+  size_t i = g_clients.size();
+  char name[32];
+  snprintf(name, sizeof name, "client%zu", i);
+  g_clients.emplace_back(new TcpClient(g_loop, addr, name));
+  g_received.push_back(0);
+  g_clients.back()->setMessageCallback(std::bind(onClientMessage, i, _1, _2, _3));
+  g_clients.back()->connect();
+}
+
+// like OpenSSL with SSL_MODE_ENABLE_PARTIAL_WRITE: seals what it's offered
+// into a record, and a record the socket hasn't taken whole must be retried
+// with no fewer bytes, or the write fails as with SSL_R_BAD_LENGTH.
+// The first try of every record gets half of it on the wire.
+class RecordTransport : public Transport
+{
+ public:
+  RecordTransport() : written_(0), retried_(false) { }
+
+  HandshakeState handshake(int) override { return kHandshakeDone; }
+
+  ssize_t read(int sockfd, Buffer* buf, int* savedErrno) override
+  {
+    return buf->readFd(sockfd, savedErrno);
+  }
+
+  ssize_t write(int sockfd, const void* data, size_t len) override
+  {
+    if (record_.empty())
+    {
+      record_.assign(static_cast<const char*>(data), std::min(len, kRecordSize));
+      written_ = 0;
+      retried_ = false;
+    }
+    else if (len < record_.size())
+    {
+      ++g_badRetries;
+      errno = EPIPE;
+      return -1;
+    }
+    size_t chunk = retried_ ? record_.size() - written_ : record_.size() / 2;
+    retried_ = true;
+    ssize_t n = ::write(sockfd, record_.data() + written_, chunk);
+    if (n < 0)
+    {
+      return -1;
+    }
+    written_ += static_cast<size_t>(n);
+    if (written_ < record_.size())
+    {
+      errno = EWOULDBLOCK;
+      return -1;
+    }
+    ssize_t sealed = static_cast<ssize_t>(record_.size());
+    record_.clear();
+    return sealed;
+  }
+
+  void shutdown(int) override { }
+
+  static const size_t kRecordSize = 16 * 1024;
+  static int g_badRetries;
+
+ private:
+  string record_;
+  size_t written_;
+  bool retried_;
+};
+
+const size_t RecordTransport::kRecordSize;
+int RecordTransport::g_badRetries = 0;
+
+// connections sharing an aggregate limit take the tokens a pending record
+// gave back, the retry still has to offer the whole record
+const int kRecordClients = 2;
+const size_t kRecordBytes = 512 * 1024;
+std::vector<size_t> g_recordReceived;
+int g_recordDown = 0;
+
+void onRecordServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send(string(kRecordBytes, 'r'));
+    conn->shutdown();
+  }
+}
+
+void onRecordClientConnection(size_t i, const TcpConnectionPtr& conn)
+{
+  if (conn->disconnected())
+  {
+    assert(RecordTransport::g_badRetries == 0);
+    assert(g_recordReceived[i] == kRecordBytes);
+    if (++g_recordDown == kRecordClients)
+    {
+      printf("records: %d x %zd bytes\n", kRecordClients, kRecordBytes);
+      // let the server side see the close too
+      g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+    }
+  }
+}
+
+void onRecordClientMessage(size_t i, const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_recordReceived[i] += buf->readableBytes();
+  buf->retrieveAll();
+}
+
+void testRecords(EventLoop* loop)
+{
+  InetAddress addr(2035, true);
+  TcpServer server(loop, addr, "RecordRateLimit");
+  server.setTransportFactory(
+      []() { return std::unique_ptr<Transport>(new RecordTransport); });
+  server.setAggregateRateLimit(kAggregate, kBurst);
+  server.setConnectionCallback(onRecordServerConnection);
+  server.start();
+
+  std::vector<std::unique_ptr<TcpClient>> clients;
+  for (size_t i = 0; i < kRecordClients; ++i)
+  {
+    g_recordReceived.push_back(0);
+    clients.emplace_back(new TcpClient(loop, addr, "RecordClient"));
+    clients.back()->setConnectionCallback(std::bind(onRecordClientConnection, i, _1));
+    clients.back()->setMessageCallback(std::bind(onRecordClientMessage, i, _1, _2, _3));
+    clients.back()->connect();
+  }
+  TimerId timeout = loop->runAfter(5.0, []() { LOG_FATAL << "records timeout"; });
+  loop->loop();
+  loop->cancel(timeout);
+}
+
+#ifdef HAVE_OPENSSL
+
+// the same over real TLS
+const int kTlsClients = 2;
+const size_t kTlsBytes = 4 * 1024 * 1024;
+std::vector<size_t> g_tlsReceived;
+int g_tlsDown = 0;
+
+string bioToString(BIO* bio)
+{
+  char* data = NULL;
+  long len = BIO_get_mem_data(bio, &data);
+  return string(data, static_cast<size_t>(len));
+}
+
+// self-signed certificate for "localhost"
+void makeCertificate(string* certPem, string* keyPem)
+{
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509(bio, cert);
+  *certPem = bioToString(bio);
+  BIO_free(bio);
+  bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, NULL, NULL, 0, NULL, NULL);
+  *keyPem = bioToString(bio);
+  BIO_free(bio);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+void onTlsServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send(string(kTlsBytes, 'x'));
+    conn->shutdown();
+  }
+}
+
+void onTlsClientConnection(size_t i, const TcpConnectionPtr& conn)
+{
+  if (conn->connected() && i == 0)
+  {
+    // the first one stalls, its socket fills up meanwhile
+    conn->stopRead();
+    g_loop->runAfter(0.3, [conn]() { conn->startRead(); });
+  }
+  else if (conn->disconnected())
+  {
+    assert(g_tlsReceived[i] == kTlsBytes);
+    if (++g_tlsDown == kTlsClients)
+    {
+      printf("TLS: %d x %zd bytes\n", kTlsClients, kTlsBytes);
+      // let the server side see the close too
+      g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+    }
+  }
+}
+
+void onTlsClientMessage(size_t i, const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_tlsReceived[i] += buf->readableBytes();
+  buf->retrieveAll();
+}
+
+void testTls(EventLoop* loop)
+{
+  string certPem, keyPem;
+  makeCertificate(&certPem, &keyPem);
+  TlsContext serverContext(TlsContext::kServer);
+  bool ok = serverContext.useCertificate(certPem, keyPem);
+  assert(ok);
+  (void) ok;
+  TlsContext clientContext(TlsContext::kClient);
+  clientContext.addTrustedCertificate(certPem);
+
+  InetAddress addr(2034, true);
+  TcpServer server(loop, addr, "TlsRateLimit");
+  server.setTransportFactory(serverContext.serverTransportFactory());
+  server.setAggregateRateLimit(64 * kPerConnection, kBurst);
+  server.setConnectionCallback(onTlsServerConnection);
+  server.start();
+
+  std::vector<std::unique_ptr<TcpClient>> clients;
+  for (size_t i = 0; i < kTlsClients; ++i)
+  {
+    g_tlsReceived.push_back(0);
+    clients.emplace_back(new TcpClient(loop, addr, "TlsClient"));
+    clients.back()->setTransportFactory(clientContext.clientTransportFactory("localhost"));
+    clients.back()->setConnectionCallback(std::bind(onTlsClientConnection, i, _1));
+    clients.back()->setMessageCallback(std::bind(onTlsClientMessage, i, _1, _2, _3));
+    clients.back()->connect();
+  }
+  TimerId timeout = loop->runAfter(5.0, []() { LOG_FATAL << "TLS timeout"; });
+  loop->loop();
+  loop->cancel(timeout);
+}
+
+#endif
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+
+  InetAddress perConnectionAddr(2015);
+  TcpServer perConnection(&loop, perConnectionAddr, "PerConnection");
+  perConnection.setRateLimit(kPerConnection, kBurst);
+  setUp(&perConnection);
+
+  InetAddress aggregateAddr(2016);
+  TcpServer aggregate(&loop, aggregateAddr, "Aggregate");
+  aggregate.setAggregateRateLimit(kAggregate, kBurst);
+  setUp(&aggregate);
+
+  connect(perConnectionAddr);
+  connect(aggregateAddr);
+  connect(aggregateAddr);
+
+  loop.runAfter(kWarmUp, startMeasure);
+  loop.runAfter(kWarmUp + kMeasure, stopMeasure);
+  loop.loop();
+  g_clients.clear();
+
+  testRecords(&loop);
+#ifdef HAVE_OPENSSL
+  testTls(&loop);
+#endif
+}
@@ -0,0 +1,271 @@
+// Resolver against a stub nameserver: caching, coalescing, retries,
+// negative answers, and TcpClient connecting by hostname.
+
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/UdpChannel.h"
+
+#include <map>
+
+#include <arpa/inet.h>
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+EventLoop* g_loop;
+Resolver* g_resolver;
+Resolver* g_otherResolver;
+TcpClient* g_client;
+std::map<string, int> g_queries;  // "name/type"
+bool g_droppedSlow = false;
+bool g_connected = false;
+
+// stub nameserver
+
+void appendUint16(string* out, int x)
+{
+  out->push_back(static_cast<char>(x >> 8));
+  out->push_back(static_cast<char>(x & 0xff));
+}
+
+void appendRecord(string* out, int type, int ttl, const void* rdata, size_t rdlength)
+{
+  appendUint16(out, 0xc00c);  // the name in the question
+  appendUint16(out, type);
+  appendUint16(out, 1);
+  appendUint16(out, ttl >> 16);
+  appendUint16(out, ttl & 0xffff);
+  appendUint16(out, static_cast<int>(rdlength));
+  out->append(static_cast<const char*>(rdata), rdlength);
+}
+
+void onQuery(UdpChannel* channel, const char* data, size_t len,
+             const InetAddress& peerAddr, Timestamp)
+{
+  string query(data, len);
+  string name;
+  size_t pos = 12;
+  while (query[pos] != 0)
+  {
+    size_t label = static_cast<size_t>(query[pos]);
+    if (!name.empty())
+      name += '.';
+    name.append(query, pos + 1, label);
+    pos += 1 + label;
+  }
+  int type = static_cast<uint8_t>(query[pos+2]);
+  size_t questionEnd = pos + 5;
+  ++g_queries[name + (type == 1 ? "/A" : "/AAAA")];
+
+  if (name == "slow.test" && !g_droppedSlow)
+  {
+    g_droppedSlow = true;
+    return;
+  }
+
+  string reply(query, 0, 2);
+  int rcode = name == "missing.test" ? 3 : 0;
+  appendUint16(&reply, 0x8180 | rcode);
+  appendUint16(&reply, 1);
+  string records;
+  int answers = 0;
+  int authority = 0;
+  struct in_addr addr4;
+  struct in6_addr addr6;
+  if (name == "missing.test")
+  {
+    string soa("\0\0", 2);  // root, root
+    for (int field = 0; field < 4; ++field)
+    {
+      appendUint16(&soa, 0);
+      appendUint16(&soa, 100);
+    }
+    appendUint16(&soa, 0);
+    appendUint16(&soa, 60);  // MINIMUM
+    appendRecord(&records, 6, 300, soa.data(), soa.size());
+    authority = 1;
+  }
+  else if (type == 1)
+  {
+    inet_pton(AF_INET, name == "short.test" ? "10.1.2.3" : "127.0.0.1", &addr4);
+    appendRecord(&records, 1, name == "short.test" ? 1 : 60, &addr4, sizeof addr4);
+    answers = 1;
+  }
+  else if (name == "dual.test")
+  {
+    inet_pton(AF_INET6, "::1", &addr6);
+    appendRecord(&records, 28, 60, &addr6, sizeof addr6);
+    answers = 1;
+  }
+  appendUint16(&reply, answers);
+  appendUint16(&reply, authority);
+  appendUint16(&reply, 0);
+  reply.append(query, 12, questionEnd - 12);
+  reply += records;
+  channel->send(reply, peerAddr);
+}
+
+// steps
+
+void resolveAndCheck(const string& name, const char* expected, size_t count,
+                     const std::function<void ()>& next)
+{
+  g_resolver->resolve(name, [=](const std::vector<InetAddress>& addrs)
+  {
+    LOG_INFO << name << " " << addrs.size() << " addresses";
+    assert(g_loop->isInLoopThread());
+    assert(addrs.size() == count);
+    if (count > 0)
+    {
+      assert(addrs[0].toIp() == expected);
+    }
+    next();
+  });
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_connected = true;
+  }
+}
+
+void connectByName()
+{
+  g_client->connect();
+  g_loop->runAfter(0.2, []()
+  {
+    assert(g_connected);
+    assert(g_client->connection()->peerAddress().toIpPort() == "127.0.0.1:2020");
+    g_client->disconnect();
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  });
+}
+
+void afterShortTtl()
+{
+  resolveAndCheck("short.test", "10.1.2.3", 1, []()
+  {
+    assert(g_queries["short.test/A"] == 2);
+    connectByName();
+  });
+}
+
+void slowAndShort()
+{
+  resolveAndCheck("slow.test", "127.0.0.1", 1, []()
+  {
+    assert(g_resolver->timeouts() >= 1);
+    resolveAndCheck("short.test", "10.1.2.3", 1, []()
+    {
+      g_loop->runAfter(1.5, afterShortTtl);
+    });
+  });
+}
+
+void negative()
+{
+  resolveAndCheck("missing.test", "", 0, []()
+  {
+    resolveAndCheck("Missing.Test.", "", 0, []()
+    {
+      assert(g_queries["missing.test/A"] == 1);
+      slowAndShort();
+    });
+  });
+}
+
+void cached()
+{
+  int64_t sent = g_resolver->queriesSent();
+  resolveAndCheck("dual.test", "127.0.0.1", 2, [=]()
+  {
+    assert(g_resolver->queriesSent() == sent);
+    resolveAndCheck("::1", "::1", 1, [=]()
+    {
+      assert(g_resolver->queriesSent() == sent);
+      negative();
+    });
+  });
+}
+
+void coalesced()
+{
+  const int kLookups = 3;
+  std::shared_ptr<int> pending = std::make_shared<int>(kLookups + 1);
+  auto done = [=]()
+  {
+    if (--*pending == 0)
+    {
+      LOG_INFO << "coalesced " << g_resolver->cache()->coalesced();
+      assert(g_queries["dual.test/A"] == 1);
+      assert(g_queries["dual.test/AAAA"] == 1);
+      // the other loop may come after the answer, and hit the cache
+      assert(g_resolver->cache()->coalesced() >= kLookups - 1);
+      cached();
+    }
+  };
+  // the other loop shares the cache, and the query
+  g_otherResolver->resolve("dual.test", [=](const std::vector<InetAddress>& addrs)
+  {
+    assert(!g_loop->isInLoopThread());
+    assert(addrs.size() == 2);
+    g_loop->runInLoop(done);
+  });
+  for (int i = 0; i < kLookups; ++i)
+  {
+    resolveAndCheck("dual.test", "127.0.0.1", 2, done);
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress nameserver("127.0.0.1", 2019);
+  UdpChannel stub(&loop, nameserver, "stub");
+  stub.setDatagramCallback(onQuery);
+  stub.start();
+
+  std::shared_ptr<DnsCache> cache = std::make_shared<DnsCache>();
+  Resolver resolver(&loop, nameserver, cache);
+  resolver.setTimeout(0.2, 3);
+  g_resolver = &resolver;
+
+  EventLoopThread thread;
+  EventLoop* other = thread.startLoop();
+  std::unique_ptr<Resolver> otherResolver;
+  CountDownLatch created(1);
+  other->runInLoop([&]()
+  {
+    otherResolver.reset(new Resolver(other, nameserver, cache));
+    created.countDown();
+  });
+  created.wait();
+  g_otherResolver = otherResolver.get();
+
+  TcpServer server(&loop, InetAddress(2020, true), "server");
+  server.setConnectionCallback(onServerConnection);
+  server.start();
+  TcpClient client(&loop, &resolver, "dual.test", 2020, "client");
+  g_client = &client;
+
+  loop.runInLoop(coalesced);
+  loop.loop();
+
+  CountDownLatch destroyed(1);
+  other->runInLoop([&]()
+  {
+    otherResolver.reset();
+    destroyed.countDown();
+  });
+  destroyed.wait();
+}
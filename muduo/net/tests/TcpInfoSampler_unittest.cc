@@ -0,0 +1,87 @@
+// Every connection gets sampled within its budget, and is dropped once closed.
+
+#include "muduo/net/TcpInfoSampler.h"
+
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 5;
+
+EventLoop* g_loop;
+TcpServer* g_server;
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send("hello");
+  }
+}
+
+void afterClose()
+{
+  assert(g_server->worstConnections(10).empty());
+  g_loop->quit();
+}
+
+void afterSampling()
+{
+  std::vector<TcpInfoSampler::Sample> worst = g_server->worstConnections(10);
+  printf("%s", TcpInfoSampler::toString(worst).c_str());
+  TcpInfoSampler::Histograms histograms = g_server->tcpInfoHistograms();
+  printf("%s", histograms.toString().c_str());
+  assert(worst.size() == kClients);
+  for (size_t i = 1; i < worst.size(); ++i)
+  {
+    assert(worst[i-1].badness() >= worst[i].badness());
+  }
+  assert(g_server->worstConnections(2).size() == 2);
+  assert(histograms.rtt.count() >= kClients);
+  assert(histograms.cwnd.percentile(0.5) > 0);
+
+  for (auto& client : g_clients)
+  {
+    client->disconnect();
+  }
+  g_loop->runAfter(0.3, afterClose);
+}
+
+int main()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress listenAddr(2013);
+  TcpServer server(&loop, listenAddr, "TcpInfoSampler");
+  g_server = &server;
+  server.setThreadNum(2);
+  // one connection per loop per tick, a pass takes 3 ticks
+  server.enableTcpInfoSampling(0.02, 1);
+  server.setMessageCallback(onServerMessage);
+  server.start();
+
+  for (int i = 0; i < kClients; ++i)
+  {
+    char name[32];
+    snprintf(name, sizeof name, "client%d", i);
+    g_clients.emplace_back(new TcpClient(&loop, listenAddr, name));
+    g_clients.back()->setConnectionCallback(onClientConnection);
+    g_clients.back()->connect();
+  }
+  loop.runAfter(0.3, afterSampling);
+  loop.loop();
+  g_clients.clear();
+}
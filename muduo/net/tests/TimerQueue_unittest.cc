@@ -2,6 +2,7 @@
 #include "muduo/net/EventLoopThread.h"
 #include "muduo/base/Thread.h"
 
+#include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -32,8 +33,32 @@ void cancel(TimerId timer)
   printf("cancelled at %s\n", Timestamp::now().toString().c_str());
 }
 
+int g_ran = 0;
+
+void cancelOther(TimerId* other)
+{
+  g_loop->cancel(*other);
+  ++g_ran;
+}
+
+// expire in the same batch, whichever runs first cancels the other
+void testCancelInBatch()
+{
+  EventLoop loop;
+  g_loop = &loop;
+  TimerId first, second;
+  Timestamp when = addTime(Timestamp::now(), 0.01);
+  first = loop.runAt(when, std::bind(cancelOther, &second));
+  second = loop.runAt(when, std::bind(cancelOther, &first));
+  loop.runAfter(0.1, std::bind(&EventLoop::quit, &loop));
+  loop.loop();
+  printf("cancelled in the same batch, %d of 2 ran\n", g_ran);
+  assert(g_ran == 1);
+}
+
 int main()
 {
+  testCancelInBatch();
   printTid();
   sleep(1);
   {
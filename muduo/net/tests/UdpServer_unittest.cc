@@ -0,0 +1,100 @@
+#include "muduo/net/UdpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/InetAddress.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kDatagrams = 10000;
+int received = 0;
+EventLoop* g_loop;
+
+void onServerDatagram(UdpChannel* channel, const char* data, size_t len,
+                      const InetAddress& peerAddr, Timestamp)
+{
+  channel->send(data, len, peerAddr);
+}
+
+void onClientDatagram(UdpChannel* channel, const char* data, size_t len,
+                      const InetAddress&, Timestamp)
+{
+  ++received;
+  if (received == kDatagrams)
+  {
+    LOG_INFO << "received all " << received << " echoes, sent "
+             << channel->datagramsSent() << " dropped " << channel->datagramsDropped();
+    g_loop->quit();
+  }
+}
+
+void timeout()
+{
+  LOG_ERROR << "timeout, received " << received << " of " << kDatagrams;
+  abort();
+}
+
+void sendSome(UdpChannel* client, const InetAddress& serverAddr, int start)
+{
+  // 100 per round, a small datagram takes ~1KiB of the receive buffer
+  char buf[32];
+  int end = std::min(start + 100, kDatagrams);
+  for (int i = start; i < end; ++i)
+  {
+    int len = snprintf(buf, sizeof buf, "%d", i);
+    client->send(buf, len, serverAddr);
+  }
+  if (end < kDatagrams)
+  {
+    client->getLoop()->runAfter(0.005, std::bind(&sendSome, client, serverAddr, end));
+  }
+}
+
+// sends queued from another thread are dropped once the channel is gone
+void testSendAfterDestroy(const InetAddress& serverAddr)
+{
+  std::unique_ptr<UdpChannel> channel(new UdpChannel(g_loop, InetAddress(0, true), "Doomed"));
+  UdpChannel* doomed = channel.get();
+  Thread sender([doomed, &serverAddr]()
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      doomed->send("doomed", 6, serverAddr);
+    }
+  }, "UdpSender");
+  sender.start();
+  sender.join();
+  channel.reset();
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  g_loop->loop();
+}
+
+int main(int argc, char* argv[])
+{
+  int numThreads = argc > 1 ? atoi(argv[1]) : 2;
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress serverAddr(2009, true);
+  UdpServer server(&loop, serverAddr, "UdpServer");
+  server.setThreadNum(numThreads);
+  server.setDatagramCallback(onServerDatagram);
+  server.start();
+
+  UdpChannel client(&loop, InetAddress(0, true), "UdpClient");
+  client.setDatagramCallback(onClientDatagram);
+  client.start();
+
+  sendSome(&client, serverAddr, 0);
+  TimerId timeoutId = loop.runAfter(10.0, timeout);
+  loop.loop();
+  loop.cancel(timeoutId);
+
+  testSendAfterDestroy(serverAddr);
+}
@@ -0,0 +1,128 @@
+// Unix domain socket path ownership: the Acceptor replaces a socket left
+// by a dead server, refuses to touch a path in use or one that is not a
+// socket, and on destruction only removes the socket it bound itself.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/TcpServer.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+EventLoop* g_loop;
+const char* g_path;
+
+bool exists()
+{
+  struct stat st;
+  return ::lstat(g_path, &st) == 0;
+}
+
+bool connectable()
+{
+  int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int ret = sockets::connect(sockfd, InetAddress::unixDomain(g_path).getSockAddr());
+  ::close(sockfd);
+  return ret == 0;
+}
+
+std::unique_ptr<TcpServer> newServer()
+{
+  std::unique_ptr<TcpServer> server(
+      new TcpServer(g_loop, InetAddress::unixDomain(g_path), "UnixServer"));
+  server->start();
+  return server;
+}
+
+// a server on the path aborts in a child, the path is left alone
+void expectBindFails()
+{
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    newServer();
+    _exit(0);
+  }
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+  assert(exists());
+}
+
+void testStaleSocket()
+{
+  // bound and closed, nobody listens
+  InetAddress addr = InetAddress::unixDomain(g_path);
+  int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int ret = ::bind(sockfd, addr.getSockAddr(), addr.getSockAddrLen());
+  assert(ret == 0);
+  (void) ret;
+  ::close(sockfd);
+  assert(exists());
+  assert(!connectable());
+
+  std::unique_ptr<TcpServer> server = newServer();
+  assert(connectable());
+  server.reset();
+  assert(!exists());
+}
+
+void testInUse()
+{
+  std::unique_ptr<TcpServer> server = newServer();
+  expectBindFails();
+  assert(connectable());
+  server.reset();
+  assert(!exists());
+}
+
+void testNotSocket()
+{
+  int fd = ::open(g_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  assert(fd >= 0);
+  ::close(fd);
+  expectBindFails();
+  struct stat st;
+  ::lstat(g_path, &st);
+  assert(S_ISREG(st.st_mode));
+  ::unlink(g_path);
+}
+
+// the path was removed and taken by another server while the first ran
+void testReplaced()
+{
+  std::unique_ptr<TcpServer> first = newServer();
+  ::unlink(g_path);
+  std::unique_ptr<TcpServer> second = newServer();
+  first.reset();
+  assert(exists());
+  assert(connectable());
+  second.reset();
+  assert(!exists());
+}
+
+int main()
+{
+  char path[64];
+  snprintf(path, sizeof path, "/tmp/muduo_unixsocket_%d.sock", getpid());
+  g_path = path;
+  ::unlink(g_path);
+
+  EventLoop loop;
+  g_loop = &loop;
+  testStaleSocket();
+  testInUse();
+  testNotSocket();
+  testReplaced();
+  printf("done\n");
+}
@@ -0,0 +1,256 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/tls/TlsContext.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/tls/TlsTransport.h"
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <arpa/inet.h>  // inet_pton
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+void logSslErrors(const char* what)
+{
+  unsigned long err;
+  while ((err = ERR_get_error()) != 0)
+  {
+    char buf[256];
+    ERR_error_string_n(err, buf, sizeof buf);
+    LOG_ERROR << what << " - " << buf;
+  }
+}
+
+bool isIpAddress(const string& name)
+{
+  unsigned char addr[sizeof(struct in6_addr)];
+  return ::inet_pton(AF_INET, name.c_str(), addr) == 1
+      || ::inet_pton(AF_INET6, name.c_str(), addr) == 1;
+}
+
+}  // namespace
+
+TlsContext::TlsContext(Mode mode)
+  : mode_(mode),
+    ctx_(SSL_CTX_new(mode == kServer ? TLS_server_method() : TLS_client_method())),
+    verifyPeer_(mode == kClient)
+{
+  if (ctx_ == NULL)
+  {
+    logSslErrors("TlsContext::TlsContext");
+    LOG_FATAL << "SSL_CTX_new";
+  }
+  SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+  // outputBuffer_ moves and grows between retries of a partial write
+  SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+  // a peer closing without close_notify is EOF, not an error
+  SSL_CTX_set_options(ctx_, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+  enableKtls(true);
+  SSL_CTX_set_app_data(ctx_, this);
+
+  if (mode_ == kClient)
+  {
+    SSL_CTX_set_default_verify_paths(ctx_);
+    SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER, NULL);
+    // keep sessions in sessions_, shared by all loops
+    SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx_, &TlsContext::onNewSession);
+  }
+}
+
+TlsContext::~TlsContext()
+{
+  for (auto& entry : sessions_)
+  {
+    SSL_SESSION_free(entry.second);
+  }
+  SSL_CTX_free(ctx_);
+}
+
+bool TlsContext::useCertificateChainFile(StringArg path)
+{
+  if (SSL_CTX_use_certificate_chain_file(ctx_, path.c_str()) != 1)
+  {
+    logSslErrors("TlsContext::useCertificateChainFile");
+    return false;
+  }
+  return true;
+}
+
+bool TlsContext::usePrivateKeyFile(StringArg path)
+{
+  if (SSL_CTX_use_PrivateKey_file(ctx_, path.c_str(), SSL_FILETYPE_PEM) != 1
+      || SSL_CTX_check_private_key(ctx_) != 1)
+  {
+    logSslErrors("TlsContext::usePrivateKeyFile");
+    return false;
+  }
+  return true;
+}
+
+bool TlsContext::useCertificate(StringPiece certPem, StringPiece keyPem)
+{
+  bool ok = false;
+  BIO* certBio = BIO_new_mem_buf(certPem.data(), certPem.size());
+  BIO* keyBio = BIO_new_mem_buf(keyPem.data(), keyPem.size());
+  X509* cert = PEM_read_bio_X509(certBio, NULL, NULL, NULL);
+  EVP_PKEY* key = PEM_read_bio_PrivateKey(keyBio, NULL, NULL, NULL);
+  if (cert && key
+      && SSL_CTX_use_certificate(ctx_, cert) == 1
+      && SSL_CTX_use_PrivateKey(ctx_, key) == 1
+      && SSL_CTX_check_private_key(ctx_) == 1)
+  {
+    ok = true;
+  }
+  else
+  {
+    logSslErrors("TlsContext::useCertificate");
+  }
+  EVP_PKEY_free(key);
+  X509_free(cert);
+  BIO_free(keyBio);
+  BIO_free(certBio);
+  return ok;
+}
+
+bool TlsContext::addTrustedCertificate(StringPiece certPem)
+{
+  BIO* bio = BIO_new_mem_buf(certPem.data(), certPem.size());
+  X509* cert = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+  bool ok = cert && X509_STORE_add_cert(SSL_CTX_get_cert_store(ctx_), cert) == 1;
+  if (!ok)
+  {
+    logSslErrors("TlsContext::addTrustedCertificate");
+  }
+  X509_free(cert);
+  BIO_free(bio);
+  return ok;
+}
+
+void TlsContext::setVerifyPeer(bool on)
+{
+  verifyPeer_ = on;
+  SSL_CTX_set_verify(ctx_, on ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+}
+
+void TlsContext::enableKtls(bool on)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+  if (on)
+  {
+    SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+  }
+  else
+  {
+    SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+  }
+#else
+  if (on)
+  {
+    LOG_DEBUG << "kTLS is not supported by this OpenSSL.";
+  }
+#endif
+}
+
+TransportFactory TlsContext::serverTransportFactory()
+{
+  assert(mode_ == kServer);
+  return std::bind(&TlsContext::newServerTransport, this);
+}
+
+TransportFactory TlsContext::clientTransportFactory(const string& serverName)
+{
+  assert(mode_ == kClient);
+  return std::bind(&TlsContext::newClientTransport, this, serverName);
+}
+
+std::unique_ptr<Transport> TlsContext::newServerTransport()
+{
+  SSL* ssl = SSL_new(ctx_);
+  if (ssl == NULL)
+  {
+    logSslErrors("TlsContext::newServerTransport");
+    LOG_FATAL << "SSL_new";
+  }
+  SSL_set_accept_state(ssl);
+  return std::unique_ptr<Transport>(new TlsTransport(this, ssl, string()));
+}
+
+std::unique_ptr<Transport> TlsContext::newClientTransport(const string& serverName)
+{
+  SSL* ssl = SSL_new(ctx_);
+  if (ssl == NULL)
+  {
+    logSslErrors("TlsContext::newClientTransport");
+    LOG_FATAL << "SSL_new";
+  }
+  SSL_set_connect_state(ssl);
+  if (!serverName.empty())
+  {
+    if (!isIpAddress(serverName))
+    {
+      // SSL_set_tlsext_host_name() without its C cast
+      SSL_ctrl(ssl, SSL_CTRL_SET_TLSEXT_HOSTNAME, TLSEXT_NAMETYPE_host_name,
+               const_cast<char*>(serverName.c_str()));
+    }
+    if (verifyPeer_)
+    {
+      X509_VERIFY_PARAM* param = SSL_get0_param(ssl);
+      if (isIpAddress(serverName))
+      {
+        X509_VERIFY_PARAM_set1_ip_asc(param, serverName.c_str());
+      }
+      else
+      {
+        X509_VERIFY_PARAM_set1_host(param, serverName.c_str(), 0);
+      }
+    }
+
+    MutexLockGuard lock(mutex_);
+    std::map<string, SSL_SESSION*>::iterator it = sessions_.find(serverName);
+    if (it != sessions_.end())
+    {
+      // SSL_set_session() takes its own reference
+      SSL_set_session(ssl, it->second);
+    }
+  }
+  return std::unique_ptr<Transport>(new TlsTransport(this, ssl, serverName));
+}
+
+void TlsContext::saveSession(const string& serverName, SSL_SESSION* session)
+{
+  SSL_SESSION* old = NULL;
+  {
+    MutexLockGuard lock(mutex_);
+    SSL_SESSION*& entry = sessions_[serverName];
+    old = entry;
+    entry = session;
+  }
+  if (old)
+  {
+    SSL_SESSION_free(old);
+  }
+}
+
+int TlsContext::onNewSession(SSL* ssl, SSL_SESSION* session)
+{
+  TlsContext* context = static_cast<TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  TlsTransport* transport = static_cast<TlsTransport*>(SSL_get_app_data(ssl));
+  if (context == NULL || transport == NULL || transport->serverName().empty())
+  {
+    return 0;
+  }
+  context->saveSession(transport->serverName(), session);
+  return 1;  // we keep the reference
+}
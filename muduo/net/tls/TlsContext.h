@@ -0,0 +1,95 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TLS_TLSCONTEXT_H
+#define MUDUO_NET_TLS_TLSCONTEXT_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Callbacks.h"
+
+#include <map>
+
+struct ssl_ctx_st;
+struct ssl_session_st;
+struct ssl_st;
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// OpenSSL SSL_CTX shared by all connections of a TcpServer or of many
+/// TcpClients, across loops.
+///
+/// Handshakes run in the connection's loop without blocking it. A server
+/// issues session tickets with keys shared by all its loops; a client keeps
+/// the latest session per server name, so a reconnect from any loop
+/// resumes instead of doing a full handshake.
+///
+/// When OpenSSL and the kernel support it, the record layer moves to
+/// kernel TLS (TCP_ULP "tls") after the handshake, writes are then
+/// encrypted by the kernel.
+///
+/// Configure before use, the rest is thread safe.
+class TlsContext : noncopyable
+{
+ public:
+  enum Mode { kServer, kClient };
+
+  explicit TlsContext(Mode mode);
+  ~TlsContext();
+
+  Mode mode() const { return mode_; }
+
+  /// PEM encoded, return true on success.
+  bool useCertificateChainFile(StringArg path);
+  bool usePrivateKeyFile(StringArg path);
+  bool useCertificate(StringPiece certPem, StringPiece keyPem);
+
+  /// Client only. Peers are verified against the system CAs by default.
+  bool addTrustedCertificate(StringPiece certPem);
+  void setVerifyPeer(bool on);
+
+  /// On by default when OpenSSL was built with it.
+  void enableKtls(bool on);
+
+  /// For TcpServer::setTransportFactory().
+  TransportFactory serverTransportFactory();
+  /// For TcpClient::setTransportFactory(), @c serverName is sent as SNI,
+  /// checked against the peer certificate and keys the session cache.
+  TransportFactory clientTransportFactory(const string& serverName);
+
+  int64_t handshakes() { return handshakes_.get(); }
+  int64_t resumedHandshakes() { return resumedHandshakes_.get(); }
+  int64_t ktlsConnections() { return ktlsConnections_.get(); }
+
+ private:
+  friend class TlsTransport;
+
+  std::unique_ptr<Transport> newServerTransport();
+  std::unique_ptr<Transport> newClientTransport(const string& serverName);
+  void saveSession(const string& serverName, struct ssl_session_st* session);
+  static int onNewSession(struct ssl_st* ssl, struct ssl_session_st* session);
+
+  const Mode mode_;
+  struct ssl_ctx_st* ctx_;
+  bool verifyPeer_;
+  AtomicInt64 handshakes_;
+  AtomicInt64 resumedHandshakes_;
+  AtomicInt64 ktlsConnections_;
+
+  MutexLock mutex_;
+  // client side, latest session per server name
+  std::map<string, struct ssl_session_st*> sessions_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TLS_TLSCONTEXT_H
@@ -0,0 +1,227 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/tls/TlsTransport.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/tls/TlsContext.h"
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <errno.h>
+#include <limits.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const size_t kMaxRecordSize = 16 * 1024;
+// read() yields to other channels after this much, unless OpenSSL holds more
+const size_t kReadBudget = 64 * 1024;
+
+void logSslErrors(const char* what, int sslError)
+{
+  unsigned long err;
+  bool logged = false;
+  while ((err = ERR_get_error()) != 0)
+  {
+    char buf[256];
+    ERR_error_string_n(err, buf, sizeof buf);
+    LOG_ERROR << what << " - " << buf;
+    logged = true;
+  }
+  if (!logged)
+  {
+    LOG_ERROR << what << " - SSL_get_error = " << sslError;
+  }
+}
+
+}  // namespace
+
+TlsTransport::TlsTransport(TlsContext* context, SSL* ssl, const string& serverName)
+  : context_(context),
+    ssl_(ssl),
+    serverName_(serverName),
+    attached_(false)
+{
+  SSL_set_app_data(ssl_, this);
+}
+
+TlsTransport::~TlsTransport()
+{
+  SSL_free(ssl_);
+}
+
+Transport::HandshakeState TlsTransport::handshake(int sockfd)
+{
+  if (!attached_)
+  {
+    // a socket BIO lets OpenSSL switch the fd to kTLS
+    SSL_set_fd(ssl_, sockfd);
+    attached_ = true;
+  }
+
+  ERR_clear_error();
+  int ret = SSL_do_handshake(ssl_);
+  if (ret == 1)
+  {
+    context_->handshakes_.increment();
+    if (sessionReused())
+    {
+      context_->resumedHandshakes_.increment();
+    }
+    if (ktlsSend())
+    {
+      context_->ktlsConnections_.increment();
+    }
+    LOG_DEBUG << "TlsTransport::handshake fd=" << sockfd << " " << SSL_get_version(ssl_)
+              << " " << SSL_get_cipher_name(ssl_)
+              << (sessionReused() ? " resumed" : "")
+              << (ktlsSend() ? " ktls-tx" : "") << (ktlsRecv() ? " ktls-rx" : "");
+    return kHandshakeDone;
+  }
+
+  int err = SSL_get_error(ssl_, ret);
+  switch (err)
+  {
+    case SSL_ERROR_WANT_READ:
+      return kHandshakeWantRead;
+    case SSL_ERROR_WANT_WRITE:
+      return kHandshakeWantWrite;
+    default:
+      logSslErrors("TlsTransport::handshake", err);
+      return kHandshakeFailed;
+  }
+}
+
+ssize_t TlsTransport::read(int, Buffer* buf, int* savedErrno)
+{
+  size_t total = 0;
+  for (;;)
+  {
+    buf->ensureWritableBytes(kMaxRecordSize);
+    size_t writable = buf->writableBytes();
+    ERR_clear_error();
+    int n = SSL_read(ssl_, buf->beginWrite(),
+                     static_cast<int>(std::min<size_t>(writable, INT_MAX)));
+    if (n > 0)
+    {
+      buf->hasWritten(n);
+      total += n;
+      // records left inside OpenSSL won't wake up the poller
+      if (total >= kReadBudget && SSL_pending(ssl_) == 0)
+      {
+        break;
+      }
+      continue;
+    }
+
+    int err = SSL_get_error(ssl_, n);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+    {
+      break;
+    }
+    else if (err == SSL_ERROR_ZERO_RETURN)
+    {
+      // answer close_notify, or the peer drops its session as truncated
+      if ((SSL_get_shutdown(ssl_) & SSL_SENT_SHUTDOWN) == 0)
+      {
+        SSL_shutdown(ssl_);
+        ERR_clear_error();
+      }
+      // report what we have first
+      if (total > 0)
+      {
+        break;
+      }
+      return 0;
+    }
+    else if (err == SSL_ERROR_SYSCALL && errno == 0 && ERR_peek_error() == 0)
+    {
+      if (total > 0)
+      {
+        break;
+      }
+      return 0;
+    }
+    else
+    {
+      if (total > 0)
+      {
+        break;
+      }
+      *savedErrno = (err == SSL_ERROR_SYSCALL && errno != 0) ? errno : EPROTO;
+      logSslErrors("TlsTransport::read", err);
+      return -1;
+    }
+  }
+
+  if (total == 0)
+  {
+    *savedErrno = EAGAIN;
+    return -1;
+  }
+  return static_cast<ssize_t>(total);
+}
+
+ssize_t TlsTransport::write(int, const void* data, size_t len)
+{
+  if (len == 0)
+  {
+    return 0;
+  }
+  ERR_clear_error();
+  int n = SSL_write(ssl_, data, static_cast<int>(std::min<size_t>(len, INT_MAX)));
+  if (n > 0)
+  {
+    return n;
+  }
+
+  int err = SSL_get_error(ssl_, n);
+  if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+  {
+    errno = EWOULDBLOCK;
+  }
+  else
+  {
+    int savedErrno = errno;
+    logSslErrors("TlsTransport::write", err);
+    errno = (err == SSL_ERROR_SYSCALL && savedErrno != 0) ? savedErrno : EPIPE;
+  }
+  return -1;
+}
+
+void TlsTransport::shutdown(int)
+{
+  ERR_clear_error();
+  // best effort close_notify, we don't wait for the peer's
+  SSL_shutdown(ssl_);
+  ERR_clear_error();
+}
+
+bool TlsTransport::sessionReused() const
+{
+  return SSL_session_reused(ssl_) == 1;
+}
+
+bool TlsTransport::ktlsSend() const
+{
+#ifdef BIO_get_ktls_send
+  return BIO_get_ktls_send(SSL_get_wbio(ssl_));
+#else
+  return false;
+#endif
+}
+
+bool TlsTransport::ktlsRecv() const
+{
+#ifdef BIO_get_ktls_recv
+  return BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+#else
+  return false;
+#endif
+}
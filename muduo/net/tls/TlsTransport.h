@@ -0,0 +1,51 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TLS_TLSTRANSPORT_H
+#define MUDUO_NET_TLS_TLSTRANSPORT_H
+
+#include "muduo/base/Types.h"
+#include "muduo/net/Transport.h"
+
+struct ssl_st;
+
+namespace muduo
+{
+namespace net
+{
+
+class TlsContext;
+
+///
+/// One TLS session on a non-blocking socket, see TlsContext.
+///
+class TlsTransport : public Transport
+{
+ public:
+  // takes ownership of @c ssl
+  TlsTransport(TlsContext* context, struct ssl_st* ssl, const string& serverName);
+  ~TlsTransport() override;
+
+  HandshakeState handshake(int sockfd) override;
+  ssize_t read(int sockfd, Buffer* buf, int* savedErrno) override;
+  ssize_t write(int sockfd, const void* data, size_t len) override;
+  void shutdown(int sockfd) override;
+
+  const string& serverName() const { return serverName_; }
+  bool sessionReused() const;
+  bool ktlsSend() const;
+  bool ktlsRecv() const;
+
+ private:
+  TlsContext* context_;
+  struct ssl_st* ssl_;
+  const string serverName_;
+  bool attached_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TLS_TLSTRANSPORT_H
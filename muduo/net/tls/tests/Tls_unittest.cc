@@ -0,0 +1,221 @@
+#include "muduo/net/tls/TlsContext.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 2;
+const size_t kMessageSize = 1024 * 1024;
+
+EventLoop* g_loop;
+TlsContext* g_clientContext;
+InetAddress g_serverAddr(2011, true);
+std::vector<std::unique_ptr<TcpClient>> g_clients;
+size_t g_received = 0;
+AtomicInt32 g_serverUps;
+AtomicInt32 g_serverDowns;
+
+string bioToString(BIO* bio)
+{
+  char* data = NULL;
+  long len = BIO_get_mem_data(bio, &data);
+  return string(data, static_cast<size_t>(len));
+}
+
+// self-signed certificate for "localhost"
+void makeCertificate(string* certPem, string* keyPem)
+{
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509(bio, cert);
+  *certPem = bioToString(bio);
+  BIO_free(bio);
+  bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, NULL, NULL, 0, NULL, NULL);
+  *keyPem = bioToString(bio);
+  BIO_free(bio);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+// the server's loops, up and down only for handshakes that completed
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_serverUps.increment();
+  }
+  else
+  {
+    g_serverDowns.increment();
+  }
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+void finish()
+{
+  LOG_INFO << "handshakes " << g_clientContext->handshakes()
+           << " resumed " << g_clientContext->resumedHandshakes()
+           << " ktls " << g_clientContext->ktlsConnections();
+  if (g_clientContext->handshakes() != kRounds
+      || g_clientContext->resumedHandshakes() < 1)
+  {
+    LOG_ERROR << "reconnect did not resume the TLS session";
+    abort();
+  }
+  g_clients.clear();
+  g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+}
+
+void connectOnce();
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_received = 0;
+    conn->send(string(kMessageSize, 'x'));
+  }
+  else if (static_cast<int>(g_clients.size()) < kRounds)
+  {
+    g_loop->queueInLoop(connectOnce);
+  }
+  else
+  {
+    g_loop->queueInLoop(finish);
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  g_received += buf->readableBytes();
+  buf->retrieveAll();
+  if (g_received == kMessageSize)
+  {
+    LOG_INFO << "echoed " << g_received << " bytes over TLS";
+    conn->shutdown();
+  }
+}
+
+void connectOnce()
+{
+  g_clients.emplace_back(new TcpClient(g_loop, g_serverAddr, "TlsClient"));
+  TcpClient* client = g_clients.back().get();
+  client->setTransportFactory(g_clientContext->clientTransportFactory("localhost"));
+  client->setConnectionCallback(onClientConnection);
+  client->setMessageCallback(onClientMessage);
+  client->connect();
+}
+
+// plain TCP clients, one talks garbage and one hangs up, the server fails
+// both handshakes and must not report either connection
+
+std::vector<std::unique_ptr<TcpClient>> g_plainClients;
+int g_plainDown = 0;
+
+void onPlainConnection(bool garbage, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    if (garbage)
+    {
+      conn->send("GET / HTTP/1.0\r\n\r\n");
+    }
+    else
+    {
+      conn->shutdown();
+    }
+  }
+  else if (++g_plainDown == 2)
+  {
+    // let the server side see the close too
+    g_loop->runAfter(0.1, std::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+void testPlainClients()
+{
+  int ups = g_serverUps.get();
+  for (int i = 0; i < 2; ++i)
+  {
+    g_plainClients.emplace_back(new TcpClient(g_loop, g_serverAddr, "PlainClient"));
+    g_plainClients.back()->setConnectionCallback(
+        std::bind(onPlainConnection, i == 0, _1));
+    g_plainClients.back()->connect();
+  }
+  g_loop->loop();
+  g_plainClients.clear();
+
+  LOG_INFO << "server saw " << g_serverUps.get() << " up " << g_serverDowns.get() << " down";
+  if (g_serverUps.get() != ups || g_serverDowns.get() != ups)
+  {
+    LOG_ERROR << "failed handshakes were reported to the connection callback";
+    abort();
+  }
+}
+
+void timeout()
+{
+  LOG_ERROR << "timeout, received " << g_received;
+  abort();
+}
+
+int main()
+{
+  string certPem, keyPem;
+  makeCertificate(&certPem, &keyPem);
+
+  TlsContext serverContext(TlsContext::kServer);
+  if (!serverContext.useCertificate(certPem, keyPem))
+  {
+    abort();
+  }
+  TlsContext clientContext(TlsContext::kClient);
+  clientContext.addTrustedCertificate(certPem);
+  g_clientContext = &clientContext;
+
+  EventLoop loop;
+  g_loop = &loop;
+  TcpServer server(&loop, g_serverAddr, "TlsServer");
+  server.setTransportFactory(serverContext.serverTransportFactory());
+  server.setConnectionCallback(onServerConnection);
+  server.setMessageCallback(onServerMessage);
+  server.setThreadNum(2);
+  server.start();
+
+  connectOnce();
+  loop.runAfter(10.0, timeout);
+  loop.loop();
+  testPlainClients();
+}
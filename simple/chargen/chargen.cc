@@ -52,6 +52,9 @@ void ChargenServer::onConnection(const TcpConnectionPtr& conn)
   if (conn->connected())
   {
     conn->setTcpNoDelay(true);
+    conn->setLowWaterMarkCallback(
+        std::bind(&ChargenServer::onLowWaterMark, this, _1, _2), message_.size());
+    conn->setTcpNotSentLowat(64*1024);
     conn->send(message_);
   }
 }
@@ -71,6 +74,11 @@ void ChargenServer::onWriteComplete(const TcpConnectionPtr& conn)
   conn->send(message_);
 }
 
+void ChargenServer::onLowWaterMark(const TcpConnectionPtr& conn, size_t len)
+{
+  onWriteComplete(conn);
+}
+
 void ChargenServer::printThroughput()
 {
   Timestamp endTime = Timestamp::now();
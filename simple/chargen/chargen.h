@@ -13,6 +13,10 @@ class ChargenServer
 
   void start();
 
+  /// Caps every connection at @c bytesPerSecond, 0 for no cap.
+  void setRateLimit(double bytesPerSecond)
+  { server_.setRateLimit(bytesPerSecond, 64 * 1024); }
+
  private:
   void onConnection(const muduo::net::TcpConnectionPtr& conn);
 
@@ -21,6 +25,7 @@ class ChargenServer
                  muduo::Timestamp time);
 
   void onWriteComplete(const muduo::net::TcpConnectionPtr& conn);
+  void onLowWaterMark(const muduo::net::TcpConnectionPtr& conn, size_t len);
   void printThroughput();
 
   muduo::net::TcpServer server_;
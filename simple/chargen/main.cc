@@ -3,17 +3,23 @@
 #include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
 
+#include <stdlib.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-int main()
+int main(int argc, char* argv[])
 {
   LOG_INFO << "pid = " << getpid();
+  LOG_INFO << "usage: " << argv[0] << " [bytes_per_second]";
   EventLoop loop;
   InetAddress listenAddr(2019);
   ChargenServer server(&loop, listenAddr, true);
+  if (argc > 1)
+  {
+    server.setRateLimit(atof(argv[1]));
+  }
   server.start();
   loop.loop();
 }
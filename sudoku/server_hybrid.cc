@@ -3,15 +3,19 @@
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Logging.h"
 #include "muduo/base/Thread.h"
+#include "muduo/base/ThreadLocal.h"
 #include "muduo/base/ThreadPool.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThread.h"
 #include "muduo/net/InetAddress.h"
+#include "muduo/net/LoopInbox.h"
 #include "muduo/net/TcpServer.h"
 #include "muduo/net/inspect/Inspector.h"
 
 #include <boost/circular_buffer.hpp>
 
+#include <map>
+
 //#include <stdio.h>
 //#include <unistd.h>
 
@@ -29,6 +33,7 @@ class SudokuServer : noncopyable
                int numThreads,
                bool nodelay)
     : server_(loop, listenAddr, "SudokuServer"),
+      inboxes_(),
       threadPool_(),
       numThreads_(numThreads),
       tcpNoDelay_(nodelay),
@@ -45,6 +50,7 @@ class SudokuServer : noncopyable
     server_.setMessageCallback(
         std::bind(&SudokuServer::onMessage, this, _1, _2, _3));
     server_.setThreadNum(numEventLoops);
+    server_.setKernelReceiveTime(true);
 
     inspector_.add("sudoku", "stats", std::bind(&SudokuStat::report, &stat_),
                    "statistics of sudoku solver");
@@ -71,6 +77,7 @@ class SudokuServer : noncopyable
 
   void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
   {
+    stat_.recordSocketQueueing(conn->getLoop()->pollReturnTime(), receiveTime);
     LOG_DEBUG << conn->name();
     size_t len = buf->readableBytes();
     while (len >= kCells + 2)
@@ -142,18 +149,40 @@ class SudokuServer : noncopyable
   {
     LOG_DEBUG << conn->name();
     string result = solveSudoku(req.puzzle);
-    if (req.id.empty())
+    string response = req.id.empty() ? result + "\r\n" : req.id + ":" + result + "\r\n";
+    EventLoop* loop = conn->getLoop();
+    if (loop->isInLoopThread())
     {
-      conn->send(result + "\r\n");
+      // numThreads == 0, solved inline in the IO thread
+      sendInLoop(conn, response);
     }
     else
     {
-      conn->send(req.id + ":" + result + "\r\n");
+      inboxOf(loop)->post(std::bind(&SudokuServer::sendInLoop, conn, std::move(response)));
     }
     stat_.recordResponse(Timestamp::now(), req.receiveTime, result != kNoSolution);
   }
 
+  static void sendInLoop(const TcpConnectionPtr& conn, const string& response)
+  {
+    conn->send(response);
+  }
+
+  // 每个worker线程到每个IO loop一条SPSC通道, 不争抢loop的锁
+  LoopInbox* inboxOf(EventLoop* loop)
+  {
+    std::unique_ptr<LoopInbox>& inbox = inboxes_.value()[loop];
+    if (!inbox)
+    {
+      inbox.reset(new LoopInbox(loop));
+    }
+    return inbox.get();
+  }
+
+  typedef std::map<EventLoop*, std::unique_ptr<LoopInbox>> InboxMap;
+
   TcpServer server_;
+  ThreadLocal<InboxMap> inboxes_;  // outlives the worker threads
   ThreadPool threadPool_;
   const int numThreads_;
   const bool tcpNoDelay_;